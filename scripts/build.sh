@@ -6,6 +6,6 @@ cd "$project_root" || exit 1
 cmake -B build \
     -DCMAKE_CXX_COMPILER=clang++ \
     -DCMAKE_BUILD_TYPE=Release \
-    -DCMAKE_CXX_FLAGS_RELEASE="-O3 -march=native"
+    -DCMAKE_CXX_FLAGS_RELEASE="-O3"
 
 cmake --build build -j8
\ No newline at end of file
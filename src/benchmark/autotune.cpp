@@ -0,0 +1,168 @@
+#include "autotune.h"
+#include "benchmark.h"
+#include "cache_control.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+int value_of(const TuningValues &values, const char *name, int fallback)
+{
+    for (const auto &kv : values)
+    {
+        if (kv.first == name)
+        {
+            return kv.second;
+        }
+    }
+    return fallback;
+}
+
+// A packed mc x kc block of A should stay in L2 and a kc x nc block of B in
+// the LLC; blockings that overflow either are not worth timing.
+bool fits_caches(const TuningValues &values)
+{
+    const std::size_t mc = static_cast<std::size_t>(value_of(values, "mc", 0));
+    const std::size_t kc = static_cast<std::size_t>(value_of(values, "kc", 0));
+    const std::size_t nc = static_cast<std::size_t>(value_of(values, "nc", 0));
+    if (mc * kc * sizeof(float) > l2_size_bytes())
+    {
+        return false;
+    }
+    return kc * nc * sizeof(float) <= llc_size_bytes();
+}
+
+std::vector<TuningValues> candidate_grid(const std::vector<TunableParam> &params)
+{
+    std::vector<TuningValues> grid(1);
+    for (const TunableParam &p : params)
+    {
+        std::vector<TuningValues> next;
+        for (const TuningValues &partial : grid)
+        {
+            for (int value : p.candidates)
+            {
+                next.push_back(partial);
+                next.back().emplace_back(p.name, value);
+            }
+        }
+        grid = std::move(next);
+    }
+    return grid;
+}
+} // namespace
+
+AutotuneResult autotune_gemm(GemmOp *op, const float *A, const float *B, float *C,
+                             int M, int N, int K, const AutotuneConfig &cfg)
+{
+    const GemmShape shape{M, N, K};
+    const std::vector<TunableParam> params = op->tunables(shape);
+    if (params.empty())
+    {
+        throw std::invalid_argument("Operator " + op->name() + " has no tunable parameters");
+    }
+
+    AutotuneResult result;
+    for (const TunableParam &p : params)
+    {
+        result.defaults.emplace_back(p.name, p.value);
+    }
+    std::vector<TuningValues> grid = candidate_grid(params);
+    result.grid_size = grid.size();
+    if (cfg.prune_footprint)
+    {
+        std::vector<TuningValues> kept;
+        std::copy_if(grid.begin(), grid.end(), std::back_inserter(kept), fits_caches);
+        if (!kept.empty())
+        {
+            grid = std::move(kept);
+        }
+    }
+    if (cfg.max_configs > 0 && grid.size() > cfg.max_configs)
+    {
+        std::vector<TuningValues> subset;
+        for (std::size_t i = 0; i < cfg.max_configs; ++i)
+        {
+            subset.push_back(grid[i * grid.size() / cfg.max_configs]);
+        }
+        grid = std::move(subset);
+    }
+    result.searched = grid.size();
+
+    op->set_use_tuning_cache(false);
+    auto measure = [&](const TuningValues &values, int iterations) {
+        for (const auto &kv : values)
+        {
+            op->set_tunable(kv.first, kv.second);
+        }
+        BenchConfig bench;
+        bench.warmup = 1;
+        bench.min_iterations = iterations;
+        bench.max_iterations = iterations;
+        bench.min_time_ms = 0.0;
+        bench.quiet = true;
+        result.timed_runs += static_cast<std::size_t>(iterations);
+        return bench_gemm(op, A, B, C, M, N, K, bench).ms;
+    };
+    auto restore = [&]() {
+        for (const auto &kv : result.defaults)
+        {
+            op->set_tunable(kv.first, kv.second);
+        }
+        op->set_use_tuning_cache(true);
+    };
+
+    try
+    {
+        const std::size_t eta = static_cast<std::size_t>(std::max(cfg.eta, 2));
+        int iterations = std::max(cfg.initial_iterations, 1);
+        std::vector<std::pair<double, std::size_t>> ranked;
+        std::vector<std::size_t> survivors(grid.size());
+        for (std::size_t i = 0; i < survivors.size(); ++i)
+        {
+            survivors[i] = i;
+        }
+        while (survivors.size() > 1)
+        {
+            ranked.clear();
+            for (std::size_t i : survivors)
+            {
+                ranked.emplace_back(measure(grid[i], iterations), i);
+            }
+            std::sort(ranked.begin(), ranked.end());
+            survivors.resize((survivors.size() + eta - 1) / eta);
+            for (std::size_t i = 0; i < survivors.size(); ++i)
+            {
+                survivors[i] = ranked[i].second;
+            }
+            iterations *= static_cast<int>(eta);
+            ++result.rounds;
+        }
+
+        // Interleave the final measurements so drift affects both alike.
+        const int final_iterations = std::max(cfg.final_iterations, 1);
+        const TuningValues &winner = grid[survivors.front()];
+        result.default_ms = measure(result.defaults, final_iterations);
+        result.best_ms = measure(winner, final_iterations);
+        result.default_ms = std::min(result.default_ms, measure(result.defaults, final_iterations));
+        result.best_ms = std::min(result.best_ms, measure(winner, final_iterations));
+        if (result.best_ms < result.default_ms)
+        {
+            result.best = winner;
+        }
+        else
+        {
+            result.best = result.defaults;
+            result.best_ms = result.default_ms;
+        }
+    }
+    catch (...)
+    {
+        restore();
+        throw;
+    }
+    restore();
+    return result;
+}
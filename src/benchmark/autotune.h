@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+#include "ops/gemm_op.h"
+
+struct AutotuneConfig
+{
+    int eta = 3;                // each successive-halving round keeps the best 1/eta
+    int initial_iterations = 1; // timed runs per config in the first round, times eta per round
+    int final_iterations = 5;   // timed runs when the winner is re-measured against the defaults
+    std::size_t max_configs = 0; // evenly spaced subset of the pruned grid (0 = all)
+    bool prune_footprint = true; // drop blockings whose A block overflows L2 or B block the LLC
+};
+
+struct AutotuneResult
+{
+    TuningValues defaults;
+    TuningValues best; // equals defaults when nothing beat them
+    double default_ms = 0.0;
+    double best_ms = 0.0;
+    std::size_t grid_size = 0; // Cartesian product of the candidates
+    std::size_t searched = 0;  // configs left after pruning
+    int rounds = 0;
+    std::size_t timed_runs = 0;
+};
+
+// Searches op's tunables (GemmOp::tunables) for one M x N x K problem with
+// operands in the op's layout. The candidate grid is pruned by cache
+// footprint, then narrowed by successive halving: every survivor is timed,
+// the fastest 1/eta advance, and the next round times them eta times as
+// often. The winner is finally re-measured against the defaults and only
+// kept if it is faster. op is left with its default knobs and the tuning
+// cache lookup enabled; storing the result is up to the caller. Throws
+// std::invalid_argument when the op has no tunables.
+AutotuneResult autotune_gemm(GemmOp *op, const float *A, const float *B, float *C,
+                             int M, int N, int K, const AutotuneConfig &cfg = AutotuneConfig{});
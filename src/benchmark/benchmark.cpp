@@ -1,24 +1,507 @@
 #include "benchmark.h"
+#include "cache_control.h"
 #include "../common/matrix_buffer.h"
+#include "../common/trace.h"
 #include "ops/gemm_op.h"
 
-BenchResult bench_gemm(GemmOp *op,
-                       const float *A, const float *B, float *C,
-                       int M, int N, int K)
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+namespace
 {
-    printf("Benchmarking operator: %s\n", op->name().c_str());
-    double total_ms = 0.0;
+// Copies of the operands used by ColdStrategy::Rotate. Slot 0 is the
+// caller's arguments; the others point at private copies with the same
+// strides and layout.
+struct RotatingOperands
+{
+    std::vector<MatrixBuffer> storage;
+    std::vector<GemmArgs> sets;
+};
+
+RotatingOperands make_rotating_operands(const GemmArgs &args)
+{
+    RotatingOperands rot;
+    rot.sets.push_back(args);
+
+    const std::size_t a_count = args.A.storage_size();
+    const std::size_t b_count = args.B.storage_size();
+    const std::size_t c_count = args.C.storage_size();
+    const std::size_t footprint = (a_count + b_count + c_count) * sizeof(float);
+    const std::size_t copies = footprint == 0 ? 1 : std::min<std::size_t>(64, 2 * llc_size_bytes() / footprint + 1);
+    for (std::size_t i = 1; i <= copies; ++i)
+    {
+        MatrixBuffer a = MatrixBuffer::allocate_uninitialized(a_count, 64);
+        MatrixBuffer b = MatrixBuffer::allocate_uninitialized(b_count, 64);
+        MatrixBuffer c = MatrixBuffer::allocate_uninitialized(c_count, 64);
+        std::copy(args.A.data, args.A.data + a_count, a.data());
+        std::copy(args.B.data, args.B.data + b_count, b.data());
+        std::copy(args.C.data, args.C.data + c_count, c.data());
+        GemmArgs set = args;
+        set.A.data = a.data();
+        set.B.data = b.data();
+        set.C.data = c.data();
+        rot.sets.push_back(set);
+        rot.storage.push_back(std::move(a));
+        rot.storage.push_back(std::move(b));
+        rot.storage.push_back(std::move(c));
+    }
+    return rot;
+}
+
+// Zeroes every element of C that the op writes, padding excluded.
+void clear_c(const MutableMatrixView &C)
+{
+    if (C.is_dense(C.layout == MatrixLayout::ColMajor))
+    {
+        MatrixBuffer::fill_parallel(C.data, C.storage_size(), 0.0f);
+        return;
+    }
+    const int outer = C.layout == MatrixLayout::RowMajor ? C.rows : C.cols;
+    const int inner = C.layout == MatrixLayout::RowMajor ? C.cols : C.rows;
+    for (int o = 0; o < outer; ++o)
+    {
+        std::fill(C.data + static_cast<std::size_t>(o) * C.ld, C.data + static_cast<std::size_t>(o) * C.ld + inner, 0.0f);
+    }
+}
+// Flat operand arrays of a batched or grouped run: every entry's A, B and
+// C stored back to back.
+struct FlatOperands
+{
+    const float *A;
+    const float *B;
+    float *C;
+};
+
+// Contiguous copies of the flat arrays for ColdStrategy::Rotate, as with
+// RotatingOperands.
+struct RotatingFlat
+{
+    std::vector<MatrixBuffer> storage;
+    std::vector<FlatOperands> sets;
+};
+
+RotatingFlat make_rotating_flat(const FlatOperands &ops, std::size_t a_count, std::size_t b_count,
+                                std::size_t c_count)
+{
+    RotatingFlat rot;
+    rot.sets.push_back(ops);
+
+    const std::size_t footprint = (a_count + b_count + c_count) * sizeof(float);
+    const std::size_t copies = footprint == 0 ? 1 : std::min<std::size_t>(64, 2 * llc_size_bytes() / footprint + 1);
+    for (std::size_t i = 1; i <= copies; ++i)
+    {
+        MatrixBuffer a = MatrixBuffer::allocate_uninitialized(a_count, 64);
+        MatrixBuffer b = MatrixBuffer::allocate_uninitialized(b_count, 64);
+        MatrixBuffer c = MatrixBuffer::allocate_uninitialized(c_count, 64);
+        std::copy(ops.A, ops.A + a_count, a.data());
+        std::copy(ops.B, ops.B + b_count, b.data());
+        std::copy(ops.C, ops.C + c_count, c.data());
+        rot.sets.push_back(FlatOperands{a.data(), b.data(), c.data()});
+        rot.storage.push_back(std::move(a));
+        rot.storage.push_back(std::move(b));
+        rot.storage.push_back(std::move(c));
+    }
+    return rot;
+}
+
+double elapsed_ms(std::chrono::high_resolution_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+// Iteration loop shared by the single and batched benchmarks. run(set)
+// executes one iteration on operand set `set` (of set_count); before(set)
+// runs ahead of it outside the timed region. Fills the timing, stability
+// and perf fields of r and returns the set used last.
+std::size_t sample_iterations(GemmOp &op, const BenchConfig &cfg, std::size_t set_count, double flops,
+                              const std::function<void(std::size_t)> &before,
+                              const std::function<void(std::size_t)> &run,
+                              BenchResult &r)
+{
+    const bool cold = cfg.cache_mode == CacheMode::Cold;
+    std::unique_ptr<CacheFlusher> flusher;
+    if (cold && cfg.cold_strategy == ColdStrategy::Flush)
+    {
+        flusher = std::make_unique<CacheFlusher>(op.num_threads());
+    }
 
-    for (int iter = 0; iter < ITERATIONS; ++iter)
+    // Counters are toggled just outside the timestamps, so the ioctl cost
+    // does not show up in the measured time.
+    std::unique_ptr<PerfCounters> counters;
+    std::vector<PerfSample> perf_samples;
+    std::string perf_status;
+    if (cfg.perf_counters)
     {
-        memset(C, 0, static_cast<std::size_t>(M) * static_cast<std::size_t>(N) * sizeof(float));
+        // Multithreaded ops are counted on every pool thread.
+        counters = std::make_unique<PerfCounters>(op.worker_thread_ids());
+        perf_status = counters->status();
+        if (!counters->available())
+        {
+            printf("Hardware counters disabled: %s\n", counters->status().c_str());
+            counters.reset();
+        }
+    }
+
+    for (int iter = 0; iter < cfg.warmup; ++iter)
+    {
+        before(0);
         auto t0 = std::chrono::high_resolution_clock::now();
-        op->run(A, B, C, M, N, K);
+        {
+            GEMMBENCH_TRACE_SCOPE("warmup");
+            run(0);
+        }
+        const double ms = elapsed_ms(t0);
+        if (iter == 0)
+        {
+            r.first_run_ms = ms;
+        }
+    }
+
+    const int min_iterations = std::max(1, cfg.min_iterations);
+    const int max_iterations = std::max(min_iterations, cfg.max_iterations);
+    r.samples_ms.reserve(static_cast<std::size_t>(std::min(max_iterations, 4096)));
+
+    double total_ms = 0.0;
+    std::size_t last_set = 0;
+    for (int iter = 0; iter < max_iterations; ++iter)
+    {
+        // Rotation starts at a private copy, so slot 0 is not still warm
+        // from the warmup runs.
+        last_set = set_count == 1 ? 0 : (static_cast<std::size_t>(iter) + 1) % set_count;
+        before(last_set);
+        if (flusher)
+        {
+            // On the op's own threads, so their private caches are evicted too.
+            op.run_on_threads([&](int tid, int nt) {
+                GEMMBENCH_TRACE_SCOPE("flush");
+                flusher->flush(tid, nt);
+            });
+        }
+        if (counters)
+        {
+            counters->start();
+        }
+        auto t0 = std::chrono::high_resolution_clock::now();
+        {
+            GEMMBENCH_TRACE_SCOPE("iteration");
+            run(last_set);
+        }
         auto t1 = std::chrono::high_resolution_clock::now();
-        total_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        if (counters)
+        {
+            perf_samples.push_back(counters->stop());
+        }
+        const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        r.samples_ms.push_back(ms);
+        total_ms += ms;
+
+        if (iter + 1 < min_iterations || total_ms < cfg.min_time_ms)
+        {
+            continue;
+        }
+        if (!cfg.until_stable)
+        {
+            break;
+        }
+        if (compute_stats(r.samples_ms).cv <= cfg.target_cv)
+        {
+            break;
+        }
+    }
+
+    if (cfg.warmup <= 0)
+    {
+        r.first_run_ms = r.samples_ms.front();
+    }
+    r.stats = compute_stats(r.samples_ms);
+    r.ms = r.stats.median;
+    r.stable = r.stats.cv <= cfg.target_cv;
+    if (cfg.perf_counters)
+    {
+        const int counted = counters ? counters->threads() : 0;
+        r.perf = summarize_perf(perf_samples, flops, counted, op.num_threads());
+        r.perf.status = perf_status;
+        if (r.perf.available && r.perf.partial)
+        {
+            r.perf.status += std::string(r.perf.status.empty() ? "" : "; ") + "counted " + std::to_string(counted) +
+                             " of " + std::to_string(op.num_threads()) + " threads" +
+                             (counted == 1 ? " (calling thread only)" : "") + ", flops_per_cycle omitted";
+        }
+    }
+    return last_set;
+}
+} // namespace
+
+const char *cache_mode_name(CacheMode mode)
+{
+    return mode == CacheMode::Cold ? "cold" : "hot";
+}
+
+BenchResult bench_gemm(GemmOp *op,
+                       const float *A, const float *B, float *C,
+                       int M, int N, int K,
+                       const BenchConfig &cfg)
+{
+    // Dense operands in the op's own layout take run_strided's direct path
+    // to run(), so this is the classic benchmark.
+    const bool col_major = op->columnMajor();
+    GemmArgs args;
+    args.M = M;
+    args.N = N;
+    args.K = K;
+    args.A = dense_view(A, M, K, col_major);
+    args.B = dense_view(B, K, N, col_major);
+    args.C = dense_view(C, M, N, col_major);
+    return bench_gemm(op, args, cfg);
+}
+
+BenchResult bench_gemm(GemmOp *op, const GemmArgs &args, const BenchConfig &cfg)
+{
+    if (!cfg.quiet)
+    {
+        printf("Benchmarking operator: %s (%s cache)\n", op->name().c_str(), cache_mode_name(cfg.cache_mode));
+    }
+    const int M = args.M;
+    const int N = args.N;
+    const int K = args.K;
+    // With beta != 0 the op reads C, so every run starts from the C the
+    // caller passed in (C0); callers verify against alpha * A * B + beta * C0.
+    MatrixBuffer c0;
+    if (args.beta != 0.0f)
+    {
+        c0 = MatrixBuffer::allocate_uninitialized(args.C.storage_size(), 64);
+        std::copy(args.C.data, args.C.data + args.C.storage_size(), c0.data());
     }
 
     BenchResult r;
-    r.ms = total_ms / ITERATIONS;
+    r.warmup = cfg.warmup;
+    r.cache_mode = cfg.cache_mode;
+
+    // Planning happens once, before any run, the way a library caller would
+    // set up a GEMM that is executed many times.
+    const GemmShape shape{M, N, K};
+    auto p0 = std::chrono::high_resolution_clock::now();
+    {
+        GEMMBENCH_TRACE_SCOPE("prepare");
+        op->prepare(shape, args.C.layout);
+    }
+    r.prepare_ms = elapsed_ms(p0);
+    if (cfg.prepack_b)
+    {
+        auto p1 = std::chrono::high_resolution_clock::now();
+        r.b_prepacked = op->pack_b(args.B);
+        r.pack_b_ms = elapsed_ms(p1);
+        if (!r.b_prepacked)
+        {
+            printf("Operator %s does not support pre-packed B; --prepack-b has no effect\n", op->name().c_str());
+        }
+    }
+    r.workspace_bytes = op->workspace_size(shape);
+
+    RotatingOperands rotation;
+    if (cfg.cache_mode == CacheMode::Cold && cfg.cold_strategy == ColdStrategy::Rotate)
+    {
+        rotation = make_rotating_operands(args);
+        if (r.b_prepacked)
+        {
+            // The packed panels stand in for B, so every slot keeps the B
+            // they were packed from; A and C still rotate.
+            for (GemmArgs &set : rotation.sets)
+            {
+                set.B = args.B;
+            }
+        }
+    }
+    else
+    {
+        rotation.sets.push_back(args);
+    }
+
+    r.flops = 2.0 * M * N * static_cast<double>(K);
+    const std::size_t last_set = sample_iterations(
+        *op, cfg, rotation.sets.size(), r.flops,
+        [&](std::size_t set) {
+            if (args.beta != 0.0f)
+            {
+                std::copy(c0.data(), c0.data() + c0.size(), rotation.sets[set].C.data);
+            }
+            else if (cfg.clear_c)
+            {
+                clear_c(rotation.sets[set].C);
+            }
+        },
+        [&](std::size_t set) { op->run_strided(rotation.sets[set]); },
+        r);
+
+    // Callers verify the result in C.
+    const MutableMatrixView &last_c = rotation.sets[last_set].C;
+    if (last_c.data != args.C.data)
+    {
+        std::copy(last_c.data, last_c.data + last_c.storage_size(), args.C.data);
+    }
+    return r;
+}
+
+BenchResult bench_gemm_batched(GemmOp *op, const GemmBatch &batch, const BenchConfig &cfg)
+{
+    if (!cfg.quiet)
+    {
+        printf("Benchmarking operator: %s (%s cache, batch of %d via %s)\n", op->name().c_str(),
+               cache_mode_name(cfg.cache_mode), batch.batch,
+               cfg.batch_interface == BatchInterface::PointerArray ? "pointer arrays" : "strides");
+    }
+    const std::size_t stride_a = static_cast<std::size_t>(batch.M) * static_cast<std::size_t>(batch.K);
+    const std::size_t stride_b = static_cast<std::size_t>(batch.K) * static_cast<std::size_t>(batch.N);
+    const std::size_t stride_c = static_cast<std::size_t>(batch.M) * static_cast<std::size_t>(batch.N);
+    const std::size_t entries = static_cast<std::size_t>(std::max(batch.batch, 0));
+
+    BenchResult r;
+    r.warmup = cfg.warmup;
+    r.cache_mode = cfg.cache_mode;
+    r.batch = batch.batch;
+
+    const GemmShape shape{batch.M, batch.N, batch.K};
+    auto p0 = std::chrono::high_resolution_clock::now();
+    {
+        GEMMBENCH_TRACE_SCOPE("prepare");
+        op->prepare(shape, MatrixLayout::RowMajor);
+    }
+    r.prepare_ms = elapsed_ms(p0);
+    r.workspace_bytes = op->workspace_size(shape);
+
+    RotatingFlat rotation;
+    if (cfg.cache_mode == CacheMode::Cold && cfg.cold_strategy == ColdStrategy::Rotate)
+    {
+        rotation = make_rotating_flat(FlatOperands{batch.A, batch.B, batch.C},
+                                      stride_a * entries, stride_b * entries, stride_c * entries);
+    }
+    else
+    {
+        rotation.sets.push_back(FlatOperands{batch.A, batch.B, batch.C});
+    }
+
+    // Pointer arrays are built up front, as a caller would keep them.
+    std::vector<std::vector<const float *>> a_ptrs(rotation.sets.size());
+    std::vector<std::vector<const float *>> b_ptrs(rotation.sets.size());
+    std::vector<std::vector<float *>> c_ptrs(rotation.sets.size());
+    if (cfg.batch_interface == BatchInterface::PointerArray)
+    {
+        for (std::size_t s = 0; s < rotation.sets.size(); ++s)
+        {
+            const FlatOperands &set = rotation.sets[s];
+            for (std::size_t i = 0; i < entries; ++i)
+            {
+                a_ptrs[s].push_back(set.A + i * stride_a);
+                b_ptrs[s].push_back(set.B + i * stride_b);
+                c_ptrs[s].push_back(set.C + i * stride_c);
+            }
+        }
+    }
+
+    r.flops = 2.0 * batch.M * batch.N * static_cast<double>(batch.K) * entries;
+    const std::size_t last_set = sample_iterations(
+        *op, cfg, rotation.sets.size(), r.flops,
+        [&](std::size_t set) {
+            if (cfg.clear_c)
+            {
+                MatrixBuffer::fill_parallel(rotation.sets[set].C, stride_c * entries, 0.0f);
+            }
+        },
+        [&](std::size_t set) {
+            const FlatOperands &ops = rotation.sets[set];
+            if (cfg.batch_interface == BatchInterface::PointerArray)
+            {
+                op->run_batched(a_ptrs[set].data(), b_ptrs[set].data(), c_ptrs[set].data(),
+                                batch.M, batch.N, batch.K, batch.batch);
+            }
+            else
+            {
+                op->run_strided_batched(ops.A, stride_a, ops.B, stride_b, ops.C, stride_c,
+                                        batch.M, batch.N, batch.K, batch.batch);
+            }
+        },
+        r);
+
+    const FlatOperands &last = rotation.sets[last_set];
+    if (last.C != batch.C)
+    {
+        std::copy(last.C, last.C + stride_c * entries, batch.C);
+    }
+    return r;
+}
+
+BenchResult bench_gemm_grouped(GemmOp *op, const GemmGroup &group, const BenchConfig &cfg)
+{
+    const int count = static_cast<int>(group.shapes.size());
+    if (!cfg.quiet)
+    {
+        printf("Benchmarking operator: %s (%s cache, %d groups)\n", op->name().c_str(),
+               cache_mode_name(cfg.cache_mode), count);
+    }
+    const GroupedOffsets off = grouped_offsets(group.shapes);
+
+    BenchResult r;
+    r.warmup = cfg.warmup;
+    r.cache_mode = cfg.cache_mode;
+    r.groups = count;
+    for (const GemmShape &g : group.shapes)
+    {
+        r.flops += g.flops();
+    }
+
+    // Workspaces are sized for the largest extents, which covers every group.
+    const GemmShape largest = max_shape(group.shapes);
+    auto p0 = std::chrono::high_resolution_clock::now();
+    {
+        GEMMBENCH_TRACE_SCOPE("prepare");
+        op->prepare(largest, MatrixLayout::RowMajor);
+    }
+    r.prepare_ms = elapsed_ms(p0);
+    r.workspace_bytes = op->workspace_size(largest);
+
+    RotatingFlat rotation;
+    if (cfg.cache_mode == CacheMode::Cold && cfg.cold_strategy == ColdStrategy::Rotate)
+    {
+        rotation = make_rotating_flat(FlatOperands{group.A, group.B, group.C}, off.a.back(), off.b.back(), off.c.back());
+    }
+    else
+    {
+        rotation.sets.push_back(FlatOperands{group.A, group.B, group.C});
+    }
+
+    // Per-group pointers are built up front, as a caller would keep them.
+    std::vector<std::vector<const float *>> a_ptrs(rotation.sets.size());
+    std::vector<std::vector<const float *>> b_ptrs(rotation.sets.size());
+    std::vector<std::vector<float *>> c_ptrs(rotation.sets.size());
+    for (std::size_t s = 0; s < rotation.sets.size(); ++s)
+    {
+        const FlatOperands &set = rotation.sets[s];
+        for (std::size_t g = 0; g < group.shapes.size(); ++g)
+        {
+            a_ptrs[s].push_back(set.A + off.a[g]);
+            b_ptrs[s].push_back(set.B + off.b[g]);
+            c_ptrs[s].push_back(set.C + off.c[g]);
+        }
+    }
+
+    const std::size_t last_set = sample_iterations(
+        *op, cfg, rotation.sets.size(), r.flops,
+        [&](std::size_t set) {
+            if (cfg.clear_c)
+            {
+                MatrixBuffer::fill_parallel(rotation.sets[set].C, off.c.back(), 0.0f);
+            }
+        },
+        [&](std::size_t set) {
+            op->run_grouped(group.shapes.data(), a_ptrs[set].data(), b_ptrs[set].data(), c_ptrs[set].data(), count);
+        },
+        r);
+
+    const FlatOperands &last = rotation.sets[last_set];
+    if (last.C != group.C)
+    {
+        std::copy(last.C, last.C + off.c.back(), group.C);
+    }
     return r;
-}
\ No newline at end of file
+}
@@ -1,13 +1,110 @@
 #pragma once
-#define ITERATIONS 1
 
 #include <chrono>
 #include <cstring>
+#include <vector>
+
+#include "perf_counters.h"
+#include "stats.h"
+#include "ops/gemm_op.h"
+
+enum class CacheMode
+{
+    Hot,  // every iteration reuses the same, cache-resident operands
+    Cold, // caches are evicted before every timed iteration
+};
+
+enum class ColdStrategy
+{
+    Flush,  // stream over an LLC-sized scratch buffer between iterations
+    Rotate, // cycle through enough copies of A/B/C to exceed the LLC
+};
+
+// How bench_gemm_batched hands the batch to the op.
+enum class BatchInterface
+{
+    Strided,      // GemmOp::run_strided_batched
+    PointerArray, // GemmOp::run_batched
+};
+
+struct BenchConfig
+{
+    int warmup = 3;           // untimed runs before sampling (page faults, icache, pools)
+    int min_iterations = 10;  // timed runs collected at least
+    int max_iterations = 1000;
+    double min_time_ms = 200; // keep sampling until this much time was measured
+    bool until_stable = false; // additionally wait for cv <= target_cv
+    double target_cv = 0.02;
+    CacheMode cache_mode = CacheMode::Hot;
+    ColdStrategy cold_strategy = ColdStrategy::Flush;
+    bool perf_counters = false; // read hardware counters around every timed run
+    bool clear_c = false;       // zero C before every run (ops overwrite C, so off by default)
+    bool prepack_b = false;     // call GemmOp::pack_b before timing (B as constant weights)
+    BatchInterface batch_interface = BatchInterface::Strided; // entry point used by bench_gemm_batched
+    bool quiet = false;         // no "Benchmarking operator" line (many short runs, e.g. autotuning)
+};
+
 struct BenchResult
 {
-    double ms;
+    double ms; // median iteration time, the headline number
+    SampleStats stats;
+    std::vector<double> samples_ms;
+    int warmup = 0;
+    bool stable = false; // cv <= target_cv when sampling stopped
+    CacheMode cache_mode = CacheMode::Hot;
+    PerfSummary perf; // filled when BenchConfig::perf_counters is set
+    // Untimed-loop costs: GemmOp::prepare and pack_b, and the first run after
+    // them (first-call latency is prepare_ms + pack_b_ms + first_run_ms).
+    double prepare_ms = 0.0;
+    double pack_b_ms = 0.0;
+    double first_run_ms = 0.0;
+    bool b_prepacked = false;        // pack_b was requested and supported
+    std::size_t workspace_bytes = 0; // GemmOp::workspace_size after prepare
+    int batch = 1; // GEMMs per timed iteration; ms / batch is the per-GEMM latency
+    int groups = 0; // problems per grouped iteration (bench_gemm_grouped)
+    double flops = 0.0; // nominal FLOPs of one timed iteration, 2*M*N*K summed over its GEMMs
+};
+
+const char *cache_mode_name(CacheMode mode);
+
+// batch GEMMs of one M x N x K shape with dense row-major operands stored
+// back to back: entry i of A starts at A + i * M * K, and likewise for B, C.
+struct GemmBatch
+{
+    int M = 0;
+    int N = 0;
+    int K = 0;
+    int batch = 1;
+    const float *A = nullptr;
+    const float *B = nullptr;
+    float *C = nullptr;
 };
 
-BenchResult bench_gemm(class GemmOp *op,
+// Grouped GEMM: one problem per shape, with dense row-major operands stored
+// back to back in shape order (offsets from grouped_offsets).
+struct GemmGroup
+{
+    std::vector<GemmShape> shapes;
+    const float *A = nullptr;
+    const float *B = nullptr;
+    float *C = nullptr;
+};
+
+// Dense operands in the op's layout (row-major unless op->columnMajor()).
+BenchResult bench_gemm(GemmOp *op,
                        const float *A, const float *B, float *C,
-                       int M, int N, int K);
\ No newline at end of file
+                       int M, int N, int K,
+                       const BenchConfig &cfg = BenchConfig{});
+
+// Strided/transposed operands with alpha and beta, through GemmOp::run_strided.
+BenchResult bench_gemm(GemmOp *op, const GemmArgs &args,
+                       const BenchConfig &cfg = BenchConfig{});
+
+// One timed iteration runs the whole batch through run_strided_batched or
+// run_batched (BenchConfig::batch_interface).
+BenchResult bench_gemm_batched(GemmOp *op, const GemmBatch &batch,
+                               const BenchConfig &cfg = BenchConfig{});
+
+// One timed iteration is one GemmOp::run_grouped call over every group.
+BenchResult bench_gemm_grouped(GemmOp *op, const GemmGroup &group,
+                               const BenchConfig &cfg = BenchConfig{});
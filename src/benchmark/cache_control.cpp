@@ -0,0 +1,157 @@
+#include "cache_control.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr std::size_t kFallbackLlcBytes = 32u * 1024u * 1024u;
+constexpr std::size_t kFallbackL2Bytes = 1024u * 1024u;
+constexpr std::size_t kCacheLineFloats = 64 / sizeof(float);
+
+// Parses sysfs sizes such as "32768K" or "30M".
+std::size_t parse_cache_size(const std::string &text)
+{
+    std::size_t value = 0;
+    std::size_t pos = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+    {
+        value = value * 10 + static_cast<std::size_t>(text[pos] - '0');
+        ++pos;
+    }
+    if (pos < text.size())
+    {
+        if (text[pos] == 'K')
+            value *= 1024;
+        else if (text[pos] == 'M')
+            value *= 1024 * 1024;
+    }
+    return value;
+}
+
+std::size_t llc_from_sysfs()
+{
+    std::size_t best = 0;
+    int best_level = 0;
+    for (int index = 0; index < 16; ++index)
+    {
+        const std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream level_file(dir + "level");
+        std::ifstream size_file(dir + "size");
+        std::ifstream type_file(dir + "type");
+        if (!level_file || !size_file)
+        {
+            break;
+        }
+        int level = 0;
+        std::string size_text, type;
+        level_file >> level;
+        size_file >> size_text;
+        type_file >> type;
+        if (type == "Instruction")
+        {
+            continue;
+        }
+        if (level > best_level || (level == best_level && parse_cache_size(size_text) > best))
+        {
+            best_level = level;
+            best = parse_cache_size(size_text);
+        }
+    }
+    return best;
+}
+
+std::size_t l2_from_sysfs()
+{
+    for (int index = 0; index < 16; ++index)
+    {
+        const std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream level_file(dir + "level");
+        std::ifstream size_file(dir + "size");
+        std::ifstream type_file(dir + "type");
+        if (!level_file || !size_file)
+        {
+            break;
+        }
+        int level = 0;
+        std::string size_text, type;
+        level_file >> level;
+        size_file >> size_text;
+        type_file >> type;
+        if (level == 2 && type != "Instruction")
+        {
+            return parse_cache_size(size_text);
+        }
+    }
+    return 0;
+}
+} // namespace
+
+std::size_t llc_size_bytes()
+{
+    static const std::size_t bytes = []() {
+        std::size_t detected = 0;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+        const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (l3 > 0)
+        {
+            detected = static_cast<std::size_t>(l3);
+        }
+#endif
+        if (detected == 0)
+        {
+            detected = llc_from_sysfs();
+        }
+        return detected > 0 ? detected : kFallbackLlcBytes;
+    }();
+    return bytes;
+}
+
+std::size_t l2_size_bytes()
+{
+    static const std::size_t bytes = []() {
+        std::size_t detected = 0;
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+        const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (l2 > 0)
+        {
+            detected = static_cast<std::size_t>(l2);
+        }
+#endif
+        if (detected == 0)
+        {
+            detected = l2_from_sysfs();
+        }
+        return detected > 0 ? detected : kFallbackL2Bytes;
+    }();
+    return bytes;
+}
+
+CacheFlusher::CacheFlusher(int threads)
+    : scratch_(MatrixBuffer::allocate(
+          std::max(2 * llc_size_bytes(), static_cast<std::size_t>(std::max(threads, 1)) * 2 * l2_size_bytes()) /
+              sizeof(float),
+          64))
+{
+}
+
+void CacheFlusher::flush(int part, int parts)
+{
+    const std::size_t lines = scratch_.size() / kCacheLineFloats;
+    const std::size_t begin = lines * static_cast<std::size_t>(part) / static_cast<std::size_t>(parts);
+    const std::size_t end = lines * static_cast<std::size_t>(part + 1) / static_cast<std::size_t>(parts);
+    float *data = scratch_.data();
+    float acc = 0.0f;
+    // Touch one element per cache line and dirty it, so the lines must also
+    // be written back before they can be reused by the next iteration.
+    for (std::size_t line = begin; line < end; ++line)
+    {
+        acc += data[line * kCacheLineFloats];
+        data[line * kCacheLineFloats] = acc;
+    }
+}
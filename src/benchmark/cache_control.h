@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../common/matrix_buffer.h"
+
+// Size of the last-level cache in bytes as reported by the OS, or a
+// conservative 32 MiB when it cannot be determined.
+std::size_t llc_size_bytes();
+
+// Size of one core's L2 data cache in bytes, or 1 MiB when unknown.
+std::size_t l2_size_bytes();
+
+// Evicts the data caches by streaming a read-modify-write pass over a scratch
+// buffer several times larger than the LLC. The buffer is allocated once so
+// flushing between iterations costs only memory bandwidth.
+//
+// Private L1/L2 caches are only evicted by their own core, so with threads > 1
+// every thread streams its own slice, flush(part, threads), sized to at least
+// twice the L2; together the slices still cover 2x the LLC.
+class CacheFlusher
+{
+public:
+    explicit CacheFlusher(int threads = 1);
+
+    void flush(int part = 0, int parts = 1);
+
+private:
+    MatrixBuffer scratch_;
+};
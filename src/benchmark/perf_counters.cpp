@@ -0,0 +1,293 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *perf_event_name(PerfEvent event)
+{
+    switch (event)
+    {
+    case kPerfCycles:
+        return "cycles";
+    case kPerfInstructions:
+        return "instructions";
+    case kPerfL1dMisses:
+        return "l1d_misses";
+    case kPerfLlcMisses:
+        return "llc_misses";
+    case kPerfDtlbMisses:
+        return "dtlb_misses";
+    case kPerfFpOps:
+        return "fp_ops";
+    default:
+        return "unknown";
+    }
+}
+
+#if defined(__linux__)
+
+namespace
+{
+struct EventSpec
+{
+    PerfEvent event;
+    std::uint32_t type;
+    std::uint64_t config;
+    double weight; // multiplier applied before summing into event
+};
+
+std::uint64_t hw_cache_config(std::uint64_t cache, std::uint64_t op, std::uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+
+bool is_intel_cpu()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line))
+    {
+        if (line.rfind("vendor_id", 0) == 0)
+        {
+            return line.find("GenuineIntel") != std::string::npos;
+        }
+    }
+    return false;
+}
+
+std::string paranoid_level()
+{
+    std::ifstream file("/proc/sys/kernel/perf_event_paranoid");
+    std::string value;
+    file >> value;
+    return value.empty() ? "unknown" : value;
+}
+
+std::vector<std::vector<EventSpec>> event_groups()
+{
+    std::vector<std::vector<EventSpec>> groups;
+    groups.push_back({
+        {kPerfCycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 1.0},
+        {kPerfInstructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 1.0},
+    });
+    groups.push_back({
+        {kPerfL1dMisses, PERF_TYPE_HW_CACHE,
+         hw_cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), 1.0},
+        {kPerfLlcMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 1.0},
+        {kPerfDtlbMisses, PERF_TYPE_HW_CACHE,
+         hw_cache_config(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), 1.0},
+    });
+    if (is_intel_cpu())
+    {
+        // FP_ARITH_INST_RETIRED (event 0xC7): single-precision umasks weighted
+        // by lanes. FMA instructions already count twice in hardware.
+        groups.push_back({
+            {kPerfFpOps, PERF_TYPE_RAW, 0x02c7, 1.0},  // scalar single
+            {kPerfFpOps, PERF_TYPE_RAW, 0x08c7, 4.0},  // 128-bit packed single
+            {kPerfFpOps, PERF_TYPE_RAW, 0x20c7, 8.0},  // 256-bit packed single
+            {kPerfFpOps, PERF_TYPE_RAW, 0x80c7, 16.0}, // 512-bit packed single
+        });
+    }
+    return groups;
+}
+
+int open_event(const EventSpec &spec, int thread, int group_fd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.disabled = group_fd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, thread, -1, group_fd, 0));
+}
+} // namespace
+
+struct PerfCounters::Group
+{
+    int leader = -1;
+    std::vector<int> fds;
+    std::vector<EventSpec> specs;
+
+    ~Group()
+    {
+        for (int fd : fds)
+        {
+            close(fd);
+        }
+    }
+};
+
+PerfCounters::PerfCounters(const std::vector<int> &other_threads)
+{
+    std::string first_error;
+    const auto specs_per_group = event_groups();
+    // pid 0 is the calling thread.
+    std::vector<int> threads{0};
+    threads.insert(threads.end(), other_threads.begin(), other_threads.end());
+    for (int thread : threads)
+    {
+        bool opened = false;
+        for (const auto &specs : specs_per_group)
+        {
+            auto group = std::make_unique<Group>();
+            for (const auto &spec : specs)
+            {
+                const int fd = open_event(spec, thread, group->leader);
+                if (fd < 0)
+                {
+                    if (first_error.empty())
+                    {
+                        first_error = std::string(perf_event_name(spec.event)) + ": " + std::strerror(errno);
+                    }
+                    continue;
+                }
+                if (group->leader == -1)
+                {
+                    group->leader = fd;
+                }
+                group->fds.push_back(fd);
+                group->specs.push_back(spec);
+            }
+            if (group->leader != -1)
+            {
+                groups_.push_back(std::move(group));
+                opened = true;
+            }
+        }
+        threads_ += opened ? 1 : 0;
+    }
+
+    if (!first_error.empty())
+    {
+        status_ = "some counters unavailable (" + first_error +
+                  "; kernel.perf_event_paranoid=" + paranoid_level() + ")";
+    }
+    if (groups_.empty())
+    {
+        status_ = "perf_event_open failed (" + first_error +
+                  "; kernel.perf_event_paranoid=" + paranoid_level() + ")";
+    }
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start()
+{
+    for (auto &g : groups_)
+    {
+        ioctl(g->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(g->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+PerfSample PerfCounters::stop()
+{
+    for (auto &g : groups_)
+    {
+        ioctl(g->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    PerfSample sample;
+    for (auto &g : groups_)
+    {
+        // Layout: nr, time_enabled, time_running, value[nr].
+        std::vector<std::uint64_t> buf(3 + g->fds.size());
+        const auto bytes = static_cast<ssize_t>(buf.size() * sizeof(std::uint64_t));
+        if (read(g->leader, buf.data(), static_cast<std::size_t>(bytes)) != bytes || buf[2] == 0)
+        {
+            continue;
+        }
+        const double scale = static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+        for (std::size_t i = 0; i < g->specs.size() && i < buf[0]; ++i)
+        {
+            const EventSpec &spec = g->specs[i];
+            sample.values[spec.event] += static_cast<double>(buf[3 + i]) * scale * spec.weight;
+            sample.valid[spec.event] = true;
+        }
+    }
+    return sample;
+}
+
+#else
+
+struct PerfCounters::Group
+{
+};
+
+PerfCounters::PerfCounters(const std::vector<int> & /*other_threads*/)
+    : status_("hardware counters require Linux perf_event_open")
+{
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start()
+{
+}
+
+PerfSample PerfCounters::stop()
+{
+    return PerfSample{};
+}
+
+#endif
+
+PerfSummary summarize_perf(const std::vector<PerfSample> &samples, double nominal_flops,
+                           int counted_threads, int op_threads)
+{
+    PerfSummary summary;
+    summary.enabled = true;
+    summary.threads = counted_threads;
+    summary.partial = counted_threads < op_threads;
+    if (samples.empty())
+    {
+        return summary;
+    }
+
+    for (int e = 0; e < kPerfEventCount; ++e)
+    {
+        double sum = 0.0;
+        bool valid = true;
+        for (const auto &s : samples)
+        {
+            sum += s.values[e];
+            valid = valid && s.valid[e];
+        }
+        summary.mean.values[e] = valid ? sum / static_cast<double>(samples.size()) : 0.0;
+        summary.mean.valid[e] = valid;
+        summary.available = summary.available || valid;
+    }
+
+    const auto &m = summary.mean;
+    const double cycles = m.valid[kPerfCycles] ? m.values[kPerfCycles] : 0.0;
+    const double instructions = m.valid[kPerfInstructions] ? m.values[kPerfInstructions] : 0.0;
+    if (cycles > 0.0)
+    {
+        summary.ipc = instructions / cycles;
+        summary.flops_per_cycle = summary.partial ? 0.0 : nominal_flops / cycles;
+        if (m.valid[kPerfFpOps])
+        {
+            summary.fp_ops_per_cycle = m.values[kPerfFpOps] / cycles;
+        }
+    }
+    if (instructions > 0.0)
+    {
+        summary.l1d_mpki = m.values[kPerfL1dMisses] * 1000.0 / instructions;
+        summary.llc_mpki = m.values[kPerfLlcMisses] * 1000.0 / instructions;
+        summary.dtlb_mpki = m.values[kPerfDtlbMisses] * 1000.0 / instructions;
+    }
+    return summary;
+}
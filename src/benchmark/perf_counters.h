@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum PerfEvent
+{
+    kPerfCycles,
+    kPerfInstructions,
+    kPerfL1dMisses,
+    kPerfLlcMisses,
+    kPerfDtlbMisses,
+    kPerfFpOps, // FP_ARITH_INST_RETIRED weighted by vector lanes (Intel only)
+    kPerfEventCount
+};
+
+const char *perf_event_name(PerfEvent event);
+
+// Counter values of one measured interval. Counts are scaled for
+// multiplexing; valid is false for events that could not be opened.
+struct PerfSample
+{
+    std::array<double, kPerfEventCount> values{};
+    std::array<bool, kPerfEventCount> valid{};
+};
+
+// Per-iteration averages plus derived metrics, as reported in BenchResult.
+struct PerfSummary
+{
+    bool enabled = false;   // requested by the caller
+    bool available = false; // at least one counter could be opened
+    std::string status;     // reason when counters are missing
+    int threads = 0;        // threads whose counts are summed
+    bool partial = false;   // fewer threads than the op runs on
+    PerfSample mean;        // average counts per timed iteration, summed over threads
+    double ipc = 0.0;
+    double l1d_mpki = 0.0;  // misses per 1000 instructions
+    double llc_mpki = 0.0;
+    double dtlb_mpki = 0.0;
+    double flops_per_cycle = 0.0;    // nominal 2*M*N*K / cycles; not set when partial
+    double fp_ops_per_cycle = 0.0;   // retired FP operations / cycles
+};
+
+// Grouped hardware counters for the calling thread and the given other
+// threads (OS thread ids, e.g. GemmOp::worker_thread_ids()), opened through
+// perf_event_open(2) and summed over the threads. Events are opened in small
+// groups (core, cache, FP) per thread so each group fits the PMU and is
+// scheduled atomically. Failing events are skipped; if none can be opened,
+// available() is false and status() explains why (typically
+// kernel.perf_event_paranoid).
+class PerfCounters
+{
+public:
+    explicit PerfCounters(const std::vector<int> &other_threads = {});
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available() const { return !groups_.empty(); }
+    const std::string &status() const { return status_; }
+    // Threads with at least one open counter group.
+    int threads() const { return threads_; }
+
+    void start();
+    PerfSample stop();
+
+private:
+    struct Group;
+    std::vector<std::unique_ptr<Group>> groups_;
+    std::string status_;
+    int threads_ = 0;
+};
+
+// op_threads is the number of threads the op runs on; when counters covered
+// fewer (counted_threads), the summary is marked partial and
+// flops_per_cycle, which would divide all FLOPs by a subset of the cycles,
+// is left out.
+PerfSummary summarize_perf(const std::vector<PerfSample> &samples, double nominal_flops,
+                           int counted_threads = 1, int op_threads = 1);
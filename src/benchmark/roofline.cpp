@@ -0,0 +1,403 @@
+#include "roofline.h"
+#include "cache_control.h"
+#include "../common/matrix_buffer.h"
+#include "../common/thread_pool.h"
+#include "ops/cpu_features.h"
+#include "ops/gemm_kernels.h"
+#include "ops/tuning_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(GEMMBENCH_X86_KERNELS)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+// Independent accumulators per loop: enough to cover FMA latency times the
+// number of FMA ports on current cores (4 cycles x 2 ports).
+constexpr int kChains = 12;
+constexpr int kRepeats = 5;
+constexpr double kTargetMs = 20.0;
+
+// acc = acc * x + y converges to y / (1 - x) = 1, so values stay normal.
+constexpr float kX = 0.9999999f;
+constexpr float kY = 1e-7f;
+
+using FmaLoop = float (*)(long iterations);
+
+float scalar_fma_loop(long iterations)
+{
+    float acc[kChains];
+    for (int c = 0; c < kChains; ++c)
+    {
+        acc[c] = 0.01f * static_cast<float>(c);
+    }
+    for (long it = 0; it < iterations; ++it)
+    {
+        for (int c = 0; c < kChains; ++c)
+        {
+            acc[c] = acc[c] * kX + kY;
+        }
+    }
+    float sum = 0.0f;
+    for (int c = 0; c < kChains; ++c)
+    {
+        sum += acc[c];
+    }
+    return sum;
+}
+
+#if defined(GEMMBENCH_X86_KERNELS)
+GEMMBENCH_TARGET("sse4.2")
+float sse_fma_loop(long iterations)
+{
+    // No FMA: a multiply and an add, which issue on separate ports.
+    __m128 acc[kChains];
+    for (int c = 0; c < kChains; ++c)
+    {
+        acc[c] = _mm_set1_ps(0.01f * static_cast<float>(c));
+    }
+    const __m128 x = _mm_set1_ps(kX);
+    const __m128 y = _mm_set1_ps(kY);
+    for (long it = 0; it < iterations; ++it)
+    {
+        for (int c = 0; c < kChains; ++c)
+        {
+            acc[c] = _mm_add_ps(_mm_mul_ps(acc[c], x), y);
+        }
+    }
+    __m128 sum = acc[0];
+    for (int c = 1; c < kChains; ++c)
+    {
+        sum = _mm_add_ps(sum, acc[c]);
+    }
+    return _mm_cvtss_f32(sum);
+}
+
+GEMMBENCH_TARGET("avx2,fma")
+float avx2_fma_loop(long iterations)
+{
+    __m256 acc[kChains];
+    for (int c = 0; c < kChains; ++c)
+    {
+        acc[c] = _mm256_set1_ps(0.01f * static_cast<float>(c));
+    }
+    const __m256 x = _mm256_set1_ps(kX);
+    const __m256 y = _mm256_set1_ps(kY);
+    for (long it = 0; it < iterations; ++it)
+    {
+        for (int c = 0; c < kChains; ++c)
+        {
+            acc[c] = _mm256_fmadd_ps(acc[c], x, y);
+        }
+    }
+    __m256 sum = acc[0];
+    for (int c = 1; c < kChains; ++c)
+    {
+        sum = _mm256_add_ps(sum, acc[c]);
+    }
+    return _mm256_cvtss_f32(sum);
+}
+
+GEMMBENCH_TARGET("avx512f")
+float avx512_fma_loop(long iterations)
+{
+    __m512 acc[kChains];
+    for (int c = 0; c < kChains; ++c)
+    {
+        acc[c] = _mm512_set1_ps(0.01f * static_cast<float>(c));
+    }
+    const __m512 x = _mm512_set1_ps(kX);
+    const __m512 y = _mm512_set1_ps(kY);
+    for (long it = 0; it < iterations; ++it)
+    {
+        for (int c = 0; c < kChains; ++c)
+        {
+            acc[c] = _mm512_fmadd_ps(acc[c], x, y);
+        }
+    }
+    __m512 sum = acc[0];
+    for (int c = 1; c < kChains; ++c)
+    {
+        sum = _mm512_add_ps(sum, acc[c]);
+    }
+    return _mm512_reduce_add_ps(sum);
+}
+#endif
+
+struct FmaVariant
+{
+    const char *isa;
+    FmaLoop loop;
+    int lanes;
+};
+
+// Same preference order as best_gemm_kernel(), so the peak matches the
+// instructions the SIMD ops actually run.
+FmaVariant best_fma_variant()
+{
+#if defined(GEMMBENCH_X86_KERNELS)
+    const CpuFeatures &f = cpu_features();
+    if (f.avx512f)
+    {
+        return {"avx512f", avx512_fma_loop, 16};
+    }
+    if (f.avx2 && f.fma)
+    {
+        return {"avx2+fma", avx2_fma_loop, 8};
+    }
+    if (f.sse42)
+    {
+        return {"sse4.2", sse_fma_loop, 4};
+    }
+#endif
+    return {"scalar", scalar_fma_loop, 1};
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+std::atomic<float> g_sink{0.0f};
+
+std::vector<std::string> split_tabs(const std::string &line)
+{
+    std::vector<std::string> out;
+    std::string item;
+    std::istringstream in(line);
+    while (std::getline(in, item, '\t'))
+    {
+        out.push_back(item);
+    }
+    return out;
+}
+
+std::string peaks_key(const std::string &host, int threads)
+{
+    return host + "\t" + std::to_string(threads);
+}
+
+// Cache file: host <TAB> threads <TAB> peak_gflops <TAB> bandwidth_gbs <TAB> isa.
+std::map<std::string, MachinePeaks> load_peaks(const std::string &path)
+{
+    std::map<std::string, MachinePeaks> entries;
+    std::ifstream in(path);
+    std::string line;
+    int line_no = 0;
+    while (in && std::getline(in, line))
+    {
+        ++line_no;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        const std::vector<std::string> fields = split_tabs(line);
+        MachinePeaks p;
+        try
+        {
+            if (fields.size() != 5)
+            {
+                throw std::invalid_argument("expected 5 tab-separated fields");
+            }
+            p.threads = std::stoi(fields[1]);
+            p.peak_gflops = std::stod(fields[2]);
+            p.bandwidth_gbs = std::stod(fields[3]);
+            p.isa = fields[4];
+        }
+        catch (const std::exception &e)
+        {
+            throw std::runtime_error("Malformed peaks cache " + path + " line " + std::to_string(line_no) + ": " +
+                                     e.what());
+        }
+        entries[peaks_key(fields[0], p.threads)] = p;
+    }
+    return entries;
+}
+
+void save_peaks(const std::string &path, const std::map<std::string, MachinePeaks> &entries)
+{
+    const auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        std::filesystem::create_directories(parent);
+    }
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out)
+        {
+            throw std::runtime_error("Cannot write peaks cache " + tmp);
+        }
+        out << "# gemmbench machine peaks: host\tthreads\tpeak_gflops\tbandwidth_gbs\tisa\n";
+        for (const auto &kv : entries)
+        {
+            char numbers[64];
+            std::snprintf(numbers, sizeof(numbers), "%.2f\t%.2f", kv.second.peak_gflops, kv.second.bandwidth_gbs);
+            out << kv.first << '\t' << numbers << '\t' << kv.second.isa << '\n';
+        }
+        if (!out)
+        {
+            throw std::runtime_error("Cannot write peaks cache " + tmp);
+        }
+    }
+    std::filesystem::rename(tmp, path);
+}
+} // namespace
+
+double measure_peak_gflops(int threads)
+{
+    const FmaVariant variant = best_fma_variant();
+    // Calibrate on one thread so a timed run lasts about kTargetMs.
+    long iterations = 1 << 12;
+    for (;;)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        g_sink = g_sink + variant.loop(iterations);
+        if (elapsed_ms(t0) >= kTargetMs / 4 || iterations > (1L << 40))
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+    iterations *= 4;
+
+    const double flops_per_thread = 2.0 * kChains * variant.lanes * static_cast<double>(iterations);
+    ThreadPool pool(threads);
+    double best = 0.0;
+    for (int r = 0; r < kRepeats; ++r)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        pool.run([&](int, int) { g_sink = g_sink + variant.loop(iterations); });
+        const double ms = elapsed_ms(t0);
+        best = std::max(best, flops_per_thread * pool.size() / (ms * 1e6));
+    }
+    return best;
+}
+
+double measure_triad_bandwidth(int threads)
+{
+    // Each array at least twice the LLC, so the triad streams from DRAM.
+    const std::size_t bytes = std::max<std::size_t>(2 * llc_size_bytes(), 32u << 20);
+    const std::size_t n = bytes / sizeof(float);
+    MatrixBuffer a = MatrixBuffer::allocate_uninitialized(n);
+    MatrixBuffer b = MatrixBuffer::allocate_uninitialized(n);
+    MatrixBuffer c = MatrixBuffer::allocate_uninitialized(n);
+    ThreadPool pool(threads);
+    float *pa = a.data();
+    float *pb = b.data();
+    float *pc = c.data();
+
+    // Static partition, identical in every pass, so each thread first-touches
+    // the pages it later streams.
+    pool.run([&](int tid, int nt) {
+        const std::size_t begin = n * static_cast<std::size_t>(tid) / static_cast<std::size_t>(nt);
+        const std::size_t end = n * static_cast<std::size_t>(tid + 1) / static_cast<std::size_t>(nt);
+        std::fill(pa + begin, pa + end, 0.0f);
+        std::fill(pb + begin, pb + end, 1.0f);
+        std::fill(pc + begin, pc + end, 2.0f);
+    });
+
+    const float s = 0.5f;
+    double best = 0.0;
+    for (int r = 0; r < kRepeats + 1; ++r)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        pool.run([&](int tid, int nt) {
+            const std::size_t begin = n * static_cast<std::size_t>(tid) / static_cast<std::size_t>(nt);
+            const std::size_t end = n * static_cast<std::size_t>(tid + 1) / static_cast<std::size_t>(nt);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                pa[i] = pb[i] + s * pc[i];
+            }
+        });
+        const double ms = elapsed_ms(t0);
+        if (r > 0) // the first pass also faults in the TLB entries
+        {
+            best = std::max(best, 3.0 * static_cast<double>(bytes) / (ms * 1e6));
+        }
+    }
+    g_sink = g_sink + pa[n / 2];
+    return best;
+}
+
+std::string peaks_cache_path()
+{
+    const char *env = std::getenv("GEMMBENCH_PEAKS_CACHE");
+    return env != nullptr && *env != '\0' ? std::string(env) : user_cache_path("peaks.tsv");
+}
+
+MachinePeaks machine_peaks(int threads, bool remeasure)
+{
+    threads = std::max(threads, 1);
+    const std::string path = peaks_cache_path();
+    const std::string key = peaks_key(host_signature(), threads);
+    std::map<std::string, MachinePeaks> entries;
+    try
+    {
+        entries = load_peaks(path);
+    }
+    catch (const std::exception &e)
+    {
+        // The file only caches measurements, so measuring again and
+        // rewriting it repairs the cache.
+        std::fprintf(stderr, "Ignoring peaks cache: %s\n", e.what());
+    }
+    if (!remeasure)
+    {
+        const auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            return it->second;
+        }
+    }
+
+    MachinePeaks p;
+    p.threads = threads;
+    p.isa = best_fma_variant().isa;
+    p.peak_gflops = measure_peak_gflops(threads);
+    p.bandwidth_gbs = measure_triad_bandwidth(threads);
+    entries[key] = p;
+    save_peaks(path, entries);
+    return p;
+}
+
+double gemm_traffic_bytes(const GemmShape &shape, bool read_c)
+{
+    const double m = std::max(shape.M, 0);
+    const double n = std::max(shape.N, 0);
+    const double k = std::max(shape.K, 0);
+    return sizeof(float) * (m * k + k * n + (read_c ? 2.0 : 1.0) * m * n);
+}
+
+Roofline roofline(const MachinePeaks &peaks, double flops, double bytes, double achieved_gflops)
+{
+    Roofline r;
+    if (peaks.peak_gflops <= 0.0 || peaks.bandwidth_gbs <= 0.0 || bytes <= 0.0)
+    {
+        return r;
+    }
+    r.available = true;
+    r.threads = peaks.threads;
+    r.bytes = bytes;
+    r.intensity = flops / bytes;
+    r.peak_gflops = peaks.peak_gflops;
+    r.bandwidth_gbs = peaks.bandwidth_gbs;
+    const double memory_roof = r.intensity * peaks.bandwidth_gbs;
+    r.memory_bound = memory_roof < peaks.peak_gflops;
+    r.attainable_gflops = std::min(peaks.peak_gflops, memory_roof);
+    r.pct_of_peak = 100.0 * achieved_gflops / peaks.peak_gflops;
+    r.pct_of_attainable = 100.0 * achieved_gflops / r.attainable_gflops;
+    return r;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+
+#include "../common/gemm_shape.h"
+
+// Hardware ceilings of this host at a given thread count, measured by
+// built-in micro-benchmarks.
+struct MachinePeaks
+{
+    int threads = 1;
+    double peak_gflops = 0.0;   // fp32 FMA throughput of the widest usable vector ISA
+    double bandwidth_gbs = 0.0; // STREAM triad bandwidth (a = b + s * c), 12 bytes per element
+    std::string isa;            // ISA the FMA loop ran with
+};
+
+// Times independent FMA chains on threads threads; the best of several runs.
+double measure_peak_gflops(int threads);
+// Times a triad over arrays several times the LLC, first touched by the
+// threads that stream them; the best of several runs.
+double measure_triad_bandwidth(int threads);
+
+// Peaks for threads, from the per-host cache ($GEMMBENCH_PEAKS_CACHE or
+// user_cache_path("peaks.tsv")) when present, otherwise measured and stored.
+// remeasure ignores and replaces the cached entry. A malformed cache file is
+// reported on stderr, treated as empty and rewritten with the new measurement.
+MachinePeaks machine_peaks(int threads, bool remeasure = false);
+std::string peaks_cache_path();
+
+// Where one measured result sits under the roofline min(peak, AI * bandwidth).
+struct Roofline
+{
+    bool available = false;
+    int threads = 1;
+    double bytes = 0.0;     // compulsory memory traffic of one iteration
+    double intensity = 0.0; // FLOPs per byte of that traffic
+    double peak_gflops = 0.0;
+    double bandwidth_gbs = 0.0;
+    double attainable_gflops = 0.0; // the roofline bound at this intensity
+    bool memory_bound = false;      // intensity * bandwidth < peak
+    double pct_of_peak = 0.0;       // achieved / peak_gflops
+    double pct_of_attainable = 0.0; // achieved / attainable_gflops
+};
+
+// Compulsory traffic of one GEMM: A and B read once and C written once, plus
+// read when read_c (beta != 0). Operands that stay in cache across
+// iterations (hot runs of small shapes) can beat the memory roof.
+double gemm_traffic_bytes(const GemmShape &shape, bool read_c = false);
+
+Roofline roofline(const MachinePeaks &peaks, double flops, double bytes, double achieved_gflops);
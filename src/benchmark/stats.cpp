@@ -0,0 +1,109 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+double percentile_sorted(const std::vector<double> &samples, double pct)
+{
+    if (samples.empty())
+    {
+        throw std::invalid_argument("percentile of empty sample set");
+    }
+    const double rank = std::clamp(pct, 0.0, 100.0) / 100.0 * static_cast<double>(samples.size() - 1);
+    const auto lo = static_cast<std::size_t>(std::floor(rank));
+    const auto hi = std::min(lo + 1, samples.size() - 1);
+    const double frac = rank - static_cast<double>(lo);
+    return samples[lo] + (samples[hi] - samples[lo]) * frac;
+}
+
+SampleStats compute_stats(std::vector<double> samples)
+{
+    SampleStats s{};
+    if (samples.empty())
+    {
+        return s;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (double v : samples)
+    {
+        sum += v;
+    }
+    s.mean = sum / static_cast<double>(samples.size());
+
+    double sq = 0.0;
+    for (double v : samples)
+    {
+        sq += (v - s.mean) * (v - s.mean);
+    }
+    s.stddev = samples.size() > 1 ? std::sqrt(sq / static_cast<double>(samples.size() - 1)) : 0.0;
+    s.cv = s.mean > 0.0 ? s.stddev / s.mean : 0.0;
+
+    s.min = samples.front();
+    s.max = samples.back();
+    s.median = percentile_sorted(samples, 50.0);
+    s.p90 = percentile_sorted(samples, 90.0);
+    s.p99 = percentile_sorted(samples, 99.0);
+    return s;
+}
+
+RankTest mann_whitney_greater(const std::vector<double> &a, const std::vector<double> &b)
+{
+    RankTest t;
+    if (a.empty() || b.empty())
+    {
+        return t;
+    }
+    // Pool both samples (second = from b) and rank them, ties sharing the
+    // average rank.
+    std::vector<std::pair<double, bool>> pooled;
+    pooled.reserve(a.size() + b.size());
+    for (double v : a)
+    {
+        pooled.emplace_back(v, false);
+    }
+    for (double v : b)
+    {
+        pooled.emplace_back(v, true);
+    }
+    std::sort(pooled.begin(), pooled.end());
+
+    const double n = static_cast<double>(pooled.size());
+    double rank_sum_b = 0.0;
+    double tie_term = 0.0;
+    for (std::size_t i = 0; i < pooled.size();)
+    {
+        std::size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first)
+        {
+            ++j;
+        }
+        const double ties = static_cast<double>(j - i);
+        const double rank = (static_cast<double>(i + 1) + static_cast<double>(j)) / 2.0;
+        for (std::size_t k = i; k < j; ++k)
+        {
+            if (pooled[k].second)
+            {
+                rank_sum_b += rank;
+            }
+        }
+        tie_term += ties * ties * ties - ties;
+        i = j;
+    }
+
+    const double na = static_cast<double>(a.size());
+    const double nb = static_cast<double>(b.size());
+    t.u = rank_sum_b - nb * (nb + 1.0) / 2.0;
+    const double mean = na * nb / 2.0;
+    const double var = na * nb / 12.0 * ((n + 1.0) - tie_term / (n * (n - 1.0)));
+    if (var <= 0.0)
+    {
+        return t; // every value tied
+    }
+    t.z = (t.u - mean - 0.5) / std::sqrt(var);
+    t.p_value = 0.5 * std::erfc(t.z / std::sqrt(2.0));
+    return t;
+}
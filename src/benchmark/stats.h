@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+struct SampleStats
+{
+    double min;
+    double median;
+    double mean;
+    double p90;
+    double p99;
+    double max;
+    double stddev; // sample standard deviation (n - 1)
+    double cv;     // stddev / mean
+};
+
+// Percentile in [0, 100] with linear interpolation between closest ranks.
+// samples must be sorted ascending and non-empty.
+double percentile_sorted(const std::vector<double> &samples, double pct);
+
+SampleStats compute_stats(std::vector<double> samples);
+
+struct RankTest
+{
+    double u = 0.0;       // Mann-Whitney U of b: pairs (a_i, b_j) with b_j > a_i, ties counting 1/2
+    double z = 0.0;
+    double p_value = 1.0; // one-sided, H1: values in b tend to be larger than in a
+};
+
+// Mann-Whitney U test with the tie- and continuity-corrected normal
+// approximation; reasonable from about 8 samples per side. Makes no
+// assumption about the shape of the distributions, which for timings are
+// skewed and often multimodal.
+RankTest mann_whitney_greater(const std::vector<double> &a, const std::vector<double> &b);
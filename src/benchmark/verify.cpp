@@ -1,9 +1,184 @@
 #include "verify.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cmath>
 #include <limits>
 #include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common/thread_pool.h"
+#include "ops/cpu_features.h"
+#include "ops/gemm_kernels.h"
+
+#if defined(GEMMBENCH_X86_KERNELS)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+// Elements per parallel_for chunk and per vectorized block inside a chunk.
+constexpr std::size_t kVerifyGrain = 256 * 1024;
+constexpr std::size_t kVerifyBlock = 1024;
+
+struct VerifyPartial
+{
+    double max_abs_error = 0.0;
+    double max_rel_error = 0.0;
+    std::size_t mismatch_index = std::numeric_limits<std::size_t>::max();
+};
+
+// Max errors of one block, folded into max_abs / max_rel; returns whether
+// any element exceeds atol + rtol * |expected|. NaN errors are skipped, like
+// std::max(acc, err) in the scalar loop, and never count as mismatches.
+using VerifyBlockFn = bool (*)(const float *expected, const float *actual, std::size_t n,
+                               double atol, double rtol, double &max_abs, double &max_rel);
+
+bool scalar_verify_block(const float *expected, const float *actual, std::size_t n,
+                         double atol, double rtol, double &max_abs, double &max_rel)
+{
+    bool bad = false;
+    for (std::size_t idx = 0; idx < n; ++idx)
+    {
+        const double exp_val = expected[idx];
+        const double abs_err = std::abs(exp_val - static_cast<double>(actual[idx]));
+        const double mag = std::abs(exp_val);
+        const double rel_err = abs_err / (mag + 1e-12);
+        max_abs = std::max(max_abs, abs_err);
+        max_rel = std::max(max_rel, rel_err);
+        bad |= abs_err > atol + rtol * mag;
+    }
+    return bad;
+}
+
+#if defined(GEMMBENCH_X86_KERNELS)
+// The accumulators never hold NaN, so the lanes reduce in any order.
+double horizontal_max(const double *lanes, int count)
+{
+    double m = lanes[0];
+    for (int i = 1; i < count; ++i)
+    {
+        m = std::max(m, lanes[i]);
+    }
+    return m;
+}
+
+// max_pd returns its second operand when either is NaN, so max(err, acc)
+// keeps the accumulator for NaN errors; the ordered compare is false for NaN.
+GEMMBENCH_TARGET("sse2")
+bool sse2_verify_block(const float *expected, const float *actual, std::size_t n,
+                       double atol, double rtol, double &max_abs, double &max_rel)
+{
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d eps = _mm_set1_pd(1e-12);
+    const __m128d vatol = _mm_set1_pd(atol);
+    const __m128d vrtol = _mm_set1_pd(rtol);
+    __m128d vabs = _mm_set1_pd(max_abs);
+    __m128d vrel = _mm_set1_pd(max_rel);
+    __m128d vbad = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 e4 = _mm_loadu_ps(expected + i);
+        const __m128 a4 = _mm_loadu_ps(actual + i);
+        for (int half = 0; half < 2; ++half)
+        {
+            const __m128d e = _mm_cvtps_pd(half == 0 ? e4 : _mm_movehl_ps(e4, e4));
+            const __m128d a = _mm_cvtps_pd(half == 0 ? a4 : _mm_movehl_ps(a4, a4));
+            const __m128d abs_err = _mm_andnot_pd(sign, _mm_sub_pd(e, a));
+            const __m128d mag = _mm_andnot_pd(sign, e);
+            vabs = _mm_max_pd(abs_err, vabs);
+            vrel = _mm_max_pd(_mm_div_pd(abs_err, _mm_add_pd(mag, eps)), vrel);
+            vbad = _mm_or_pd(vbad, _mm_cmpgt_pd(abs_err, _mm_add_pd(vatol, _mm_mul_pd(vrtol, mag))));
+        }
+    }
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, vabs);
+    max_abs = horizontal_max(lanes, 2);
+    _mm_store_pd(lanes, vrel);
+    max_rel = horizontal_max(lanes, 2);
+    const bool bad = _mm_movemask_pd(vbad) != 0;
+    return scalar_verify_block(expected + i, actual + i, n - i, atol, rtol, max_abs, max_rel) || bad;
+}
+
+GEMMBENCH_TARGET("avx2")
+bool avx2_verify_block(const float *expected, const float *actual, std::size_t n,
+                       double atol, double rtol, double &max_abs, double &max_rel)
+{
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d eps = _mm256_set1_pd(1e-12);
+    const __m256d vatol = _mm256_set1_pd(atol);
+    const __m256d vrtol = _mm256_set1_pd(rtol);
+    __m256d vabs = _mm256_set1_pd(max_abs);
+    __m256d vrel = _mm256_set1_pd(max_rel);
+    __m256d vbad = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256d e = _mm256_cvtps_pd(_mm_loadu_ps(expected + i));
+        const __m256d a = _mm256_cvtps_pd(_mm_loadu_ps(actual + i));
+        const __m256d abs_err = _mm256_andnot_pd(sign, _mm256_sub_pd(e, a));
+        const __m256d mag = _mm256_andnot_pd(sign, e);
+        vabs = _mm256_max_pd(abs_err, vabs);
+        vrel = _mm256_max_pd(_mm256_div_pd(abs_err, _mm256_add_pd(mag, eps)), vrel);
+        vbad = _mm256_or_pd(vbad, _mm256_cmp_pd(abs_err, _mm256_add_pd(vatol, _mm256_mul_pd(vrtol, mag)),
+                                                _CMP_GT_OQ));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, vabs);
+    max_abs = horizontal_max(lanes, 4);
+    _mm256_store_pd(lanes, vrel);
+    max_rel = horizontal_max(lanes, 4);
+    const bool bad = _mm256_movemask_pd(vbad) != 0;
+    return scalar_verify_block(expected + i, actual + i, n - i, atol, rtol, max_abs, max_rel) || bad;
+}
+#endif
+
+// The compiler does not vectorize the NaN-ignoring max reductions on its own,
+// so the block loop is written with intrinsics. Doubles, mul + add (no FMA)
+// and the same comparisons keep every result identical to the scalar loop.
+VerifyBlockFn best_verify_block()
+{
+#if defined(GEMMBENCH_X86_KERNELS)
+    if (cpu_features().avx2)
+    {
+        return avx2_verify_block;
+    }
+    return sse2_verify_block;
+#else
+    return scalar_verify_block;
+#endif
+}
+
+// Mismatches are only flagged per block; blocks that contain one are
+// rescanned to locate the first index.
+void verify_range(const float *expected, const float *actual, std::size_t begin, std::size_t end,
+                  double atol, double rtol, VerifyPartial &out)
+{
+    static const VerifyBlockFn verify_block = best_verify_block();
+    for (std::size_t block = begin; block < end; block += kVerifyBlock)
+    {
+        const std::size_t block_end = std::min(end, block + kVerifyBlock);
+        const bool bad = verify_block(expected + block, actual + block, block_end - block, atol, rtol,
+                                      out.max_abs_error, out.max_rel_error);
+
+        if (bad && out.mismatch_index == std::numeric_limits<std::size_t>::max())
+        {
+            for (std::size_t idx = block; idx < block_end; ++idx)
+            {
+                const double exp_val = expected[idx];
+                const double abs_err = std::abs(exp_val - static_cast<double>(actual[idx]));
+                if (abs_err > atol + rtol * std::abs(exp_val))
+                {
+                    out.mismatch_index = idx;
+                    break;
+                }
+            }
+        }
+    }
+}
+} // namespace
 
 VerifyResult verify_result(const float *expected,
                            const float *actual,
@@ -30,35 +205,157 @@ VerifyResult verify_result(const float *expected,
     result.mismatch_abs_error = 0.0;
     result.mismatch_rel_error = 0.0;
 
-    for (std::size_t idx = 0; idx < total; ++idx)
+    // One partial per chunk; max is order independent and the earliest
+    // mismatch wins, so the merged result equals a serial scan.
+    auto &pool = ThreadPool::shared();
+    std::vector<VerifyPartial> partials(static_cast<std::size_t>(pool.size()));
+    pool.parallel_for(total, kVerifyGrain, [&](std::size_t begin, std::size_t end, int tid) {
+        verify_range(expected, actual, begin, end, atol, rtol, partials[static_cast<std::size_t>(tid)]);
+    });
+
+    for (const auto &part : partials)
     {
+        result.max_abs_error = std::max(result.max_abs_error, part.max_abs_error);
+        result.max_rel_error = std::max(result.max_rel_error, part.max_rel_error);
+        result.mismatch_index = std::min(result.mismatch_index, part.mismatch_index);
+    }
+
+    if (result.mismatch_index != std::numeric_limits<std::size_t>::max())
+    {
+        const std::size_t idx = result.mismatch_index;
         const float exp_val = expected[idx];
         const float act_val = actual[idx];
-        const double abs_err = std::abs(static_cast<double>(exp_val) - static_cast<double>(act_val));
-        const double rel_err = abs_err / (std::abs(static_cast<double>(exp_val)) + 1e-12);
+        result.ok = false;
+        result.mismatch_row = static_cast<int>(idx / static_cast<std::size_t>(N));
+        result.mismatch_col = static_cast<int>(idx % static_cast<std::size_t>(N));
+        result.expected_value = exp_val;
+        result.actual_value = act_val;
+        result.mismatch_abs_error = std::abs(static_cast<double>(exp_val) - static_cast<double>(act_val));
+        result.mismatch_rel_error = result.mismatch_abs_error / (std::abs(static_cast<double>(exp_val)) + 1e-12);
+    }
 
-        if (abs_err > result.max_abs_error)
-        {
-            result.max_abs_error = abs_err;
-        }
-        if (rel_err > result.max_rel_error)
+    return result;
+}
+
+namespace
+{
+constexpr int kFreivaldsMaxTrials = 16;
+constexpr std::size_t kFreivaldsRowGrain = 64;
+
+// splitmix64 finalizer: a stateless hash, so sign j of trial t is the same no
+// matter which thread asks for it.
+std::uint64_t mix64(std::uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// For every row r of the rows x cols matrix M: out[r * trials + t] = M_r . x_t
+// (x laid out as [cols][trials]) and abs_out[r] = |M_r| . abs_x.
+void rows_times_vectors(const float *mat, int rows, int cols, const double *x, const double *abs_x,
+                        int trials, double *out, double *abs_out)
+{
+    ThreadPool::shared().parallel_for(static_cast<std::size_t>(rows), kFreivaldsRowGrain,
+                                      [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t r = begin; r < end; ++r)
         {
-            result.max_rel_error = rel_err;
+            const float *row = mat + r * static_cast<std::size_t>(cols);
+            double acc[kFreivaldsMaxTrials] = {};
+            double abs_acc = 0.0;
+            for (int j = 0; j < cols; ++j)
+            {
+                const double v = row[j];
+                const double *xj = x + static_cast<std::size_t>(j) * trials;
+                for (int t = 0; t < trials; ++t)
+                {
+                    acc[t] += v * xj[t];
+                }
+                if (abs_out)
+                {
+                    abs_acc += std::abs(v) * abs_x[j];
+                }
+            }
+            std::copy(acc, acc + trials, out + r * trials);
+            if (abs_out)
+            {
+                abs_out[r] = abs_acc;
+            }
         }
+    });
+}
+} // namespace
+
+FreivaldsResult verify_freivalds(const float *A,
+                                 const float *B,
+                                 const float *C,
+                                 int M,
+                                 int N,
+                                 int K,
+                                 int trials,
+                                 std::uint64_t seed,
+                                 double slack)
+{
+    if (trials < 1 || trials > kFreivaldsMaxTrials)
+    {
+        throw std::invalid_argument("Freivalds trials must be in [1, " + std::to_string(kFreivaldsMaxTrials) + "]");
+    }
+    const std::size_t a_count = static_cast<std::size_t>(M) * static_cast<std::size_t>(K);
+    const std::size_t b_count = static_cast<std::size_t>(K) * static_cast<std::size_t>(N);
+    const std::size_t c_count = static_cast<std::size_t>(M) * static_cast<std::size_t>(N);
+    if ((a_count > 0 && !A) || (b_count > 0 && !B) || (c_count > 0 && !C))
+    {
+        throw std::runtime_error("Null matrix pointer provided for verification");
+    }
 
-        const double tolerance = atol + rtol * std::abs(static_cast<double>(exp_val));
-        if (abs_err > tolerance && result.ok)
+    FreivaldsResult result{};
+    result.ok = true;
+    result.trials = trials;
+    result.mismatch_row = -1;
+    result.mismatch_trial = -1;
+
+    // Random +-1 vectors, [N][trials]; |x| is all ones.
+    std::vector<double> x(static_cast<std::size_t>(N) * trials);
+    for (std::size_t i = 0; i < x.size(); ++i)
+    {
+        x[i] = (mix64(seed + i) >> 63) ? 1.0 : -1.0;
+    }
+    const std::vector<double> ones(static_cast<std::size_t>(std::max(N, 1)), 1.0);
+
+    // bx = B x and |B| |x|, then abx = A (B x), a_bound = |A| (|B| |x|).
+    std::vector<double> bx(static_cast<std::size_t>(K) * trials);
+    std::vector<double> b_abs(static_cast<std::size_t>(K));
+    rows_times_vectors(B, K, N, x.data(), ones.data(), trials, bx.data(), b_abs.data());
+    std::vector<double> abx(static_cast<std::size_t>(M) * trials);
+    std::vector<double> bound(static_cast<std::size_t>(M));
+    rows_times_vectors(A, M, K, bx.data(), b_abs.data(), trials, abx.data(), bound.data());
+    std::vector<double> cx(static_cast<std::size_t>(M) * trials);
+    rows_times_vectors(C, M, N, x.data(), nullptr, trials, cx.data(), nullptr);
+
+    const double rounding = slack * std::sqrt(static_cast<double>(std::max(K, 1)) / std::max(N, 1)) *
+                            std::ldexp(1.0, -24);
+    for (int i = 0; i < M; ++i)
+    {
+        const double tolerance = rounding * bound[i];
+        for (int t = 0; t < trials; ++t)
         {
-            result.ok = false;
-            result.mismatch_index = idx;
-            result.mismatch_row = static_cast<int>(idx / static_cast<std::size_t>(N));
-            result.mismatch_col = static_cast<int>(idx % static_cast<std::size_t>(N));
-            result.expected_value = exp_val;
-            result.actual_value = act_val;
-            result.mismatch_abs_error = abs_err;
-            result.mismatch_rel_error = rel_err;
+            const std::size_t idx = static_cast<std::size_t>(i) * trials + t;
+            const double residual = std::abs(cx[idx] - abx[idx]);
+            result.max_residual = std::max(result.max_residual, residual);
+            if (bound[i] > 0.0)
+            {
+                result.max_rel_residual = std::max(result.max_rel_residual, residual / bound[i]);
+            }
+            // Written so that NaN residuals fail as well.
+            if (!(residual <= tolerance) && result.ok)
+            {
+                result.ok = false;
+                result.mismatch_row = i;
+                result.mismatch_trial = t;
+                result.mismatch_residual = residual;
+                result.mismatch_tolerance = tolerance;
+            }
         }
     }
-
     return result;
 }
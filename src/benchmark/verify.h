@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 struct VerifyResult
 {
@@ -22,3 +23,33 @@ VerifyResult verify_result(const float *expected,
                            int N,
                            double atol = 1e-4,
                            double rtol = 1e-3);
+
+struct FreivaldsResult
+{
+    bool ok;
+    int trials;
+    double max_residual;     // max |(C x)_i - (A (B x))_i| over rows and trials
+    double max_rel_residual; // same, divided by (|A| |B| |x|)_i
+    int mismatch_row;        // first failing row, -1 when ok
+    int mismatch_trial;
+    double mismatch_residual;
+    double mismatch_tolerance;
+};
+
+// Randomized check of C = A * B (row-major, no reference needed) in O(MK + KN
+// + MN): for `trials` random sign vectors x, compares C x with A (B x)
+// computed in double. A correct C differs only by float rounding: about
+// sqrt(K) * 2^-24 * sum_k |a_ik||b_kj| per element (probabilistic rounding
+// model), and the random signs of x add N of those like a random walk, so row i
+// tolerates slack * sqrt(K / N) * 2^-24 * (|A| |B| |x|)_i. A wrong C passes one
+// trial with probability at most 1/2. Wrong rows, columns, K blocks or single
+// elements off by much more than the row's rounding level are caught.
+FreivaldsResult verify_freivalds(const float *A,
+                                 const float *B,
+                                 const float *C,
+                                 int M,
+                                 int N,
+                                 int K,
+                                 int trials = 3,
+                                 std::uint64_t seed = 0x5eed,
+                                 double slack = 8.0);
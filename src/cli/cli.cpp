@@ -1,18 +1,767 @@
 #include "cli.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "CLI11.hpp"
 #include "../sample/sample_generator.h"
 #include "../sample/sample_io.h"
 #include "../sample/reference_gemm.h"
+#include "../common/transpose.h"
 #include "../ops/registry.h"
+#include "../benchmark/autotune.h"
 #include "../benchmark/benchmark.h"
+#include "../benchmark/roofline.h"
 #include "../benchmark/verify.h"
+#include "../output/compare.h"
+#include "../output/json_writer.h"
+
+namespace
+{
+// Copies the sample's row-major A and B into buffers laid out as requested by
+// the run options and returns the matching views. ld = 0 selects the dense
+// leading dimension; anything smaller is rejected.
+MatrixView make_operand(const float *src, int rows, int cols, bool trans, std::size_t ld, AllocPolicy policy,
+                        MatrixBuffer &storage)
+{
+    MatrixView v;
+    v.rows = trans ? cols : rows;
+    v.cols = trans ? rows : cols;
+    v.trans = trans;
+    v.ld = ld == 0 ? static_cast<std::size_t>(v.cols) : ld;
+    if (v.ld < static_cast<std::size_t>(v.cols))
+    {
+        throw std::invalid_argument("leading dimension " + std::to_string(v.ld) + " is smaller than " +
+                                    std::to_string(v.cols) + " columns");
+    }
+    storage = MatrixBuffer::allocate(v.storage_size(), 64, policy);
+    if (trans)
+    {
+        transpose(src, static_cast<std::size_t>(cols), storage.data(), v.ld, rows, cols);
+    }
+    else
+    {
+        for (int i = 0; i < rows; ++i)
+        {
+            std::copy(src + static_cast<std::size_t>(i) * cols, src + static_cast<std::size_t>(i + 1) * cols,
+                      storage.data() + static_cast<std::size_t>(i) * v.ld);
+        }
+    }
+    v.data = storage.data();
+    return v;
+}
+
+// Fixed non-zero C0 that strided runs with beta != 0 start from; values in [-1, 1).
+float initial_c(int i, int j)
+{
+    return static_cast<float>((i * 7 + j * 13) % 32 - 16) / 16.0f + 1.0f / 32.0f;
+}
+
+GemmArgs make_strided_args(const SampleData &sample, bool trans_a, bool trans_b,
+                           std::size_t lda, std::size_t ldb, std::size_t ldc, float alpha, float beta,
+                           AllocPolicy policy, MatrixBuffer &a_storage, MatrixBuffer &b_storage, MatrixBuffer &c_storage)
+{
+    const auto &cfg = sample.cfg;
+    GemmArgs args;
+    args.M = cfg.M;
+    args.N = cfg.N;
+    args.K = cfg.K;
+    args.A = make_operand(sample.A.data(), cfg.M, cfg.K, trans_a, lda, policy, a_storage);
+    args.B = make_operand(sample.B.data(), cfg.K, cfg.N, trans_b, ldb, policy, b_storage);
+    args.C.rows = cfg.M;
+    args.C.cols = cfg.N;
+    args.C.ld = ldc == 0 ? static_cast<std::size_t>(cfg.N) : ldc;
+    if (args.C.ld < static_cast<std::size_t>(cfg.N))
+    {
+        throw std::invalid_argument("ldc " + std::to_string(args.C.ld) + " is smaller than N");
+    }
+    c_storage = MatrixBuffer::allocate(args.C.storage_size(), 64, policy);
+    args.C.data = c_storage.data();
+    args.alpha = alpha;
+    args.beta = beta;
+    if (beta != 0.0f)
+    {
+        // beta * C must contribute to the result, so C starts non-zero.
+        for (int i = 0; i < cfg.M; ++i)
+        {
+            for (int j = 0; j < cfg.N; ++j)
+            {
+                args.C.at(i, j) = initial_c(i, j);
+            }
+        }
+    }
+    return args;
+}
+
+// Parses a comma-separated list of MxNxK shapes, e.g. "128x4096x1024,7x4096x1024".
+std::vector<GemmShape> parse_group_list(const std::string &list)
+{
+    std::vector<GemmShape> shapes;
+    std::size_t pos = 0;
+    while (pos <= list.size())
+    {
+        const std::size_t end = std::min(list.find(',', pos), list.size());
+        const std::string item = list.substr(pos, end - pos);
+        GemmShape shape;
+        char x1 = 0;
+        char x2 = 0;
+        std::size_t used = 0;
+        try
+        {
+            std::size_t n = 0;
+            shape.M = std::stoi(item, &n);
+            used += n;
+            x1 = used < item.size() ? item[used++] : 0;
+            shape.N = std::stoi(item.substr(used), &n);
+            used += n;
+            x2 = used < item.size() ? item[used++] : 0;
+            shape.K = std::stoi(item.substr(used), &n);
+            used += n;
+        }
+        catch (const std::exception &)
+        {
+            used = 0;
+        }
+        if (used != item.size() || x1 != 'x' || x2 != 'x' || shape.M < 0 || shape.N <= 0 || shape.K <= 0)
+        {
+            throw std::invalid_argument("invalid group shape '" + item + "', expected MxNxK (M may be 0)");
+        }
+        shapes.push_back(shape);
+        pos = end + 1;
+    }
+    return shapes;
+}
+
+// Compacts the strided C into a dense row-major M x N buffer holding
+// (C - beta * C0) / alpha, which equals A * B when the op honoured both scalars.
+void unscale_strided_c(const MutableMatrixView &C, float alpha, float beta, float *dst)
+{
+    for (int i = 0; i < C.rows; ++i)
+    {
+        for (int j = 0; j < C.cols; ++j)
+        {
+            const float c0 = beta != 0.0f ? beta * initial_c(i, j) : 0.0f;
+            dst[static_cast<std::size_t>(i) * C.cols + j] = (C.at(i, j) - c0) / alpha;
+        }
+    }
+}
+
+int parse_size(const std::string &text, const std::string &spec)
+{
+    std::size_t used = 0;
+    int value = 0;
+    try
+    {
+        value = std::stoi(text, &used);
+    }
+    catch (const std::exception &)
+    {
+        used = 0;
+    }
+    if (text.empty() || used != text.size() || value <= 0)
+    {
+        throw std::invalid_argument("invalid size '" + text + "' in '" + spec + "'");
+    }
+    return value;
+}
+
+// Expands a size list such as "64,128,256", "64:512:64" (arithmetic range,
+// end inclusive) or "32:4096:*2" (geometric range); items can be mixed.
+std::vector<int> parse_size_list(const std::string &spec)
+{
+    constexpr std::size_t kMaxSizes = 4096;
+    std::vector<int> sizes;
+    std::size_t pos = 0;
+    while (pos <= spec.size())
+    {
+        const std::size_t end = std::min(spec.find(',', pos), spec.size());
+        const std::string item = spec.substr(pos, end - pos);
+        const std::size_t c1 = item.find(':');
+        if (c1 == std::string::npos)
+        {
+            sizes.push_back(parse_size(item, spec));
+        }
+        else
+        {
+            const std::size_t c2 = item.find(':', c1 + 1);
+            if (c2 == std::string::npos)
+            {
+                throw std::invalid_argument("range '" + item + "' needs start:end:step");
+            }
+            const int first = parse_size(item.substr(0, c1), spec);
+            const int last = parse_size(item.substr(c1 + 1, c2 - c1 - 1), spec);
+            std::string step = item.substr(c2 + 1);
+            const bool geometric = !step.empty() && step[0] == '*';
+            const int by = parse_size(geometric ? step.substr(1) : step, spec);
+            if (geometric && by < 2)
+            {
+                throw std::invalid_argument("geometric step in '" + item + "' must be at least 2");
+            }
+            for (long long v = first; v <= last && sizes.size() <= kMaxSizes; v = geometric ? v * by : v + by)
+            {
+                sizes.push_back(static_cast<int>(v));
+            }
+        }
+        if (sizes.size() > kMaxSizes)
+        {
+            throw std::invalid_argument("size list '" + spec + "' expands to more than 4096 sizes");
+        }
+        pos = end + 1;
+    }
+    return sizes;
+}
+
+std::vector<std::string> split_list(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::size_t pos = 0;
+    while (pos <= list.size())
+    {
+        const std::size_t end = std::min(list.find(',', pos), list.size());
+        if (end > pos)
+        {
+            items.push_back(list.substr(pos, end - pos));
+        }
+        pos = end + 1;
+    }
+    return items;
+}
+
+// Places the headline result under the roofline of peaks. Traffic counts
+// every group or batch entry; read_c when the op reads C (beta != 0).
+void annotate_roofline(RunReport &report, const MachinePeaks &peaks, bool read_c)
+{
+    const BenchResult &r = report.results.front();
+    double bytes = 0.0;
+    if (!report.group_shapes.empty())
+    {
+        for (const GemmShape &g : report.group_shapes)
+        {
+            bytes += gemm_traffic_bytes(g, read_c);
+        }
+    }
+    else
+    {
+        bytes = gemm_traffic_bytes(GemmShape{report.M, report.N, report.K}, read_c) * r.batch;
+    }
+    report.roofline = roofline(peaks, r.flops, bytes, report_gflops(report, r));
+}
+
+void print_roofline(const Roofline &rl)
+{
+    std::cout << "Roofline = " << rl.intensity << " FLOP/byte, attainable " << rl.attainable_gflops << " GFLOPS ("
+              << (rl.memory_bound ? "memory" : "compute") << " bound), " << rl.pct_of_attainable
+              << "% of attainable, " << rl.pct_of_peak << "% of peak\n";
+}
+
+// Problem sizes of the sweep and autotune subcommands.
+struct ShapeOptions
+{
+    std::string sizes;
+    std::string m_list;
+    std::string n_list;
+    std::string k_list;
+    std::string shapes;
+};
+
+// Options of the sweep subcommand, collected by cli_main.
+struct SweepOptions
+{
+    std::string ops = "all";
+    ShapeOptions shape;
+    int threads = 0;
+    std::string tuning_cache;
+    bool no_tuning = false;
+    bool no_roofline = false;
+    BenchConfig bench;
+    AllocPolicy alloc_policy = AllocPolicy::Default;
+    std::vector<CacheMode> modes;
+    std::string cache_mode = "hot";
+    std::string verify_mode = "freivalds";
+    int freivalds_trials = 3;
+    std::string output;
+};
+
+std::vector<GemmShape> option_shapes(const ShapeOptions &opt)
+{
+    std::vector<GemmShape> shapes;
+    if (!opt.shapes.empty())
+    {
+        shapes = parse_group_list(opt.shapes);
+        for (const GemmShape &s : shapes)
+        {
+            if (s.M <= 0)
+            {
+                throw std::invalid_argument("shapes need M > 0");
+            }
+        }
+    }
+    else if (!opt.sizes.empty())
+    {
+        for (int size : parse_size_list(opt.sizes))
+        {
+            shapes.push_back(GemmShape{size, size, size});
+        }
+    }
+    else if (!opt.m_list.empty() && !opt.n_list.empty() && !opt.k_list.empty())
+    {
+        // Every combination of the three lists, K varying fastest.
+        for (int m : parse_size_list(opt.m_list))
+        {
+            for (int n : parse_size_list(opt.n_list))
+            {
+                for (int k : parse_size_list(opt.k_list))
+                {
+                    shapes.push_back(GemmShape{m, n, k});
+                }
+            }
+        }
+    }
+    else
+    {
+        throw std::invalid_argument("give --sizes, --shapes, or all of --m/--n/--k");
+    }
+    return shapes;
+}
+
+// Runs every (shape, op) combination in this process. Operands are generated
+// in memory once per shape and shared by all ops, and op instances (with
+// their thread pools) live for the whole sweep.
+int run_sweep(const SweepOptions &opt)
+{
+    const auto sweep_start = std::chrono::steady_clock::now();
+    const std::vector<GemmShape> shapes = option_shapes(opt.shape);
+    const std::vector<std::string> op_names = opt.ops == "all" ? list_ops() : split_list(opt.ops);
+
+    std::vector<std::unique_ptr<GemmOp>> ops;
+    for (const auto &name : op_names)
+    {
+        ops.emplace_back(get_op(name));
+        if (!ops.back())
+        {
+            throw std::invalid_argument("operator not found: " + name);
+        }
+        if (opt.threads > 0)
+        {
+            ops.back()->set_num_threads(opt.threads);
+        }
+        ops.back()->set_use_tuning_cache(!opt.no_tuning);
+    }
+    // Measured up front (or read from the peaks cache) for every thread
+    // count in use, so the timed runs are not interleaved with micro-benchmarks.
+    std::map<int, MachinePeaks> peaks;
+    if (!opt.no_roofline)
+    {
+        for (const auto &op : ops)
+        {
+            if (peaks.find(op->num_threads()) == peaks.end())
+            {
+                peaks[op->num_threads()] = machine_peaks(op->num_threads());
+            }
+        }
+    }
+
+    // The operands are shared by every op, so first-touch placement follows
+    // the widest pool.
+    GemmOp *widest = nullptr;
+    for (const auto &op : ops)
+    {
+        if (widest == nullptr || op->num_threads() > widest->num_threads())
+        {
+            widest = op.get();
+        }
+    }
+    std::function<void(const ThreadPool::Job &)> touch_runner;
+    if (widest != nullptr)
+    {
+        touch_runner = [widest](const ThreadPool::Job &job) { widest->run_on_threads(job); };
+    }
+    const FirstTouchScope first_touch(touch_runner);
+
+    SweepReport sweep;
+    sweep.ops = op_names;
+    sweep.shapes = shapes.size();
+    sweep.threads = opt.threads;
+    sweep.cache_mode = opt.cache_mode;
+    sweep.verify_mode = opt.verify_mode;
+    bool all_verified = true;
+    const std::size_t total = shapes.size() * ops.size();
+    std::size_t done = 0;
+
+    for (const GemmShape &shape : shapes)
+    {
+        const int M = shape.M;
+        const int N = shape.N;
+        const int K = shape.K;
+        SampleConfig cfg;
+        cfg.M = M;
+        cfg.N = N;
+        cfg.K = K;
+        MatrixBuffer A = generate_matrix(M, K, 42, RANDOM, opt.alloc_policy);
+        MatrixBuffer B = generate_matrix(K, N, 1337, RANDOM, opt.alloc_policy);
+        MatrixBuffer reference;
+        if (opt.verify_mode == "full")
+        {
+            reference = compute_reference_c(cfg, A, B);
+        }
+        // Column-major copies, made on first use by a column-major op.
+        MatrixBuffer a_col;
+        MatrixBuffer b_col;
+        MatrixBuffer reference_col;
+        MatrixBuffer computed = MatrixBuffer::allocate(static_cast<std::size_t>(M) * static_cast<std::size_t>(N),
+                                                       MatrixBuffer::kDefaultAlignment, opt.alloc_policy);
+
+        for (std::size_t o = 0; o < ops.size(); ++o)
+        {
+            GemmOp *op = ops[o].get();
+            ++done;
+            try
+            {
+                const bool col_major = op->columnMajor();
+                if (col_major && a_col.empty())
+                {
+                    a_col = MatrixBuffer::allocate(A.size(), MatrixBuffer::kDefaultAlignment,
+                                                   opt.alloc_policy, MatrixInit::Uninitialized);
+                    b_col = MatrixBuffer::allocate(B.size(), MatrixBuffer::kDefaultAlignment,
+                                                   opt.alloc_policy, MatrixInit::Uninitialized);
+                    transpose(A.data(), static_cast<std::size_t>(K), a_col.data(), static_cast<std::size_t>(M), M, K);
+                    transpose(B.data(), static_cast<std::size_t>(N), b_col.data(), static_cast<std::size_t>(K), K, N);
+                    if (!reference.empty())
+                    {
+                        reference_col = MatrixBuffer::allocate_uninitialized(reference.size());
+                        transpose(reference.data(), static_cast<std::size_t>(N), reference_col.data(),
+                                  static_cast<std::size_t>(M), M, N);
+                    }
+                }
+                const float *a = col_major ? a_col.data() : A.data();
+                const float *b = col_major ? b_col.data() : B.data();
+                // A failing op must not inherit the previous op's result.
+                MatrixBuffer::fill_parallel(computed.data(), computed.size(), 0.0f);
+
+                RunReport report;
+                report.op = op_names[o];
+                report.M = M;
+                report.N = N;
+                report.K = K;
+                report.threads = op->num_threads();
+                report.alloc_policy = alloc_policy_name(computed.policy());
+                for (CacheMode mode : opt.modes)
+                {
+                    BenchConfig mode_cfg = opt.bench;
+                    mode_cfg.cache_mode = mode;
+                    report.results.push_back(bench_gemm(op, a, b, computed.data(), M, N, K, mode_cfg));
+                }
+                report.tuning = op->applied_tuning();
+                if (!opt.no_roofline)
+                {
+                    annotate_roofline(report, peaks[op->num_threads()], false);
+                }
+
+                report.verify_mode = opt.verify_mode;
+                if (opt.verify_mode == "full")
+                {
+                    const auto check = verify_result(col_major ? reference_col.data() : reference.data(),
+                                                     computed.data(), M, N);
+                    report.verified = check.ok;
+                    report.max_abs_error = check.max_abs_error;
+                    report.max_rel_error = check.max_rel_error;
+                }
+                else if (opt.verify_mode == "freivalds")
+                {
+                    // C^T = B^T * A^T, as in the run subcommand.
+                    const auto check = verify_freivalds(col_major ? b : a, col_major ? a : b, computed.data(),
+                                                        col_major ? N : M, col_major ? M : N, K,
+                                                        opt.freivalds_trials);
+                    report.verified = check.ok;
+                    report.verify_trials = check.trials;
+                    report.max_abs_error = check.max_residual;
+                    report.max_rel_error = check.max_rel_residual;
+                }
+                else
+                {
+                    report.verified = true;
+                }
+                all_verified = all_verified && report.verified;
+
+                const BenchResult &headline = report.results.front();
+                std::cout << "[" << done << "/" << total << "] " << report.op << " " << M << "x" << N << "x" << K
+                          << ": " << headline.ms << " ms, " << report_gflops(report, headline) << " GFLOPS"
+                          << (opt.verify_mode == "none" ? "" : (report.verified ? ", verified" : ", VERIFICATION FAILED"))
+                          << "\n";
+                sweep.runs.push_back(std::move(report));
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << "[" << done << "/" << total << "] " << op_names[o] << " " << M << "x" << N << "x" << K
+                          << " failed: " << ex.what() << "\n";
+                sweep.failures.push_back(SweepFailure{op_names[o], M, N, K, ex.what()});
+            }
+        }
+    }
+    sweep.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sweep_start).count();
+
+    // GFLOPS grid, one row per shape and one column per op.
+    std::cout << "\n" << std::left << std::setw(20) << "shape";
+    for (const auto &name : op_names)
+    {
+        std::cout << " " << std::right << std::setw(std::max<int>(10, static_cast<int>(name.size()))) << name;
+    }
+    std::cout << "\n";
+    for (const GemmShape &shape : shapes)
+    {
+        const std::string label = std::to_string(shape.M) + "x" + std::to_string(shape.N) + "x" + std::to_string(shape.K);
+        std::cout << std::left << std::setw(20) << label << std::right;
+        for (const auto &name : op_names)
+        {
+            const auto it = std::find_if(sweep.runs.begin(), sweep.runs.end(), [&](const RunReport &r) {
+                return r.op == name && r.M == shape.M && r.N == shape.N && r.K == shape.K;
+            });
+            std::ostringstream cell;
+            if (it != sweep.runs.end())
+            {
+                cell << std::fixed << std::setprecision(2) << report_gflops(*it, it->results.front());
+            }
+            else
+            {
+                cell << "-";
+            }
+            std::cout << " " << std::setw(std::max<int>(10, static_cast<int>(name.size()))) << cell.str();
+        }
+        std::cout << "\n";
+    }
+    std::cout << "Sweep of " << total << " runs took " << sweep.wall_ms / 1e3 << " s"
+              << (sweep.failures.empty() ? std::string() : ", " + std::to_string(sweep.failures.size()) + " failed")
+              << "\n";
+
+    if (!opt.output.empty())
+    {
+        std::ofstream ofs(opt.output);
+        if (!ofs)
+        {
+            throw std::runtime_error("cannot write " + opt.output);
+        }
+        write_sweep_report(ofs, sweep);
+        std::cout << "Saved sweep results to " << opt.output << "\n";
+    }
+    return all_verified ? 0 : 2;
+}
+
+// Options of the autotune subcommand, collected by cli_main.
+struct AutotuneOptions
+{
+    std::string ops = "all";
+    ShapeOptions shape;
+    int threads = 0;
+    std::string cache_file;
+    bool dry_run = false;
+    bool no_prune = false;
+    AutotuneConfig tune;
+};
+
+// Tunes every (shape, op) combination and stores the winners in the tuning
+// cache under the shape's bucket. Ops without tunables are skipped when
+// tuning "all" and rejected when named explicitly.
+int run_autotune(const AutotuneOptions &opt)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<GemmShape> shapes = option_shapes(opt.shape);
+    const bool all_ops = opt.ops == "all";
+    const std::vector<std::string> op_names = all_ops ? list_ops() : split_list(opt.ops);
+    TuningCache &cache = TuningCache::shared();
+    if (!opt.cache_file.empty())
+    {
+        cache.load(opt.cache_file);
+    }
+    // Saving over a cache that failed to parse would drop its other entries.
+    if (const std::string error = cache.load_error(); !error.empty())
+    {
+        throw std::runtime_error(error);
+    }
+    AutotuneConfig tune = opt.tune;
+    tune.prune_footprint = !opt.no_prune;
+
+    std::vector<std::unique_ptr<GemmOp>> ops;
+    std::vector<std::string> names;
+    for (const auto &name : op_names)
+    {
+        std::unique_ptr<GemmOp> op(get_op(name));
+        if (!op)
+        {
+            throw std::invalid_argument("operator not found: " + name);
+        }
+        if (op->tunables(shapes.front()).empty())
+        {
+            if (!all_ops)
+            {
+                throw std::invalid_argument("operator " + name + " has no tunable parameters on this host");
+            }
+            continue;
+        }
+        if (opt.threads > 0)
+        {
+            op->set_num_threads(opt.threads);
+        }
+        ops.push_back(std::move(op));
+        names.push_back(name);
+    }
+    if (ops.empty())
+    {
+        throw std::invalid_argument("no tunable operators selected");
+    }
+
+    const std::size_t total = shapes.size() * ops.size();
+    std::size_t done = 0;
+    std::size_t stored = 0;
+    bool all_verified = true;
+    for (const GemmShape &shape : shapes)
+    {
+        const int M = shape.M;
+        const int N = shape.N;
+        const int K = shape.K;
+        MatrixBuffer A = generate_matrix(M, K, 42);
+        MatrixBuffer B = generate_matrix(K, N, 1337);
+        MatrixBuffer C = MatrixBuffer::allocate(static_cast<std::size_t>(M) * static_cast<std::size_t>(N));
+        for (std::size_t o = 0; o < ops.size(); ++o)
+        {
+            GemmOp *op = ops[o].get();
+            ++done;
+            const std::string label = "[" + std::to_string(done) + "/" + std::to_string(total) + "] " + names[o] +
+                                      " " + std::to_string(M) + "x" + std::to_string(N) + "x" + std::to_string(K);
+            try
+            {
+                // Ops with tunables are row-major blocked drivers.
+                const AutotuneResult res = autotune_gemm(op, A.data(), B.data(), C.data(), M, N, K, tune);
+                // C holds the last measured configuration's result.
+                const auto check = verify_freivalds(A.data(), B.data(), C.data(), M, N, K, 3);
+                const double gflops = shape.flops() / (res.best_ms * 1e6);
+                std::cout << label << ": " << format_tuning_values(res.best) << " " << std::fixed
+                          << std::setprecision(2) << gflops << " GFLOPS, " << res.default_ms / res.best_ms
+                          << "x over defaults (" << res.searched << "/" << res.grid_size << " configs, "
+                          << res.rounds << " rounds, " << res.timed_runs << " timed runs)"
+                          << (check.ok ? "" : ", VERIFICATION FAILED") << "\n";
+                std::cout.unsetf(std::ios::floatfield);
+                if (!check.ok)
+                {
+                    all_verified = false;
+                    continue;
+                }
+                cache.store(op->name(), op->num_threads(), shape, TuningEntry{res.best, gflops});
+                ++stored;
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << label << " failed: " << ex.what() << "\n";
+            }
+        }
+    }
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Autotuning " << total << " combinations took " << wall_s << " s\n";
+    if (opt.dry_run)
+    {
+        std::cout << "Dry run: " << stored << " results not saved\n";
+    }
+    else if (stored > 0)
+    {
+        cache.save();
+        std::cout << "Saved " << stored << " results to " << cache.path() << " (" << cache.size()
+                  << " entries)\n";
+    }
+    return all_verified ? 0 : 2;
+}
+
+// Options of the compare subcommand, collected by cli_main.
+struct CompareOptions
+{
+    std::string baseline;
+    std::string candidate;
+    std::string output;
+    bool fail_on_missing = false;
+    CompareConfig compare;
+};
+
+// Shape and variant, shortened to the width of the problem column.
+std::string compare_label(const StoredResult &r)
+{
+    const std::string label = r.variant.empty() ? r.shape : r.shape + " " + r.variant;
+    return label.size() > 24 ? label.substr(0, 21) + "..." : label;
+}
+
+// Compares two result sets and returns 2 when a matched result regressed or,
+// with fail_on_missing, a baseline result has no counterpart.
+int run_compare(const CompareOptions &opt)
+{
+    const std::vector<StoredResult> baseline = load_result_set(opt.baseline);
+    const std::vector<StoredResult> candidate = load_result_set(opt.candidate);
+    const CompareReport report = compare_result_sets(baseline, candidate, opt.compare);
+    if (report.entries.empty())
+    {
+        throw std::runtime_error("no result in " + opt.candidate + " matches one in " + opt.baseline);
+    }
+
+    std::cout << std::left << std::setw(22) << "op" << " " << std::setw(24) << "problem" << " " << std::setw(7)
+              << "threads" << " " << std::setw(5) << "cache" << std::right << " " << std::setw(11) << "base ms"
+              << " " << std::setw(11) << "cand ms" << " " << std::setw(8) << "change" << " " << std::setw(9) << "p"
+              << "  verdict\n";
+    for (const CompareEntry &e : report.entries)
+    {
+        const StoredResult &b = *e.baseline;
+        char change[32];
+        std::snprintf(change, sizeof(change), "%+.1f%%", (e.ratio - 1.0) * 100.0);
+        std::ostringstream p;
+        if (e.verdict == CompareVerdict::Inconclusive)
+        {
+            p << "-";
+        }
+        else
+        {
+            p << std::setprecision(2) << (e.ratio >= 1.0 ? e.p_slower : e.p_faster);
+        }
+        std::cout << std::left << std::setw(22) << b.op << " " << std::setw(24) << compare_label(b) << " "
+                  << std::setw(7) << b.threads << " " << std::setw(5) << b.cache_mode << std::right << " "
+                  << std::setw(11) << b.median_ms << " " << std::setw(11) << e.candidate->median_ms << " "
+                  << std::setw(8) << change << " " << std::setw(9) << p.str() << "  "
+                  << (e.verdict == CompareVerdict::Regression ? "REGRESSION" : compare_verdict_name(e.verdict))
+                  << "\n";
+    }
+    for (const StoredResult *r : report.only_baseline)
+    {
+        std::cout << "Missing from candidate: " << r->op << " " << compare_label(*r) << " threads=" << r->threads
+                  << " " << r->cache_mode << "\n";
+    }
+    if (!report.only_candidate.empty())
+    {
+        std::cout << report.only_candidate.size() << " candidate results have no baseline\n";
+    }
+    std::cout << "Compared " << report.entries.size() << " results: " << report.regressions << " regressions, "
+              << report.improvements << " improvements, " << report.inconclusive << " inconclusive (fewer than "
+              << opt.compare.min_samples << " samples); alpha=" << opt.compare.alpha
+              << ", threshold=" << opt.compare.threshold * 100.0 << "%\n";
+
+    if (!opt.output.empty())
+    {
+        std::ofstream ofs(opt.output);
+        write_compare_report(ofs, report);
+        if (!ofs)
+        {
+            throw std::runtime_error("cannot write " + opt.output);
+        }
+        std::cout << "Saved comparison to " << opt.output << "\n";
+    }
+    const bool missing = opt.fail_on_missing && !report.only_baseline.empty();
+    return report.regressions > 0 || missing ? 2 : 0;
+}
+} // namespace
 
 int cli_main(int argc, char **argv)
 {
@@ -28,6 +777,34 @@ int cli_main(int argc, char **argv)
     std::string sample_in = sample_out;
     bool verbose = false;
     std::string verbose_matrix_file = "verbose_matrices.txt";
+    int num_threads = 0;
+    std::uint32_t sample_format = kSampleFormatV2;
+    bool compensated_reference = false;
+    bool no_reference = false;
+    std::string verify_mode = "auto";
+    int freivalds_trials = 3;
+    std::string load_mode = "mmap";
+    std::string alloc_str = "default";
+    BenchConfig bench_cfg;
+    std::string cache_mode_str = "hot";
+    std::string cold_strategy_str = "flush";
+    int batch = 1;
+    std::string batch_interface_str = "strided";
+    std::string group_list;
+    int experts = 0;
+    double expert_skew = 1.0;
+    bool trans_a = false;
+    bool trans_b = false;
+    std::size_t lda = 0;
+    std::size_t ldb = 0;
+    std::size_t ldc = 0;
+    float alpha = 1.0f;
+    float beta = 0.0f;
+    std::string tuning_cache;
+    bool no_tuning = false;
+    bool no_roofline = false;
+    bool remeasure = false;
+    std::string trace_path;
 
     // ---------- 子命令 generate ----------
     auto gen_cmd = app.add_subcommand("generate", "Generate test matrices");
@@ -38,6 +815,25 @@ int cli_main(int argc, char **argv)
         ->default_val("RANDOM");
     gen_cmd->add_option("--sample", sample_out, "Path to save the generated sample")
         ->capture_default_str();
+    gen_cmd->add_option("--format", sample_format, "Sample file format version (1 = legacy, 2 = aligned sections)")
+        ->check(CLI::IsMember({kSampleFormatV1, kSampleFormatV2}))
+        ->capture_default_str();
+    gen_cmd->add_option("--batch", batch, "Number of independent M x N x K problems stored in the sample (v2 only)")
+        ->check(CLI::Range(1, 1 << 20))
+        ->capture_default_str();
+    gen_cmd->add_option("--groups", group_list,
+                        "Grouped sample: comma-separated MxNxK shapes, one GEMM per group (v2 only)");
+    gen_cmd->add_option("--experts", experts,
+                        "Grouped MoE sample: route --m tokens over this many experts with --n x --k weights each (v2 only)")
+        ->check(CLI::Range(1, 1 << 20));
+    gen_cmd->add_option("--expert-skew", expert_skew,
+                        "Zipf exponent of the token routing for --experts (0 = uniform)")
+        ->check(CLI::Range(0.0, 8.0))
+        ->capture_default_str();
+    gen_cmd->add_flag("--compensated", compensated_reference,
+                      "Use Kahan-compensated fp64 accumulation for the reference C (slower, exact for very large K)");
+    gen_cmd->add_flag("--no-reference", no_reference,
+                      "Skip computing and storing C; run verifies such samples with Freivalds' check");
 
     // ---------- 子命令 run ----------
     auto run_cmd = app.add_subcommand("run", "Run GEMM benchmark");
@@ -46,10 +842,190 @@ int cli_main(int argc, char **argv)
     run_cmd->add_option("--sample", sample_in, "Path to load the sample from")
         ->capture_default_str();
 
+    run_cmd->add_option("--load", load_mode, "How to load the sample: mmap (zero-copy view of the file) or read (copy into memory)")
+        ->check(CLI::IsMember({"mmap", "read"}))
+        ->capture_default_str();
+
+    run_cmd->add_option("--alloc", alloc_str,
+                        "Allocation policy for matrices: default, thp (madvise hugepages), hugetlb (MAP_HUGETLB), "
+                        "interleave (across NUMA nodes) or first-touch (pages touched by the op's threads)")
+        ->check(CLI::IsMember({"default", "thp", "hugetlb", "interleave", "first-touch"}))
+        ->capture_default_str();
+
+    run_cmd->add_option("--threads", num_threads, "Worker threads for multithreaded operators (0 = GEMMBENCH_NUM_THREADS or all cores)")
+        ->capture_default_str();
+
+    run_cmd->add_option("--warmup", bench_cfg.warmup, "Untimed warmup iterations")
+        ->capture_default_str();
+    run_cmd->add_option("--min-iters", bench_cfg.min_iterations, "Minimum timed iterations")
+        ->capture_default_str();
+    run_cmd->add_option("--max-iters", bench_cfg.max_iterations, "Maximum timed iterations")
+        ->capture_default_str();
+    run_cmd->add_option("--min-time-ms", bench_cfg.min_time_ms, "Minimum total measured time in ms")
+        ->capture_default_str();
+    run_cmd->add_flag("--until-stable", bench_cfg.until_stable,
+                      "Keep iterating (up to --max-iters) until the coefficient of variation drops below --target-cv");
+    run_cmd->add_option("--target-cv", bench_cfg.target_cv, "Coefficient of variation treated as stable")
+        ->capture_default_str();
+    run_cmd->add_option("--cache", cache_mode_str, "Cache state per iteration: hot, cold or both (reported side by side)")
+        ->check(CLI::IsMember({"hot", "cold", "both"}))
+        ->capture_default_str();
+    run_cmd->add_option("--cold-strategy", cold_strategy_str,
+                        "How cold mode evicts caches: flush (stream an LLC-sized buffer) or rotate (cycle operand copies)")
+        ->check(CLI::IsMember({"flush", "rotate"}))
+        ->capture_default_str();
+
+    run_cmd->add_flag("--clear-c", bench_cfg.clear_c,
+                      "Zero C before every iteration (outside the timed region); only needed for ops that accumulate into C");
+
+    run_cmd->add_flag("--prepack-b", bench_cfg.prepack_b,
+                      "Pack B once before timing (GemmOp::pack_b), as for constant weights; its cost is reported as pack_b_ms");
+
+    run_cmd->add_option("--batch-interface", batch_interface_str,
+                        "Entry point for batched samples: strided (run_strided_batched) or array (run_batched with pointer arrays)")
+        ->check(CLI::IsMember({"strided", "array"}))
+        ->capture_default_str();
+
+    run_cmd->add_flag("--trans-a", trans_a, "Store A transposed (K x M) and pass it with the transpose flag");
+    run_cmd->add_flag("--trans-b", trans_b, "Store B transposed (N x K) and pass it with the transpose flag");
+    run_cmd->add_option("--lda", lda, "Leading dimension of the stored A (0 = dense)")->capture_default_str();
+    run_cmd->add_option("--ldb", ldb, "Leading dimension of the stored B (0 = dense)")->capture_default_str();
+    run_cmd->add_option("--ldc", ldc, "Leading dimension of C (0 = dense)")->capture_default_str();
+    run_cmd->add_option("--alpha", alpha, "Scale of A * B (non-zero)")->capture_default_str();
+    run_cmd->add_option("--beta", beta, "Scale of the incoming C; C is zeroed before every iteration when non-zero")
+        ->capture_default_str();
+
+    run_cmd->add_option("--tuning-cache", tuning_cache,
+                        "Tuning cache consulted by the op at prepare time (default: $GEMMBENCH_TUNING_CACHE or "
+                        "~/.cache/gemmbench/tuning.tsv)");
+    run_cmd->add_flag("--no-tuning", no_tuning, "Run with the built-in parameters, ignoring the tuning cache");
+    run_cmd->add_flag("--no-roofline", no_roofline,
+                      "Skip the roofline annotation (and measuring the machine peaks on first use)");
+    run_cmd->add_option("--trace", trace_path,
+                        "Record a timeline of the op internals (packing, compute, barriers per thread) and write it "
+                        "as Chrome trace-event JSON, viewable in Perfetto");
+
+    run_cmd->add_flag("--perf", bench_cfg.perf_counters,
+                      "Collect hardware counters (cycles, instructions, cache/TLB misses, FP ops) via perf_event_open");
+
+    run_cmd->add_option("--verify", verify_mode,
+                        "Result check: full (compare with the stored C), freivalds (randomized O(n^2) check, no reference needed) or auto")
+        ->check(CLI::IsMember({"auto", "full", "freivalds"}))
+        ->capture_default_str();
+    run_cmd->add_option("--freivalds-trials", freivalds_trials, "Random vectors used by --verify freivalds")
+        ->check(CLI::Range(1, 16))
+        ->capture_default_str();
+
     run_cmd->add_option("--verbose", verbose, "Enable matrix printout for debugging");
     run_cmd->add_option("--verbose-matrix-file", verbose_matrix_file, "File to save verbose matrix output")
         ->capture_default_str();
 
+    // ---------- 子命令 sweep ----------
+    SweepOptions sweep_opt;
+    auto sweep_cmd = app.add_subcommand("sweep", "Benchmark ops over many sizes in one process, with in-memory operands");
+    sweep_cmd->add_option("--ops", sweep_opt.ops, "Comma-separated operator names, or all")->capture_default_str();
+    sweep_cmd->add_option("--sizes", sweep_opt.shape.sizes,
+                          "Square sizes M=N=K: list and/or ranges, e.g. 64,96 or 64:512:64 or 32:4096:*2");
+    sweep_cmd->add_option("--m", sweep_opt.shape.m_list, "M sizes (same syntax); with --n and --k sweeps every combination");
+    sweep_cmd->add_option("--n", sweep_opt.shape.n_list, "N sizes (same syntax)");
+    sweep_cmd->add_option("--k", sweep_opt.shape.k_list, "K sizes (same syntax)");
+    sweep_cmd->add_option("--shapes", sweep_opt.shape.shapes, "Explicit MxNxK shapes, comma-separated");
+    sweep_cmd->add_option("--threads", sweep_opt.threads, "Worker threads for multithreaded operators (0 = default)")
+        ->capture_default_str();
+    sweep_cmd->add_option("--alloc", alloc_str, "Allocation policy for matrices (see run --alloc)")
+        ->check(CLI::IsMember({"default", "thp", "hugetlb", "interleave", "first-touch"}))
+        ->capture_default_str();
+    sweep_cmd->add_option("--warmup", sweep_opt.bench.warmup, "Untimed warmup iterations")->capture_default_str();
+    sweep_cmd->add_option("--min-iters", sweep_opt.bench.min_iterations, "Minimum timed iterations")->capture_default_str();
+    sweep_cmd->add_option("--max-iters", sweep_opt.bench.max_iterations, "Maximum timed iterations")->capture_default_str();
+    sweep_cmd->add_option("--min-time-ms", sweep_opt.bench.min_time_ms, "Minimum total measured time in ms per run")
+        ->capture_default_str();
+    sweep_cmd->add_flag("--until-stable", sweep_opt.bench.until_stable, "Iterate until --target-cv is reached");
+    sweep_cmd->add_option("--target-cv", sweep_opt.bench.target_cv, "Coefficient of variation treated as stable")
+        ->capture_default_str();
+    sweep_cmd->add_option("--cache", sweep_opt.cache_mode, "Cache state per iteration: hot, cold or both")
+        ->check(CLI::IsMember({"hot", "cold", "both"}))
+        ->capture_default_str();
+    sweep_cmd->add_option("--cold-strategy", cold_strategy_str, "How cold mode evicts caches: flush or rotate")
+        ->check(CLI::IsMember({"flush", "rotate"}))
+        ->capture_default_str();
+    sweep_cmd->add_option("--verify", sweep_opt.verify_mode,
+                          "Result check per run: freivalds, full (computes a reference per shape) or none")
+        ->check(CLI::IsMember({"freivalds", "full", "none"}))
+        ->capture_default_str();
+    sweep_cmd->add_option("--freivalds-trials", sweep_opt.freivalds_trials, "Random vectors used by --verify freivalds")
+        ->check(CLI::Range(1, 16))
+        ->capture_default_str();
+    sweep_cmd->add_option("--output", sweep_opt.output, "Consolidated JSON file with every run");
+    sweep_cmd->add_option("--tuning-cache", sweep_opt.tuning_cache,
+                          "Tuning cache consulted by the ops (default: $GEMMBENCH_TUNING_CACHE or "
+                          "~/.cache/gemmbench/tuning.tsv)");
+    sweep_cmd->add_flag("--no-tuning", sweep_opt.no_tuning, "Run with the built-in parameters, ignoring the tuning cache");
+    sweep_cmd->add_flag("--no-roofline", sweep_opt.no_roofline,
+                        "Skip the roofline annotation (and measuring the machine peaks on first use)");
+
+    // ---------- 子命令 autotune ----------
+    AutotuneOptions tune_opt;
+    auto tune_cmd = app.add_subcommand("autotune", "Search blocking parameters per shape and store the winners in the tuning cache");
+    tune_cmd->add_option("--ops", tune_opt.ops, "Comma-separated operator names, or all (every op with tunables)")
+        ->capture_default_str();
+    tune_cmd->add_option("--sizes", tune_opt.shape.sizes, "Square sizes M=N=K (sweep syntax)");
+    tune_cmd->add_option("--m", tune_opt.shape.m_list, "M sizes; with --n and --k tunes every combination");
+    tune_cmd->add_option("--n", tune_opt.shape.n_list, "N sizes");
+    tune_cmd->add_option("--k", tune_opt.shape.k_list, "K sizes");
+    tune_cmd->add_option("--shapes", tune_opt.shape.shapes, "Explicit MxNxK shapes, comma-separated");
+    tune_cmd->add_option("--threads", tune_opt.threads, "Worker threads for multithreaded operators (0 = default)")
+        ->capture_default_str();
+    tune_cmd->add_option("--tuning-cache", tune_opt.cache_file,
+                         "Cache file to update (default: $GEMMBENCH_TUNING_CACHE or ~/.cache/gemmbench/tuning.tsv)");
+    tune_cmd->add_option("--eta", tune_opt.tune.eta, "Successive halving keeps the best 1/eta configs per round")
+        ->check(CLI::Range(2, 16))
+        ->capture_default_str();
+    tune_cmd->add_option("--initial-iters", tune_opt.tune.initial_iterations,
+                         "Timed runs per config in the first round (times eta in every later round)")
+        ->check(CLI::Range(1, 1000))
+        ->capture_default_str();
+    tune_cmd->add_option("--final-iters", tune_opt.tune.final_iterations,
+                         "Timed runs when re-measuring the winner against the defaults")
+        ->check(CLI::Range(1, 1000))
+        ->capture_default_str();
+    tune_cmd->add_option("--max-configs", tune_opt.tune.max_configs,
+                         "Search an evenly spaced subset of at most this many configs (0 = all)")
+        ->capture_default_str();
+    tune_cmd->add_flag("--no-prune", tune_opt.no_prune, "Also time blockings whose packed blocks overflow L2 / the LLC");
+    tune_cmd->add_flag("--dry-run", tune_opt.dry_run, "Report the winners without writing the cache");
+
+    // ---------- 子命令 peaks ----------
+    auto peaks_cmd = app.add_subcommand("peaks", "Show (measuring on first use) the FMA and memory bandwidth peaks of this host");
+    peaks_cmd->add_option("--threads", num_threads, "Threads for the whole-machine figures (0 = default)")
+        ->capture_default_str();
+    peaks_cmd->add_flag("--remeasure", remeasure, "Measure again and replace the cached figures");
+
+    // ---------- 子命令 compare ----------
+    CompareOptions compare_opt;
+    auto compare_cmd = app.add_subcommand("compare", "Compare a candidate result set with a baseline and flag significant regressions");
+    compare_cmd->add_option("--baseline", compare_opt.baseline,
+                            "Baseline run/sweep JSON report, or a directory of them")
+        ->required();
+    compare_cmd->add_option("--candidate", compare_opt.candidate,
+                            "Candidate run/sweep JSON report, or a directory of them")
+        ->required();
+    compare_cmd->add_option("--alpha", compare_opt.compare.alpha,
+                            "Significance level of the one-sided Mann-Whitney test on the per-iteration samples")
+        ->check(CLI::Range(1e-9, 0.5))
+        ->capture_default_str();
+    compare_cmd->add_option("--threshold", compare_opt.compare.threshold,
+                            "Relative median change that must also be exceeded (0.02 = 2%)")
+        ->check(CLI::Range(0.0, 10.0))
+        ->capture_default_str();
+    compare_cmd->add_option("--min-samples", compare_opt.compare.min_samples,
+                            "Samples needed on each side; results with fewer are reported as inconclusive")
+        ->check(CLI::Range(2, 1 << 30))
+        ->capture_default_str();
+    compare_cmd->add_option("--output", compare_opt.output, "Write the comparison as JSON");
+    compare_cmd->add_flag("--fail-on-missing", compare_opt.fail_on_missing,
+                          "Also fail when a baseline result has no candidate counterpart");
+
     // ---------- 子命令 list-ops ----------
     auto list_cmd = app.add_subcommand("list-ops", "List available GEMM operators");
 
@@ -69,7 +1045,33 @@ int cli_main(int argc, char **argv)
     {
         try
         {
+            std::vector<GemmShape> groups;
+            if (!group_list.empty() && experts > 0)
+            {
+                throw std::invalid_argument("--groups and --experts are mutually exclusive");
+            }
+            if (!group_list.empty())
+            {
+                groups = parse_group_list(group_list);
+            }
+            else if (experts > 0)
+            {
+                groups = moe_group_shapes(experts, M, N, K, expert_skew);
+            }
+            if (!groups.empty())
+            {
+                if (batch > 1)
+                {
+                    throw std::invalid_argument("grouped samples cannot be batched");
+                }
+                const GemmShape largest = max_shape(groups);
+                M = largest.M;
+                N = largest.N;
+                K = largest.K;
+            }
             std::cout << "Generating sample matrices with M=" << M << " N=" << N << " K=" << K
+                      << (batch > 1 ? ", batch=" + std::to_string(batch) : std::string())
+                      << (groups.empty() ? std::string() : ", groups=" + std::to_string(groups.size()) + " (largest extents)")
                       << ", pattern=" << pattern_str << "\n";
             if (pattern_str == "RANDOM")
             {
@@ -95,16 +1097,34 @@ int cli_main(int argc, char **argv)
             {
                 throw std::invalid_argument("Unknown pattern type: " + pattern_str);
             }
-            SampleConfig cfg{M, N, K};
-            auto A = generate_matrix(cfg.M, cfg.K, 42, pattern);
-            auto B = generate_matrix(cfg.K, cfg.N, 1337, pattern);
-            auto C = compute_reference_c(cfg, A, B);
+            SampleConfig cfg{M, N, K, batch, groups};
+            // Batch entries are stacked along the rows; groups are stored back to back.
+            auto A = groups.empty() ? generate_matrix(cfg.batch * cfg.M, cfg.K, 42, pattern)
+                                    : generate_grouped_operand(groups, false, 42, pattern);
+            auto B = groups.empty() ? generate_matrix(cfg.batch * cfg.K, cfg.N, 1337, pattern)
+                                    : generate_grouped_operand(groups, true, 1337, pattern);
+            MatrixBuffer C = no_reference ? MatrixBuffer() : compute_reference_c(cfg, A, B, compensated_reference);
             SampleData data{cfg, std::move(A), std::move(B), std::move(C)};
-            save_sample_file(sample_out, data);
+            save_sample_file(sample_out, data, sample_format);
             std::cout << "Saved sample matrices to " << sample_out << "\n";
-            std::cout << "A size: " << cfg.M << "x" << cfg.K
-                      << ", B size: " << cfg.K << "x" << cfg.N
-                      << ", C reference computed" << "\n";
+            if (groups.empty())
+            {
+                std::cout << "A size: " << cfg.M << "x" << cfg.K
+                          << ", B size: " << cfg.K << "x" << cfg.N;
+            }
+            else
+            {
+                double gflop = 0.0;
+                int min_m = groups.front().M;
+                for (const GemmShape &g : groups)
+                {
+                    gflop += g.flops() * 1e-9;
+                    min_m = std::min(min_m, g.M);
+                }
+                std::cout << groups.size() << " groups, M from " << min_m << " to " << cfg.M
+                          << ", " << gflop << " GFLOP in total";
+            }
+            std::cout << (no_reference ? ", no reference C stored" : ", C reference computed") << "\n";
         }
         catch (const std::exception &ex)
         {
@@ -114,6 +1134,91 @@ int cli_main(int argc, char **argv)
         return 0;
     }
 
+    // -------- sweep 子命令逻辑 --------
+    if (sweep_cmd->parsed())
+    {
+        parse_alloc_policy(alloc_str, sweep_opt.alloc_policy);
+        if (sweep_opt.cache_mode != "cold")
+        {
+            sweep_opt.modes.push_back(CacheMode::Hot);
+        }
+        if (sweep_opt.cache_mode != "hot")
+        {
+            sweep_opt.modes.push_back(CacheMode::Cold);
+        }
+        sweep_opt.bench.cold_strategy = cold_strategy_str == "rotate" ? ColdStrategy::Rotate : ColdStrategy::Flush;
+        try
+        {
+            if (!sweep_opt.tuning_cache.empty())
+            {
+                TuningCache::shared().load_lenient(sweep_opt.tuning_cache);
+            }
+            return run_sweep(sweep_opt);
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "Sweep failed: " << ex.what() << "\n";
+            return 1;
+        }
+    }
+
+    // -------- autotune 子命令逻辑 --------
+    if (tune_cmd->parsed())
+    {
+        try
+        {
+            return run_autotune(tune_opt);
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "Autotune failed: " << ex.what() << "\n";
+            return 1;
+        }
+    }
+
+    // -------- peaks 子命令逻辑 --------
+    if (peaks_cmd->parsed())
+    {
+        try
+        {
+            const int threads = num_threads > 0 ? num_threads : ThreadPool::default_threads();
+            std::vector<int> counts{1};
+            if (threads > 1)
+            {
+                counts.push_back(threads);
+            }
+            std::cout << "Host: " << host_signature() << "\n";
+            for (int t : counts)
+            {
+                const MachinePeaks p = machine_peaks(t, remeasure);
+                std::cout << std::setw(3) << t << (t == 1 ? " thread:  " : " threads: ") << p.peak_gflops
+                          << " GFLOPS (" << p.isa << " FMA), " << p.bandwidth_gbs << " GB/s triad, ridge at "
+                          << p.peak_gflops / p.bandwidth_gbs << " FLOP/byte\n";
+            }
+            std::cout << "Cached in " << peaks_cache_path() << "\n";
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "Failed to measure peaks: " << ex.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // -------- compare 子命令逻辑 --------
+    if (compare_cmd->parsed())
+    {
+        try
+        {
+            return run_compare(compare_opt);
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "Compare failed: " << ex.what() << "\n";
+            return 1;
+        }
+    }
+
     if (list_cmd->parsed())
     {
         for (auto &name : list_ops())
@@ -132,11 +1237,26 @@ int cli_main(int argc, char **argv)
             std::cerr << "Operator not found: " << op_name << "\n";
             return 1;
         }
+        if (num_threads > 0)
+        {
+            op->set_num_threads(num_threads);
+        }
+        op->set_use_tuning_cache(!no_tuning);
+        if (!tuning_cache.empty())
+        {
+            TuningCache::shared().load_lenient(tuning_cache);
+        }
+
+        AllocPolicy alloc_policy = AllocPolicy::Default;
+        parse_alloc_policy(alloc_str, alloc_policy);
+        // First-touch pages are placed by the threads that will compute on them.
+        const FirstTouchScope first_touch([&op](const ThreadPool::Job &job) { op->run_on_threads(job); });
 
         SampleData sample;
         try
         {
-            sample = load_sample_file(sample_in);
+            sample = load_mode == "mmap" ? map_sample_file(sample_in, alloc_policy)
+                                        : load_sample_file(sample_in, alloc_policy);
         }
         catch (const std::exception &ex)
         {
@@ -144,79 +1264,369 @@ int cli_main(int argc, char **argv)
             return 1;
         }
 
-        if (op->columnMajor())
+        // Strided mode passes row-major views with the requested strides and
+        // transposes through run_strided; ops that need another layout
+        // convert internally. Otherwise the sample is handed over densely.
+        const bool strided = trans_a || trans_b || lda != 0 || ldb != 0 || ldc != 0 ||
+                             alpha != 1.0f || beta != 0.0f;
+        if (alpha == 0.0f)
+        {
+            std::cerr << "--alpha must be non-zero\n";
+            return 1;
+        }
+        // Batched samples go through the batched entry points with dense
+        // row-major entries; the op's default implementation adapts them.
+        const bool batched = sample.cfg.batch > 1;
+        // Grouped samples go through run_grouped, one pointer triple per group.
+        const bool grouped = !sample.cfg.groups.empty();
+        if ((batched || grouped) && (strided || bench_cfg.prepack_b))
+        {
+            std::cerr << "Batched and grouped samples do not support strided operands or --prepack-b\n";
+            return 1;
+        }
+        bench_cfg.batch_interface = batch_interface_str == "array" ? BatchInterface::PointerArray : BatchInterface::Strided;
+        if (op->columnMajor() && !strided && !batched && !grouped)
         {
             std::cout << "Converting sample matrices to column-major format for operator " << op_name << "\n";
-            sample.convert_to_column_major();
+            sample.convert_to_column_major(alloc_policy);
         }
 
         const auto &cfg = sample.cfg;
+        // Every batch entry or group is one problem; a plain sample is one entry.
+        std::vector<GemmShape> entry_shapes = cfg.groups;
+        if (entry_shapes.empty())
+        {
+            entry_shapes.assign(static_cast<std::size_t>(cfg.batch), GemmShape{cfg.M, cfg.N, cfg.K});
+        }
+        const GroupedOffsets entry_off = grouped_offsets(entry_shapes);
+        const std::size_t entries = entry_shapes.size();
+        const std::string entry_label = grouped ? "group" : "entry";
+        auto computed = MatrixBuffer::allocate(entry_off.c.back(), MatrixBuffer::kDefaultAlignment, alloc_policy);
+        MatrixBuffer strided_a;
+        MatrixBuffer strided_b;
+        MatrixBuffer strided_c;
+        GemmArgs args;
+        if (strided)
+        {
+            try
+            {
+                args = make_strided_args(sample, trans_a, trans_b, lda, ldb, ldc, alpha, beta,
+                                         alloc_policy, strided_a, strided_b, strided_c);
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << "Invalid operand layout: " << ex.what() << "\n";
+                return 1;
+            }
+            std::cout << "Strided operands: A" << (trans_a ? "^T" : "") << " lda=" << args.A.ld
+                      << ", B" << (trans_b ? "^T" : "") << " ldb=" << args.B.ld
+                      << ", ldc=" << args.C.ld << ", alpha=" << alpha << ", beta=" << beta << "\n";
+        }
         std::cout << "Running op=" << op_name
                   << " with M=" << cfg.M << " N=" << cfg.N << " K=" << cfg.K
+                  << (batched ? " batch=" + std::to_string(cfg.batch) : std::string())
+                  << (grouped ? " groups=" + std::to_string(entries) + " (largest extents)" : std::string())
+                  << " threads=" << op->num_threads()
+                  << " alloc=" << alloc_policy_name(computed.policy())
                   << " from " << sample_in << "\n";
 
-        auto computed = MatrixBuffer::allocate(static_cast<std::size_t>(cfg.M) * static_cast<std::size_t>(cfg.N));
+        std::vector<CacheMode> modes;
+        if (cache_mode_str == "hot" || cache_mode_str == "both")
+        {
+            modes.push_back(CacheMode::Hot);
+        }
+        if (cache_mode_str == "cold" || cache_mode_str == "both")
+        {
+            modes.push_back(CacheMode::Cold);
+        }
+        bench_cfg.cold_strategy = cold_strategy_str == "rotate" ? ColdStrategy::Rotate : ColdStrategy::Flush;
 
-        auto result = bench_gemm(op.get(), sample.A.data(), sample.B.data(), computed.data(),
-                                 cfg.M, cfg.N, cfg.K);
-        double flops = 2.0 * cfg.M * cfg.N * cfg.K;
-        double gflops = flops / (result.ms * 1e-3 * 1e9);
+        RunReport report;
+        report.op = op_name;
+        report.M = cfg.M;
+        report.N = cfg.N;
+        report.K = cfg.K;
+        report.threads = op->num_threads();
+        report.alloc_policy = alloc_policy_name(computed.policy());
+        report.group_shapes = cfg.groups;
+        if (strided)
+        {
+            report.strided = true;
+            report.trans_a = trans_a;
+            report.trans_b = trans_b;
+            report.lda = args.A.ld;
+            report.ldb = args.B.ld;
+            report.ldc = args.C.ld;
+            report.alpha = alpha;
+            report.beta = beta;
+        }
+        if (!trace_path.empty())
+        {
+            Tracer::register_thread("main");
+            Tracer::start();
+        }
+        try
+        {
+            for (CacheMode mode : modes)
+            {
+                BenchConfig mode_cfg = bench_cfg;
+                mode_cfg.cache_mode = mode;
+                if (grouped)
+                {
+                    GemmGroup gemm_group;
+                    gemm_group.shapes = cfg.groups;
+                    gemm_group.A = sample.A.data();
+                    gemm_group.B = sample.B.data();
+                    gemm_group.C = computed.data();
+                    report.results.push_back(bench_gemm_grouped(op.get(), gemm_group, mode_cfg));
+                }
+                else if (batched)
+                {
+                    GemmBatch gemm_batch;
+                    gemm_batch.M = cfg.M;
+                    gemm_batch.N = cfg.N;
+                    gemm_batch.K = cfg.K;
+                    gemm_batch.batch = cfg.batch;
+                    gemm_batch.A = sample.A.data();
+                    gemm_batch.B = sample.B.data();
+                    gemm_batch.C = computed.data();
+                    report.results.push_back(bench_gemm_batched(op.get(), gemm_batch, mode_cfg));
+                }
+                else if (strided)
+                {
+                    report.results.push_back(bench_gemm(op.get(), args, mode_cfg));
+                }
+                else
+                {
+                    report.results.push_back(bench_gemm(op.get(), sample.A.data(), sample.B.data(), computed.data(),
+                                                        cfg.M, cfg.N, cfg.K, mode_cfg));
+                }
+            }
+            Tracer::stop();
+            report.tuning = op->applied_tuning();
+            if (strided)
+            {
+                unscale_strided_c(args.C, alpha, beta, computed.data());
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "Failed to run operator: " << ex.what() << "\n";
+            return 1;
+        }
+        if (!trace_path.empty())
+        {
+            const std::vector<TraceThread> threads = Tracer::snapshot();
+            std::size_t events = 0;
+            std::uint64_t dropped = 0;
+            for (const TraceThread &t : threads)
+            {
+                events += t.events.size();
+                dropped += t.dropped;
+            }
+            std::ofstream ofs(trace_path);
+            write_chrome_trace(ofs, threads);
+            if (!ofs)
+            {
+                std::cerr << "Failed to write trace " << trace_path << "\n";
+                return 1;
+            }
+            std::cout << "Saved trace of " << events << " zones on " << threads.size()
+                      << (threads.size() == 1 ? " thread to " : " threads to ")
+                      << trace_path << (dropped > 0 ? " (" + std::to_string(dropped) + " oldest dropped)" : "")
+                      << "; timings above include the tracing overhead\n";
+        }
+        if (!no_roofline)
+        {
+            try
+            {
+                annotate_roofline(report, machine_peaks(op->num_threads()), strided && beta != 0.0f);
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << "Skipping roofline: " << ex.what() << "\n";
+            }
+        }
+
+        for (const auto &result : report.results)
+        {
+            const auto &st = result.stats;
+            std::cout << "[" << cache_mode_name(result.cache_mode) << " cache] "
+                      << "Iterations = " << result.samples_ms.size() << " (warmup " << result.warmup << ")"
+                      << ", cv = " << st.cv << (result.stable ? "" : " (not stable)") << "\n";
+            std::cout << "Time = " << result.ms << " ms (median)"
+                      << ", min=" << st.min << " mean=" << st.mean
+                      << " p90=" << st.p90 << " p99=" << st.p99
+                      << " stddev=" << st.stddev << "\n";
+            std::cout << "GFLOPS = " << report_gflops(report, result) << "\n";
+            if (result.batch > 1)
+            {
+                std::cout << "Per-GEMM latency = " << result.ms * 1e3 / result.batch << " us ("
+                          << result.batch << " GEMMs per iteration)\n";
+            }
+            if (result.groups > 0)
+            {
+                std::cout << "Grouped call = " << result.groups << " GEMMs, "
+                          << result.flops * 1e-9 << " GFLOP per iteration\n";
+            }
+            std::cout << "Prepare = " << result.prepare_ms << " ms"
+                      << (result.b_prepacked ? ", pack B = " + std::to_string(result.pack_b_ms) + " ms" : std::string())
+                      << ", first run = " << result.first_run_ms << " ms"
+                      << ", workspace = " << result.workspace_bytes << " bytes\n";
+            const auto &perf = result.perf;
+            if (perf.available)
+            {
+                std::cout << "IPC = " << perf.ipc
+                          << (perf.partial ? std::string() : ", FLOP/cycle = " + std::to_string(perf.flops_per_cycle))
+                          << ", L1D/LLC/dTLB MPKI = " << perf.l1d_mpki << "/" << perf.llc_mpki
+                          << "/" << perf.dtlb_mpki << " (" << perf.threads
+                          << (perf.threads == 1 ? " thread" : " threads") << ")\n";
+                if (perf.partial)
+                {
+                    std::cout << "Counters: " << perf.status << "\n";
+                }
+            }
+        }
+        if (report.roofline.available)
+        {
+            print_roofline(report.roofline);
+        }
+        if (!report.tuning.empty())
+        {
+            std::cout << "Tuned parameters = " << format_tuning_values(report.tuning) << " (from "
+                      << TuningCache::shared().path() << ")\n";
+        }
+        if (report.results.size() > 1)
+        {
+            std::cout << "Cold/hot time ratio = " << report.results[1].ms / report.results[0].ms << "\n";
+        }
 
-        std::cout << "Time = " << result.ms << " ms\n";
-        std::cout << "GFLOPS = " << gflops << "\n";
+        const bool freivalds = verify_mode == "freivalds" || (verify_mode == "auto" && sample.C.empty());
+        if (!freivalds && sample.C.empty())
+        {
+            std::cerr << "Sample has no reference C; use --verify freivalds\n";
+            return 1;
+        }
 
-        auto verify = verify_result(sample.C.data(), computed.data(), cfg.M, cfg.N);
-        if (verify.ok)
+        bool verified = false;
+        double max_abs_error = 0.0;
+        double max_rel_error = 0.0;
+        if (freivalds)
         {
-            std::cout << "Verification PASSED. max_abs_err=" << verify.max_abs_error
-                      << ", max_rel_err=" << verify.max_rel_error << "\n";
+            // Column-major operands are the row-major transposes, and
+            // C^T = B^T * A^T, so the same row-major check applies.
+            const bool transposed = op->columnMajor() && !strided && !batched && !grouped;
+            FreivaldsResult check{};
+            std::size_t failed_entry = 0;
+            for (std::size_t e = 0; e < entries; ++e)
+            {
+                const GemmShape &shape = entry_shapes[e];
+                const float *a = sample.A.data() + entry_off.a[e];
+                const float *b = sample.B.data() + entry_off.b[e];
+                const float *c = computed.data() + entry_off.c[e];
+                const auto entry = verify_freivalds(transposed ? b : a, transposed ? a : b, c,
+                                                    transposed ? shape.N : shape.M, transposed ? shape.M : shape.N,
+                                                    shape.K, freivalds_trials);
+                max_abs_error = std::max(max_abs_error, entry.max_residual);
+                max_rel_error = std::max(max_rel_error, entry.max_rel_residual);
+                check = entry;
+                if (!entry.ok)
+                {
+                    failed_entry = e;
+                    break;
+                }
+            }
+            verified = check.ok;
+            if (check.ok)
+            {
+                std::cout << "Verification PASSED (freivalds, " << check.trials << " trials"
+                          << (batched || grouped ? " per " + entry_label : std::string()) << "). max_residual="
+                          << max_abs_error << ", max_rel_residual=" << max_rel_error << "\n";
+            }
+            else
+            {
+                std::cerr << "Verification FAILED (freivalds) at "
+                          << (batched || grouped ? entry_label + " " + std::to_string(failed_entry) + ", " : std::string())
+                          << "row " << check.mismatch_row
+                          << ", trial " << check.mismatch_trial
+                          << ". residual=" << check.mismatch_residual
+                          << " tolerance=" << check.mismatch_tolerance << "\n";
+            }
         }
         else
         {
-            std::cerr << "Verification FAILED at (" << verify.mismatch_row
-                      << ", " << verify.mismatch_col << ")"
-                      << ". expected=" << verify.expected_value
-                      << " actual=" << verify.actual_value
-                      << " abs_err=" << verify.mismatch_abs_error
-                      << " rel_err=" << verify.mismatch_rel_error << "\n";
+            VerifyResult verify{};
+            std::size_t failed_entry = 0;
+            for (std::size_t e = 0; e < entries; ++e)
+            {
+                verify = verify_result(sample.C.data() + entry_off.c[e], computed.data() + entry_off.c[e],
+                                       entry_shapes[e].M, entry_shapes[e].N);
+                max_abs_error = std::max(max_abs_error, verify.max_abs_error);
+                max_rel_error = std::max(max_rel_error, verify.max_rel_error);
+                if (!verify.ok)
+                {
+                    failed_entry = e;
+                    break;
+                }
+            }
+            verified = verify.ok;
+            if (verify.ok)
+            {
+                std::cout << "Verification PASSED. max_abs_err=" << max_abs_error
+                          << ", max_rel_err=" << max_rel_error << "\n";
+            }
+            else
+            {
+                std::cerr << "Verification FAILED at "
+                          << (batched || grouped ? entry_label + " " + std::to_string(failed_entry) + " " : std::string())
+                          << "(" << verify.mismatch_row
+                          << ", " << verify.mismatch_col << ")"
+                          << ". expected=" << verify.expected_value
+                          << " actual=" << verify.actual_value
+                          << " abs_err=" << verify.mismatch_abs_error
+                          << " rel_err=" << verify.mismatch_rel_error << "\n";
+            }
+        }
+        if (verbose && grouped)
+        {
+            std::cout << "Matrix printout is not available for grouped samples\n";
         }
-        if (verbose)
+        else if (verbose)
         {
             std::cout << "==============================\n";
             std::cout << "Matrix A:\n";
-            sample.A.print(cfg.M, cfg.K, std::cout);
+            sample.A.print(entries * cfg.M, cfg.K, std::cout);
             std::cout << "------------------------------\n";
             std::cout << "Matrix B:\n";
-            sample.B.print(cfg.K, cfg.N, std::cout);
-            std::cout << "------------------------------\n";
-            std::cout << "Reference Matrix C:\n";
-            sample.C.print(cfg.M, cfg.N, std::cout);
+            sample.B.print(entries * cfg.K, cfg.N, std::cout);
             std::cout << "------------------------------\n";
+            if (!sample.C.empty())
+            {
+                std::cout << "Reference Matrix C:\n";
+                sample.C.print(entries * cfg.M, cfg.N, std::cout);
+                std::cout << "------------------------------\n";
+            }
             std::cout << "Computed Matrix C:\n";
-            computed.print(cfg.M, cfg.N, std::cout);
+            computed.print(entries * cfg.M, cfg.N, std::cout);
             std::cout << "==============================\n";
         }
 
         if (!output_json.empty())
         {
+            report.verified = verified;
+            report.verify_mode = freivalds ? "freivalds" : "full";
+            report.verify_trials = freivalds ? freivalds_trials : 0;
+            report.max_abs_error = max_abs_error;
+            report.max_rel_error = max_rel_error;
             std::ofstream ofs(output_json);
-            ofs << "{\n";
-            ofs << "  \"op\": \"" << op_name << "\",\n";
-            ofs << "  \"M\": " << cfg.M << ",\n";
-            ofs << "  \"N\": " << cfg.N << ",\n";
-            ofs << "  \"K\": " << cfg.K << ",\n";
-            ofs << "  \"time_ms\": " << result.ms << ",\n";
-            ofs << "  \"gflops\": " << gflops << ",\n";
-            ofs << "  \"verified\": " << (verify.ok ? "true" : "false") << ",\n";
-            ofs << "  \"max_abs_error\": " << verify.max_abs_error << ",\n";
-            ofs << "  \"max_rel_error\": " << verify.max_rel_error << "\n";
-            ofs << "}\n";
+            write_run_report(ofs, report);
+            ofs << "\n";
             ofs.close();
             std::cout << "Saved result to " << output_json << "\n";
             std::cout << "==============================\n";
         }
 
-        return verify.ok ? 0 : 2;
+        return verified ? 0 : 2;
     }
 
     return 0;
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define GEMMBENCH_HAS_ALLOC_POLICIES 1
+#endif
+
+// How MatrixBuffer obtains memory for large matrices.
+enum class AllocPolicy
+{
+    Default,    // posix_memalign, zeroed by the calling thread
+    HugePages,  // aligned mmap + madvise(MADV_HUGEPAGE): transparent hugepages
+    HugeTlb,    // mmap(MAP_HUGETLB) from the explicit 2 MiB pool; falls back to HugePages
+    Interleave, // mmap with MPOL_INTERLEAVE over all online NUMA nodes
+    FirstTouch, // mmap, pages first touched by the FirstTouchScope threads (default ThreadPool::shared())
+};
+
+inline const char *alloc_policy_name(AllocPolicy policy)
+{
+    switch (policy)
+    {
+    case AllocPolicy::HugePages:
+        return "thp";
+    case AllocPolicy::HugeTlb:
+        return "hugetlb";
+    case AllocPolicy::Interleave:
+        return "interleave";
+    case AllocPolicy::FirstTouch:
+        return "first-touch";
+    default:
+        return "default";
+    }
+}
+
+inline bool parse_alloc_policy(const std::string &name, AllocPolicy &out)
+{
+    for (AllocPolicy p : {AllocPolicy::Default, AllocPolicy::HugePages, AllocPolicy::HugeTlb,
+                          AllocPolicy::Interleave, AllocPolicy::FirstTouch})
+    {
+        if (name == alloc_policy_name(p))
+        {
+            out = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace alloc_detail
+{
+constexpr std::size_t kHugePageBytes = 2 * 1024 * 1024;
+constexpr std::size_t kPageBytes = 4096;
+constexpr int kMpolInterleave = 3; // MPOL_INTERLEAVE from <linux/mempolicy.h>
+
+inline std::size_t round_up(std::size_t value, std::size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Online NUMA nodes as an mbind nodemask; empty on single-node hosts.
+inline std::vector<unsigned long> online_node_mask()
+{
+    std::ifstream in("/sys/devices/system/node/online");
+    std::string list;
+    std::vector<unsigned long> mask;
+    if (!(in >> list))
+    {
+        return mask;
+    }
+    int nodes = 0;
+    std::size_t pos = 0;
+    while (pos < list.size())
+    {
+        const std::size_t comma = list.find(',', pos);
+        const std::string range = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        const std::size_t dash = range.find('-');
+        const int lo = std::stoi(range.substr(0, dash));
+        const int hi = dash == std::string::npos ? lo : std::stoi(range.substr(dash + 1));
+        for (int node = lo; node <= hi; ++node)
+        {
+            const std::size_t word = static_cast<std::size_t>(node) / (8 * sizeof(unsigned long));
+            if (mask.size() <= word)
+            {
+                mask.resize(word + 1, 0);
+            }
+            mask[word] |= 1ul << (node % (8 * sizeof(unsigned long)));
+            ++nodes;
+        }
+        pos = comma == std::string::npos ? list.size() : comma + 1;
+    }
+    if (nodes < 2)
+    {
+        mask.clear();
+    }
+    return mask;
+}
+
+#if defined(GEMMBENCH_HAS_ALLOC_POLICIES)
+// Anonymous read/write mapping of length bytes whose start is a multiple of
+// alignment: over-reserves by alignment and unmaps the unused head and tail.
+inline void *map_aligned(std::size_t length, std::size_t alignment, int extra_flags)
+{
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | extra_flags;
+    if (alignment <= kPageBytes)
+    {
+        return mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    }
+    const std::size_t reserve = length + alignment;
+    void *region = mmap(nullptr, reserve, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        return MAP_FAILED;
+    }
+    const auto base = reinterpret_cast<std::uintptr_t>(region);
+    const auto aligned = static_cast<std::uintptr_t>(round_up(base, alignment));
+    if (aligned > base)
+    {
+        munmap(region, aligned - base);
+    }
+    const std::uintptr_t tail = aligned + length;
+    if (tail < base + reserve)
+    {
+        munmap(reinterpret_cast<void *>(tail), base + reserve - tail);
+    }
+    return reinterpret_cast<void *>(aligned);
+}
+#endif
+
+// Runs a job on the threads that first-touch FirstTouch allocations; empty
+// means ThreadPool::shared(). Set through FirstTouchScope.
+inline std::function<void(const ThreadPool::Job &)> &first_touch_runner()
+{
+    static std::function<void(const ThreadPool::Job &)> runner;
+    return runner;
+}
+
+// Writes one byte per page from the first-touch threads, thread t of n
+// taking the t-th contiguous slice, so the kernel places every slice on that
+// thread's node. Safe from any thread: concurrent callers are serialized by
+// ThreadPool::run(), and a caller inside a job of the same pool touches the
+// pages itself.
+inline void touch_pages_in_parallel(void *ptr, std::size_t bytes)
+{
+    auto *base = static_cast<char *>(ptr);
+    const std::size_t pages = (bytes + kPageBytes - 1) / kPageBytes;
+    const ThreadPool::Job touch = [&](int tid, int threads) {
+        const std::size_t begin = pages * static_cast<std::size_t>(tid) / static_cast<std::size_t>(threads);
+        const std::size_t end = pages * static_cast<std::size_t>(tid + 1) / static_cast<std::size_t>(threads);
+        for (std::size_t page = begin; page < end; ++page)
+        {
+            base[page * kPageBytes] = 0;
+        }
+    };
+    if (first_touch_runner())
+    {
+        first_touch_runner()(touch);
+    }
+    else
+    {
+        ThreadPool::shared().run(touch);
+    }
+}
+} // namespace alloc_detail
+
+// While alive, FirstTouch allocations are touched through runner instead of
+// ThreadPool::shared(), typically the benchmarked op's run_on_threads, so
+// the slice thread t touches sits on the node of the thread that computes
+// with it. With the contiguous split this matches the row blocks of A and C
+// that the statically partitioned ops hand to thread t.
+class FirstTouchScope
+{
+public:
+    explicit FirstTouchScope(std::function<void(const ThreadPool::Job &)> runner)
+        : previous_(std::move(alloc_detail::first_touch_runner()))
+    {
+        alloc_detail::first_touch_runner() = std::move(runner);
+    }
+    ~FirstTouchScope() { alloc_detail::first_touch_runner() = std::move(previous_); }
+    FirstTouchScope(const FirstTouchScope &) = delete;
+    FirstTouchScope &operator=(const FirstTouchScope &) = delete;
+
+private:
+    std::function<void(const ThreadPool::Job &)> previous_;
+};
+
+// Result of allocate_with_policy: mapped_bytes is non-zero when the memory
+// came from mmap and must be returned with munmap instead of free().
+struct PolicyAllocation
+{
+    void *ptr = nullptr;
+    std::size_t mapped_bytes = 0;
+    AllocPolicy policy = AllocPolicy::Default;
+};
+
+// Allocates bytes (already zeroed) aligned to alignment with the given policy.
+// Returns a null pointer for AllocPolicy::Default or when the platform lacks
+// the policy, in which case the caller falls back to posix_memalign.
+inline PolicyAllocation allocate_with_policy(std::size_t bytes, std::size_t alignment, AllocPolicy policy)
+{
+    PolicyAllocation out;
+#if defined(GEMMBENCH_HAS_ALLOC_POLICIES)
+    using namespace alloc_detail;
+    if (policy == AllocPolicy::HugeTlb)
+    {
+        const std::size_t length = round_up(bytes, kHugePageBytes);
+        void *mem = map_aligned(length, alignment > kHugePageBytes ? alignment : 0, MAP_HUGETLB);
+        if (mem != MAP_FAILED)
+        {
+            out = PolicyAllocation{mem, length, AllocPolicy::HugeTlb};
+            return out;
+        }
+        // The explicit pool is empty or not configured; ask for THP instead.
+        policy = AllocPolicy::HugePages;
+    }
+    if (policy == AllocPolicy::HugePages || policy == AllocPolicy::Interleave || policy == AllocPolicy::FirstTouch)
+    {
+        const std::size_t length = round_up(bytes, kPageBytes);
+        void *mem = map_aligned(length, alignment, 0);
+        if (mem == MAP_FAILED)
+        {
+            return out;
+        }
+        if (policy == AllocPolicy::HugePages)
+        {
+            madvise(mem, length, MADV_HUGEPAGE);
+        }
+        else if (policy == AllocPolicy::Interleave)
+        {
+            const auto mask = online_node_mask();
+            if (!mask.empty())
+            {
+                syscall(SYS_mbind, mem, length, kMpolInterleave, mask.data(),
+                        static_cast<unsigned long>(mask.size() * 8 * sizeof(unsigned long)), 0u);
+            }
+        }
+        else
+        {
+            touch_pages_in_parallel(mem, length);
+        }
+        out = PolicyAllocation{mem, length, policy};
+    }
+#else
+    (void)bytes;
+    (void)alignment;
+    (void)policy;
+#endif
+    return out;
+}
+
+inline void release_policy_allocation(void *ptr, std::size_t mapped_bytes) noexcept
+{
+#if defined(GEMMBENCH_HAS_ALLOC_POLICIES)
+    munmap(ptr, mapped_bytes);
+#else
+    (void)ptr;
+    (void)mapped_bytes;
+#endif
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Problem size of one GEMM: C (M x N) = A (M x K) * B (K x N).
+struct GemmShape
+{
+    int M = 0;
+    int N = 0;
+    int K = 0;
+
+    double flops() const noexcept { return 2.0 * M * N * static_cast<double>(K); }
+};
+
+// Element offsets of every group's operands when the dense row-major A, B
+// and C of a grouped GEMM are stored back to back. Each vector has one entry
+// per group plus a final one holding the total element count.
+struct GroupedOffsets
+{
+    std::vector<std::size_t> a;
+    std::vector<std::size_t> b;
+    std::vector<std::size_t> c;
+};
+
+inline GroupedOffsets grouped_offsets(const std::vector<GemmShape> &groups)
+{
+    GroupedOffsets off;
+    off.a.assign(1, 0);
+    off.b.assign(1, 0);
+    off.c.assign(1, 0);
+    for (const GemmShape &g : groups)
+    {
+        const auto m = static_cast<std::size_t>(std::max(g.M, 0));
+        const auto n = static_cast<std::size_t>(std::max(g.N, 0));
+        const auto k = static_cast<std::size_t>(std::max(g.K, 0));
+        off.a.push_back(off.a.back() + m * k);
+        off.b.push_back(off.b.back() + k * n);
+        off.c.push_back(off.c.back() + m * n);
+    }
+    return off;
+}
+
+// Componentwise maximum, e.g. the shape to size workspaces for.
+inline GemmShape max_shape(const std::vector<GemmShape> &groups)
+{
+    GemmShape out;
+    for (const GemmShape &g : groups)
+    {
+        out.M = std::max(out.M, g.M);
+        out.N = std::max(out.N, g.N);
+        out.K = std::max(out.K, g.K);
+    }
+    return out;
+}
@@ -1,15 +1,31 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <new>
 #include <stdexcept>
 #include <iostream>
+#include <memory>
+#include <utility>
 #if defined(_MSC_VER)
 #include <malloc.h>
 #endif
 
+#include "alloc_policy.h"
+#include "thread_pool.h"
+#include "transpose.h"
+
+// Whether allocate() zeroes the new buffer. Uninitialized suits buffers the
+// caller overwrites completely anyway (sample loading, generators, packing),
+// so every byte is written once.
+enum class MatrixInit
+{
+    Zero,
+    Uninitialized,
+};
+
 class MatrixBuffer
 {
 public:
@@ -28,11 +44,16 @@ public:
     MatrixBuffer &operator=(const MatrixBuffer &) = delete;
 
     MatrixBuffer(MatrixBuffer &&other) noexcept
-        : ptr_(other.ptr_), size_(other.size_), alignment_(other.alignment_)
+        : ptr_(other.ptr_), size_(other.size_), alignment_(other.alignment_),
+          is_column_major_(other.is_column_major_), mapped_bytes_(other.mapped_bytes_),
+          policy_(other.policy_), owner_(std::move(other.owner_))
     {
         other.ptr_ = nullptr;
         other.size_ = 0;
         other.alignment_ = 0;
+        other.is_column_major_ = false;
+        other.mapped_bytes_ = 0;
+        other.policy_ = AllocPolicy::Default;
     }
 
     MatrixBuffer &operator=(MatrixBuffer &&other) noexcept
@@ -43,14 +64,50 @@ public:
             ptr_ = other.ptr_;
             size_ = other.size_;
             alignment_ = other.alignment_;
+            is_column_major_ = other.is_column_major_;
+            mapped_bytes_ = other.mapped_bytes_;
+            policy_ = other.policy_;
+            owner_ = std::move(other.owner_);
             other.ptr_ = nullptr;
             other.size_ = 0;
             other.alignment_ = 0;
+            other.is_column_major_ = false;
+            other.mapped_bytes_ = 0;
+            other.policy_ = AllocPolicy::Default;
         }
         return *this;
     }
 
-    static MatrixBuffer allocate(std::size_t count, std::size_t alignment = 2 * 1024 * 1024)
+    // Non-owning view over memory kept alive by owner (e.g. a file mapping
+    // shared by several buffers). The memory is released when the last
+    // buffer referencing owner goes away, never through free().
+    static MatrixBuffer view(float *ptr, std::size_t count, std::shared_ptr<void> owner) noexcept
+    {
+        MatrixBuffer buf(ptr, count, alignof(float));
+        buf.owner_ = std::move(owner);
+        return buf;
+    }
+
+    // True for views created by view(); their memory may be read-only.
+    bool is_view() const noexcept { return owner_ != nullptr; }
+
+    static constexpr std::size_t kDefaultAlignment = 2 * 1024 * 1024;
+
+    static MatrixBuffer allocate(std::size_t count, std::size_t alignment = kDefaultAlignment)
+    {
+        return allocate(count, alignment, AllocPolicy::Default, MatrixInit::Zero);
+    }
+
+    // Contents are indeterminate; the caller must write every element.
+    static MatrixBuffer allocate_uninitialized(std::size_t count, std::size_t alignment = kDefaultAlignment)
+    {
+        return allocate(count, alignment, AllocPolicy::Default, MatrixInit::Uninitialized);
+    }
+
+    // Only the benchmark operands (A, B, C) are allocated with the --alloc
+    // policy; workspaces and other scratch use the overloads above.
+    static MatrixBuffer allocate(std::size_t count, std::size_t alignment, AllocPolicy policy,
+                                 MatrixInit init = MatrixInit::Zero)
     {
         if (count == 0)
         {
@@ -64,10 +121,54 @@ public:
         {
             alignment = alignof(float);
         }
-        float *ptr = allocate_raw(count, alignment);
+        if (policy != AllocPolicy::Default)
+        {
+            const PolicyAllocation mem = allocate_with_policy(count * sizeof(float), alignment, policy);
+            if (mem.ptr != nullptr)
+            {
+                MatrixBuffer buf(static_cast<float *>(mem.ptr), count, alignment);
+                buf.mapped_bytes_ = mem.mapped_bytes;
+                buf.policy_ = mem.policy;
+                return buf;
+            }
+        }
+        // Policy allocations come zeroed from the kernel on first touch.
+        float *ptr = allocate_raw(count, alignment, init == MatrixInit::Zero);
         return MatrixBuffer(ptr, count, alignment);
     }
 
+    // Sets every element to value, split over ThreadPool::shared() for large
+    // buffers. Views may be read-only and are rejected.
+    void fill(float value)
+    {
+        if (is_view())
+        {
+            throw std::runtime_error("Cannot fill a matrix view");
+        }
+        fill_parallel(ptr_, size_, value);
+    }
+
+    void zero() { fill(0.0f); }
+
+    // Parallel fill for raw buffers (e.g. operand copies owned elsewhere).
+    static void fill_parallel(float *ptr, std::size_t count, float value)
+    {
+        constexpr std::size_t kParallelFillMin = std::size_t{1} << 20;
+        constexpr std::size_t kFillGrain = std::size_t{1} << 18;
+        if (count < kParallelFillMin)
+        {
+            std::fill(ptr, ptr + count, value);
+            return;
+        }
+        ThreadPool::shared().parallel_for(count, kFillGrain, [ptr, value](std::size_t begin, std::size_t end, int) {
+            std::fill(ptr + begin, ptr + end, value);
+        });
+    }
+
+    // Policy that actually provided the memory (HugeTlb may degrade to
+    // HugePages, and unsupported platforms always report Default).
+    AllocPolicy policy() const noexcept { return policy_; }
+
     float *data() noexcept { return ptr_; }
     const float *data() const noexcept { return ptr_; }
     std::size_t size() const noexcept { return size_; }
@@ -78,36 +179,49 @@ public:
 
     void reset() noexcept
     {
-        if (ptr_ != nullptr)
+        if (owner_)
+        {
+            owner_.reset();
+        }
+        else if (mapped_bytes_ != 0)
+        {
+            release_policy_allocation(ptr_, mapped_bytes_);
+        }
+        else if (ptr_ != nullptr)
         {
             release(ptr_);
-            ptr_ = nullptr;
         }
+        ptr_ = nullptr;
         size_ = 0;
         alignment_ = 0;
+        is_column_major_ = false;
+        mapped_bytes_ = 0;
+        policy_ = AllocPolicy::Default;
     }
 
-    void convert_to_column_major(int M, int N)
+    // policy applies to the replacement buffer of the out-of-place path.
+    void convert_to_column_major(int M, int N, AllocPolicy policy = AllocPolicy::Default)
     {
         if (ptr_ == nullptr || size_ != static_cast<std::size_t>(M) * static_cast<std::size_t>(N))
         {
             throw std::runtime_error("Invalid matrix dimensions for conversion");
         }
 
-        MatrixBuffer temp = MatrixBuffer::allocate(size_, alignment_);
-
-        for (int j = 0; j < N; ++j)
+        // Square matrices we own are transposed in place, without a second
+        // buffer. Views may point at read-only mappings, so they (and
+        // rectangular matrices) go to a fresh buffer that replaces this one.
+        if (M == N && !is_view())
         {
-            for (int i = 0; i < M; ++i)
-            {
-                temp[j * M + i] = ptr_[i * N + j];
-            }
+            transpose_square_inplace(ptr_, static_cast<std::size_t>(N), N);
+            is_column_major_ = true;
+            return;
         }
 
-        std::swap(ptr_, temp.ptr_);
-        is_column_major_ = true;
-
-        // temp will release the old memory in its destructor
+        MatrixBuffer temp = MatrixBuffer::allocate(size_, std::max(alignment_, std::size_t{64}), policy,
+                                                   MatrixInit::Uninitialized);
+        transpose(ptr_, static_cast<std::size_t>(N), temp.data(), static_cast<std::size_t>(M), M, N);
+        temp.is_column_major_ = true;
+        *this = std::move(temp);
     }
 
     void print(std::size_t rows, std::size_t cols, std::ostream &os = std::cout) const
@@ -141,7 +255,7 @@ public:
     }
 
 private:
-    static float *allocate_raw(std::size_t count, std::size_t alignment)
+    static float *allocate_raw(std::size_t count, std::size_t alignment, bool zero)
     {
         const std::size_t bytes = count * sizeof(float);
         void *mem = nullptr;
@@ -150,7 +264,10 @@ private:
         {
             throw std::bad_alloc();
         }
-        memset(mem, 0, bytes);
+        if (zero)
+        {
+            fill_parallel(static_cast<float *>(mem), count, 0.0f);
+        }
         return static_cast<float *>(mem);
     }
 
@@ -163,4 +280,7 @@ private:
     std::size_t size_ = 0;
     std::size_t alignment_ = 0;
     bool is_column_major_ = false;
+    std::size_t mapped_bytes_ = 0; // non-zero for mmap-backed policy allocations
+    AllocPolicy policy_ = AllocPolicy::Default;
+    std::shared_ptr<void> owner_;
 };
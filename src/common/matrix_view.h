@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+
+enum class MatrixLayout
+{
+    RowMajor,
+    ColMajor,
+};
+
+// Non-owning view of a float matrix as stored in memory: `rows x cols` in the
+// given layout with leading dimension ld (elements between consecutive rows
+// for RowMajor, columns for ColMajor). trans selects op(X) = X^T, so the
+// logical matrix an operator sees is cols x rows when set. T is float for
+// outputs and const float for inputs.
+template <typename T>
+struct BasicMatrixView
+{
+    T *data = nullptr;
+    int rows = 0;
+    int cols = 0;
+    std::size_t ld = 0;
+    MatrixLayout layout = MatrixLayout::RowMajor;
+    bool trans = false;
+
+    // Dimensions of op(X).
+    int logical_rows() const noexcept { return trans ? cols : rows; }
+    int logical_cols() const noexcept { return trans ? rows : cols; }
+
+    // Element (i, j) of op(X) lives at data[i * row_stride() + j * col_stride()].
+    // One of the two strides is always 1.
+    std::size_t row_stride() const noexcept
+    {
+        return (layout == MatrixLayout::RowMajor) != trans ? ld : 1;
+    }
+    std::size_t col_stride() const noexcept
+    {
+        return (layout == MatrixLayout::RowMajor) != trans ? 1 : ld;
+    }
+
+    T &at(int i, int j) const noexcept
+    {
+        return data[static_cast<std::size_t>(i) * row_stride() + static_cast<std::size_t>(j) * col_stride()];
+    }
+
+    // Elements spanned in memory, padding of the last row/column excluded.
+    std::size_t storage_size() const noexcept
+    {
+        const std::size_t outer = layout == MatrixLayout::RowMajor ? rows : cols;
+        const std::size_t inner = layout == MatrixLayout::RowMajor ? cols : rows;
+        return outer == 0 || inner == 0 ? 0 : (outer - 1) * ld + inner;
+    }
+
+    // True when op(X) is a dense row-major (or, with col_major, column-major)
+    // matrix, i.e. what the classic run(A, B, C, M, N, K) entry point expects.
+    bool is_dense(bool col_major = false) const noexcept
+    {
+        const std::size_t unit_stride = col_major ? row_stride() : col_stride();
+        const std::size_t outer_stride = col_major ? col_stride() : row_stride();
+        const int inner = col_major ? logical_rows() : logical_cols();
+        const int outer = col_major ? logical_cols() : logical_rows();
+        return unit_stride == 1 && (outer <= 1 || outer_stride == static_cast<std::size_t>(inner));
+    }
+};
+
+using MatrixView = BasicMatrixView<const float>;
+using MutableMatrixView = BasicMatrixView<float>;
+
+// Dense view of a rows x cols matrix in row-major (or column-major) order.
+template <typename T>
+BasicMatrixView<T> dense_view(T *data, int rows, int cols, bool col_major = false)
+{
+    BasicMatrixView<T> v;
+    v.data = data;
+    v.rows = rows;
+    v.cols = cols;
+    v.ld = static_cast<std::size_t>(col_major ? rows : cols);
+    v.layout = col_major ? MatrixLayout::ColMajor : MatrixLayout::RowMajor;
+    return v;
+}
+
+// The r x c block of op(v) whose top-left element is (i, j), with the same
+// strides and transpose flag.
+template <typename T>
+BasicMatrixView<T> sub_view(const BasicMatrixView<T> &v, int i, int j, int r, int c)
+{
+    BasicMatrixView<T> out = v;
+    out.data = v.data + static_cast<std::size_t>(i) * v.row_stride() + static_cast<std::size_t>(j) * v.col_stride();
+    out.rows = v.trans ? c : r;
+    out.cols = v.trans ? r : c;
+    return out;
+}
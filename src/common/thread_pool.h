@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "trace.h"
+
+// Fixed-size pool of persistent worker threads. run() executes a job on every
+// thread of the pool (the calling thread acts as thread 0) and returns once all
+// of them finished, so no threads are created or destroyed per call. Calls
+// from different outside threads (e.g. several ops using shared()) take turns.
+class ThreadPool
+{
+public:
+    using Job = std::function<void(int thread_id, int num_threads)>;
+
+    explicit ThreadPool(int num_threads = default_threads())
+        : num_threads_(std::max(1, num_threads))
+    {
+        workers_.reserve(static_cast<std::size_t>(num_threads_ - 1));
+        for (int tid = 1; tid < num_threads_; ++tid)
+        {
+            workers_.emplace_back([this, tid]() { worker_loop(tid); });
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return worker_ids_.size() == workers_.size(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_cv_.notify_all();
+        for (auto &worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const noexcept { return num_threads_; }
+
+    // OS thread ids of the workers (threads 1..size()-1), e.g. for attaching
+    // per-thread perf counters; empty where the OS id is not available.
+    std::vector<int> worker_thread_ids() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<int> ids;
+        for (int id : worker_ids_)
+        {
+            if (id > 0)
+            {
+                ids.push_back(id);
+            }
+        }
+        return ids;
+    }
+
+    void run(const Job &job)
+    {
+        // A job that calls back into its own pool (e.g. a large allocation
+        // zeroed through shared()), directly or through another pool's job,
+        // runs the nested job inline.
+        if (num_threads_ == 1 || in_job_of(this))
+        {
+            job(0, 1);
+            return;
+        }
+
+        std::lock_guard<std::mutex> run_lock(run_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            pending_ = num_threads_ - 1;
+            error_ = nullptr;
+            aborted_.store(false, std::memory_order_relaxed);
+            ++generation_;
+        }
+        start_cv_.notify_all();
+
+        const ActiveJob active{this, active_job()};
+        active_job() = &active;
+        try
+        {
+            job(0, num_threads_);
+        }
+        catch (...)
+        {
+            record_error(std::current_exception());
+        }
+        active_job() = active.outer;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return pending_ == 0; });
+        job_ = nullptr;
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    // True once a thread of the running job has thrown; barriers built with
+    // this pool stop waiting for it.
+    bool aborted() const noexcept { return aborted_.load(std::memory_order_acquire); }
+
+    // Splits [0, count) into chunks of at most grain elements handed out
+    // dynamically; fn(begin, end, thread_id) runs once per chunk.
+    void parallel_for(std::size_t count, std::size_t grain,
+                      const std::function<void(std::size_t, std::size_t, int)> &fn)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        grain = std::max<std::size_t>(grain, 1);
+        if (num_threads_ == 1 || count <= grain || in_job_of(this))
+        {
+            fn(0, count, 0);
+            return;
+        }
+        std::atomic<std::size_t> next{0};
+        run([&](int tid, int) {
+            for (std::size_t begin = next.fetch_add(grain); begin < count; begin = next.fetch_add(grain))
+            {
+                fn(begin, std::min(count, begin + grain), tid);
+            }
+        });
+    }
+
+    // GEMMBENCH_NUM_THREADS if set, otherwise the number of hardware threads.
+    static int default_threads()
+    {
+        if (const char *env = std::getenv("GEMMBENCH_NUM_THREADS"))
+        {
+            const int n = std::atoi(env);
+            if (n > 0)
+            {
+                return n;
+            }
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Process-wide pool for utilities outside the timed region (sample
+    // generation, reference GEMM, verification).
+    static ThreadPool &shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    // Pools whose jobs the current thread is executing, innermost first.
+    struct ActiveJob
+    {
+        const ThreadPool *pool;
+        const ActiveJob *outer;
+    };
+
+    static const ActiveJob *&active_job() noexcept
+    {
+        thread_local const ActiveJob *job = nullptr;
+        return job;
+    }
+
+    static bool in_job_of(const ThreadPool *pool) noexcept
+    {
+        for (const ActiveJob *job = active_job(); job != nullptr; job = job->outer)
+        {
+            if (job->pool == pool)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(int tid)
+    {
+        const ActiveJob active{this, nullptr};
+        active_job() = &active;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+#if defined(__linux__)
+            worker_ids_.push_back(static_cast<int>(syscall(SYS_gettid)));
+#else
+            worker_ids_.push_back(0);
+#endif
+        }
+        done_cv_.notify_all();
+        Tracer::register_thread("worker " + std::to_string(tid));
+        unsigned long long seen = 0;
+        for (;;)
+        {
+            const Job *job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_cv_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+                if (stop_)
+                {
+                    return;
+                }
+                seen = generation_;
+                job = job_;
+            }
+
+            try
+            {
+                (*job)(tid, num_threads_);
+            }
+            catch (...)
+            {
+                record_error(std::current_exception());
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0)
+            {
+                done_cv_.notify_one();
+            }
+        }
+    }
+
+    // The first error of a job wins; threads that fail because of it (e.g.
+    // at an aborted barrier) only add their exception later.
+    void record_error(std::exception_ptr error)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+        {
+            error_ = error;
+        }
+        aborted_.store(true, std::memory_order_release);
+    }
+
+    const int num_threads_;
+    std::vector<std::thread> workers_;
+    std::vector<int> worker_ids_;
+    mutable std::mutex mutex_;
+    std::mutex run_mutex_; // held by the outside thread dispatching a job
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const Job *job_ = nullptr;
+    unsigned long long generation_ = 0;
+    int pending_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    std::atomic<bool> aborted_{false};
+};
+
+// Thrown by SpinBarrier::wait when another thread of the job has failed.
+class BarrierAborted : public std::runtime_error
+{
+public:
+    BarrierAborted() : std::runtime_error("barrier aborted: another thread of the job failed") {}
+};
+
+// Sense-reversing barrier for synchronizing the threads of one ThreadPool job.
+// Spins briefly, then yields so oversubscribed pools still make progress.
+// Given the pool, wait() throws BarrierAborted once a thread of the job has
+// thrown, so the others unwind instead of waiting for it forever; the pool
+// then rethrows the original error. An aborted barrier is not reusable.
+class SpinBarrier
+{
+public:
+    explicit SpinBarrier(int count, const ThreadPool *pool = nullptr) noexcept
+        : count_(count), pool_(pool), waiting_(0), sense_(false)
+    {
+    }
+
+    void wait()
+    {
+        GEMMBENCH_TRACE_SCOPE("barrier");
+        const bool sense = sense_.load(std::memory_order_relaxed);
+        if (waiting_.fetch_add(1, std::memory_order_acq_rel) + 1 == count_)
+        {
+            waiting_.store(0, std::memory_order_relaxed);
+            sense_.store(!sense, std::memory_order_release);
+            return;
+        }
+        for (int spins = 0; sense_.load(std::memory_order_acquire) == sense; ++spins)
+        {
+            if (pool_ != nullptr && pool_->aborted())
+            {
+                throw BarrierAborted();
+            }
+            if (spins > 1024)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    const int count_;
+    const ThreadPool *pool_;
+    std::atomic<int> waiting_;
+    std::atomic<bool> sense_;
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Timeline tracing of op internals (packing, compute, barrier waits) for
+// Chrome trace-event / Perfetto output. Every thread records into its own
+// ring buffer, so recording takes no locks; a full ring overwrites its oldest
+// events. Rings are registered up front (pool workers when they start, the
+// caller of start() there) and sized by start(), so a zone never allocates;
+// threads that never registered are not traced. While tracing is stopped a
+// zone costs one relaxed atomic load, and building with GEMMBENCH_NO_TRACE
+// removes the zones altogether.
+//
+//   void pack(...)
+//   {
+//       GEMMBENCH_TRACE_SCOPE("pack_a");
+//       ...
+//   }
+
+struct TraceEvent
+{
+    const char *name; // string literal, stored by pointer
+    std::int64_t begin_ns;
+    std::int64_t end_ns;
+};
+
+// Events of one thread, oldest first, as returned by Tracer::snapshot().
+struct TraceThread
+{
+    int tid = 0;
+    std::string name;
+    std::vector<TraceEvent> events;
+    std::uint64_t dropped = 0; // overwritten because the ring was full
+};
+
+// Single-producer ring of one thread. Only the owning thread writes; the
+// tracer reads it once recording has stopped. Empty until start() sizes it.
+class TraceRing
+{
+public:
+    TraceRing(int tid, std::string name) : tid_(tid), name_(std::move(name)) {}
+
+    void record(const char *name, std::int64_t begin_ns, std::int64_t end_ns) noexcept
+    {
+        if (events_.empty())
+        {
+            return;
+        }
+        const std::uint64_t n = head_.load(std::memory_order_relaxed);
+        events_[static_cast<std::size_t>(n) & mask_] = TraceEvent{name, begin_ns, end_ns};
+        head_.store(n + 1, std::memory_order_release);
+    }
+
+private:
+    friend class Tracer;
+
+    const int tid_;
+    std::string name_;
+    std::vector<TraceEvent> events_;
+    std::size_t mask_ = 0;
+    std::atomic<std::uint64_t> head_{0};
+    bool retired_ = false; // owning thread exited; freed by the next start()
+};
+
+class Tracer
+{
+public:
+    static bool enabled() noexcept { return state().enabled.load(std::memory_order_relaxed); }
+
+    // Clears every ring and starts recording with capacity events per thread
+    // (rounded up to a power of two). Registers the calling thread, frees the
+    // rings of threads that have exited and allocates the others, so the
+    // recording itself does not. Call it while no op is running.
+    static void start(std::size_t capacity = std::size_t{1} << 16)
+    {
+        std::size_t pow2 = 1;
+        while (pow2 < capacity)
+        {
+            pow2 <<= 1;
+        }
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        register_locked(s, nullptr);
+        s.rings.erase(std::remove_if(s.rings.begin(), s.rings.end(),
+                                     [](const std::unique_ptr<TraceRing> &ring) { return ring->retired_; }),
+                      s.rings.end());
+        s.capacity = pow2;
+        s.epoch_ns = now_ns();
+        for (auto &ring : s.rings)
+        {
+            size_ring(*ring, pow2);
+            ring->head_.store(0, std::memory_order_relaxed);
+        }
+        s.enabled.store(true, std::memory_order_release);
+    }
+
+    static void stop() noexcept { state().enabled.store(false, std::memory_order_release); }
+
+    static std::int64_t now_ns() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static void record(const char *name, std::int64_t begin_ns, std::int64_t end_ns) noexcept
+    {
+        if (TraceRing *ring = local_ring_ptr())
+        {
+            ring->record(name, begin_ns, end_ns);
+        }
+    }
+
+    // Gives the calling thread a ring named e.g. "worker 3" (or renames it).
+    // The ring is sized right away when tracing is already on.
+    static void register_thread(const std::string &name)
+    {
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        register_locked(s, &name);
+    }
+
+    // Copies the recorded events with timestamps relative to start(). Call
+    // after stop(), once the recording threads are idle.
+    static std::vector<TraceThread> snapshot()
+    {
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        std::vector<TraceThread> out;
+        for (const auto &ring : s.rings)
+        {
+            const std::uint64_t head = ring->head_.load(std::memory_order_acquire);
+            if (head == 0)
+            {
+                continue;
+            }
+            TraceThread t;
+            t.tid = ring->tid_;
+            t.name = ring->name_;
+            const std::uint64_t capacity = ring->events_.size();
+            const std::uint64_t first = head > capacity ? head - capacity : 0;
+            t.dropped = first;
+            t.events.reserve(static_cast<std::size_t>(head - first));
+            for (std::uint64_t i = first; i < head; ++i)
+            {
+                TraceEvent e = ring->events_[static_cast<std::size_t>(i) & ring->mask_];
+                e.begin_ns -= s.epoch_ns;
+                e.end_ns -= s.epoch_ns;
+                t.events.push_back(e);
+            }
+            out.push_back(std::move(t));
+        }
+        return out;
+    }
+
+private:
+    struct State
+    {
+        std::atomic<bool> enabled{false};
+        std::mutex mutex;
+        std::vector<std::unique_ptr<TraceRing>> rings;
+        std::size_t capacity = std::size_t{1} << 16;
+        std::int64_t epoch_ns = 0;
+        int next_tid = 0;
+    };
+
+    // Never destroyed: threads of static pools (ThreadPool::shared()) hand
+    // their rings back after function-local statics have been torn down.
+    static State &state() noexcept
+    {
+        static State *s = new State;
+        return *s;
+    }
+
+    static TraceRing *&local_ring_ptr() noexcept
+    {
+        thread_local TraceRing *ring = nullptr;
+        return ring;
+    }
+
+    // Hands the thread's ring back when the thread exits. An unused ring is
+    // freed at once; one holding events outlives its thread until the next
+    // start(), so pools can be torn down before the trace is written.
+    struct RingOwner
+    {
+        TraceRing *ring = nullptr;
+
+        ~RingOwner()
+        {
+            if (ring == nullptr)
+            {
+                return;
+            }
+            local_ring_ptr() = nullptr;
+            State &s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (ring->head_.load(std::memory_order_relaxed) != 0)
+            {
+                ring->retired_ = true;
+                return;
+            }
+            s.rings.erase(std::find_if(s.rings.begin(), s.rings.end(),
+                                       [this](const std::unique_ptr<TraceRing> &r) { return r.get() == ring; }));
+        }
+    };
+
+    static void register_locked(State &s, const std::string *name)
+    {
+        TraceRing *&ring = local_ring_ptr();
+        if (ring != nullptr)
+        {
+            if (name != nullptr)
+            {
+                ring->name_ = *name;
+            }
+            return;
+        }
+        const int tid = s.next_tid++;
+        s.rings.push_back(std::make_unique<TraceRing>(tid, name != nullptr ? *name : "thread " + std::to_string(tid)));
+        ring = s.rings.back().get();
+        thread_local RingOwner owner;
+        owner.ring = ring;
+        if (s.enabled.load(std::memory_order_relaxed))
+        {
+            size_ring(*ring, s.capacity);
+        }
+    }
+
+    static void size_ring(TraceRing &ring, std::size_t capacity)
+    {
+        if (ring.events_.size() != capacity)
+        {
+            ring.events_.assign(capacity, TraceEvent{});
+            ring.mask_ = capacity - 1;
+        }
+    }
+};
+
+// Records [construction, destruction) as one zone when tracing is on.
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) noexcept
+        : name_(Tracer::enabled() ? name : nullptr), begin_ns_(name_ != nullptr ? Tracer::now_ns() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (name_ != nullptr)
+        {
+            Tracer::record(name_, begin_ns_, Tracer::now_ns());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name_;
+    std::int64_t begin_ns_;
+};
+
+#define GEMMBENCH_TRACE_CONCAT_(a, b) a##b
+#define GEMMBENCH_TRACE_CONCAT(a, b) GEMMBENCH_TRACE_CONCAT_(a, b)
+#if defined(GEMMBENCH_NO_TRACE)
+#define GEMMBENCH_TRACE_SCOPE(name) ((void)0)
+#else
+#define GEMMBENCH_TRACE_SCOPE(name) TraceScope GEMMBENCH_TRACE_CONCAT(gemmbench_trace_scope_, __LINE__)(name)
+#endif
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include "thread_pool.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define GEMMBENCH_TRANSPOSE_SSE 1
+#endif
+
+// Blocked matrix transpose. The matrix is cut into kTransposeTile square
+// tiles that are handed to ThreadPool::shared(); inside a tile 4x4 register
+// blocks are transposed with SSE shuffles, so source and destination are
+// both touched a cache line at a time and each tile stays within a few pages.
+
+namespace transpose_detail
+{
+constexpr int kTile = 64;
+constexpr int kBlock = 4;
+
+// dst[j * ld_dst + i] = src[i * ld_src + j] for one 4x4 block.
+inline void block_4x4(const float *src, std::size_t ld_src, float *dst, std::size_t ld_dst)
+{
+#if defined(GEMMBENCH_TRANSPOSE_SSE)
+    __m128 r0 = _mm_loadu_ps(src);
+    __m128 r1 = _mm_loadu_ps(src + ld_src);
+    __m128 r2 = _mm_loadu_ps(src + 2 * ld_src);
+    __m128 r3 = _mm_loadu_ps(src + 3 * ld_src);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(dst, r0);
+    _mm_storeu_ps(dst + ld_dst, r1);
+    _mm_storeu_ps(dst + 2 * ld_dst, r2);
+    _mm_storeu_ps(dst + 3 * ld_dst, r3);
+#else
+    for (int i = 0; i < kBlock; ++i)
+    {
+        for (int j = 0; j < kBlock; ++j)
+        {
+            dst[j * ld_dst + i] = src[i * ld_src + j];
+        }
+    }
+#endif
+}
+
+// Exchanges the 4x4 blocks at p and q (both in one matrix with stride ld),
+// transposing each. p == q transposes a diagonal block in place.
+inline void swap_block_4x4(float *p, float *q, std::size_t ld)
+{
+#if defined(GEMMBENCH_TRANSPOSE_SSE)
+    __m128 p0 = _mm_loadu_ps(p);
+    __m128 p1 = _mm_loadu_ps(p + ld);
+    __m128 p2 = _mm_loadu_ps(p + 2 * ld);
+    __m128 p3 = _mm_loadu_ps(p + 3 * ld);
+    __m128 q0 = _mm_loadu_ps(q);
+    __m128 q1 = _mm_loadu_ps(q + ld);
+    __m128 q2 = _mm_loadu_ps(q + 2 * ld);
+    __m128 q3 = _mm_loadu_ps(q + 3 * ld);
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    _MM_TRANSPOSE4_PS(q0, q1, q2, q3);
+    _mm_storeu_ps(q, p0);
+    _mm_storeu_ps(q + ld, p1);
+    _mm_storeu_ps(q + 2 * ld, p2);
+    _mm_storeu_ps(q + 3 * ld, p3);
+    _mm_storeu_ps(p, q0);
+    _mm_storeu_ps(p + ld, q1);
+    _mm_storeu_ps(p + 2 * ld, q2);
+    _mm_storeu_ps(p + 3 * ld, q3);
+#else
+    float tp[kBlock][kBlock];
+    float tq[kBlock][kBlock];
+    for (int i = 0; i < kBlock; ++i)
+    {
+        for (int j = 0; j < kBlock; ++j)
+        {
+            tp[j][i] = p[i * ld + j];
+            tq[j][i] = q[i * ld + j];
+        }
+    }
+    for (int i = 0; i < kBlock; ++i)
+    {
+        for (int j = 0; j < kBlock; ++j)
+        {
+            q[i * ld + j] = tp[i][j];
+            p[i * ld + j] = tq[i][j];
+        }
+    }
+#endif
+}
+
+// Out-of-place transpose of rows [i0, i1) x cols [j0, j1).
+inline void tile(const float *src, std::size_t ld_src, float *dst, std::size_t ld_dst,
+                 int i0, int i1, int j0, int j1)
+{
+    const int i_full = i0 + (i1 - i0) / kBlock * kBlock;
+    const int j_full = j0 + (j1 - j0) / kBlock * kBlock;
+    for (int i = i0; i < i_full; i += kBlock)
+    {
+        for (int j = j0; j < j_full; j += kBlock)
+        {
+            block_4x4(src + static_cast<std::size_t>(i) * ld_src + j, ld_src,
+                      dst + static_cast<std::size_t>(j) * ld_dst + i, ld_dst);
+        }
+    }
+    for (int i = i0; i < i1; ++i)
+    {
+        for (int j = (i < i_full ? j_full : j0); j < j1; ++j)
+        {
+            dst[static_cast<std::size_t>(j) * ld_dst + i] = src[static_cast<std::size_t>(i) * ld_src + j];
+        }
+    }
+}
+
+// In-place exchange of the n x n tile pair at (ti, tj) and (tj, ti), ti <= tj,
+// of a square matrix with n = dimension and stride ld.
+inline void swap_tile(float *a, std::size_t ld, int n, int ti, int tj)
+{
+    const int i0 = ti * kTile;
+    const int i1 = std::min(n, i0 + kTile);
+    const int j0 = tj * kTile;
+    const int j1 = std::min(n, j0 + kTile);
+    const int n_full = n / kBlock * kBlock;
+    for (int i = i0; i < std::min(i1, n_full); i += kBlock)
+    {
+        // On the diagonal tile only blocks at or above the diagonal move.
+        for (int j = ti == tj ? i : j0; j < std::min(j1, n_full); j += kBlock)
+        {
+            swap_block_4x4(a + static_cast<std::size_t>(i) * ld + j, a + static_cast<std::size_t>(j) * ld + i, ld);
+        }
+    }
+    // Elements in the ragged last rows/columns that the 4x4 blocks missed.
+    for (int i = i0; i < i1; ++i)
+    {
+        for (int j = std::max(j0, ti == tj ? i + 1 : j0); j < j1; ++j)
+        {
+            if (i < n_full && j < n_full)
+            {
+                continue;
+            }
+            std::swap(a[static_cast<std::size_t>(i) * ld + j], a[static_cast<std::size_t>(j) * ld + i]);
+        }
+    }
+}
+} // namespace transpose_detail
+
+// dst (cols x rows, stride ld_dst) = transpose of src (rows x cols, stride
+// ld_src). src and dst must not overlap.
+inline void transpose(const float *src, std::size_t ld_src, float *dst, std::size_t ld_dst, int rows, int cols)
+{
+    using namespace transpose_detail;
+    if (rows <= 0 || cols <= 0)
+    {
+        return;
+    }
+    const std::size_t tiles_i = (static_cast<std::size_t>(rows) + kTile - 1) / kTile;
+    const std::size_t tiles_j = (static_cast<std::size_t>(cols) + kTile - 1) / kTile;
+    ThreadPool::shared().parallel_for(tiles_i * tiles_j, 4, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            const int i0 = static_cast<int>(t / tiles_j) * kTile;
+            const int j0 = static_cast<int>(t % tiles_j) * kTile;
+            tile(src, ld_src, dst, ld_dst, i0, std::min(rows, i0 + kTile), j0, std::min(cols, j0 + kTile));
+        }
+    });
+}
+
+// In-place transpose of a square n x n matrix with stride ld; needs no extra
+// memory. Tile pairs above the diagonal are independent and run in parallel.
+inline void transpose_square_inplace(float *a, std::size_t ld, int n)
+{
+    using namespace transpose_detail;
+    if (n <= 1)
+    {
+        return;
+    }
+    const std::size_t tiles = (static_cast<std::size_t>(n) + kTile - 1) / kTile;
+    ThreadPool::shared().parallel_for(tiles, 1, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t ti = begin; ti < end; ++ti)
+        {
+            for (std::size_t tj = ti; tj < tiles; ++tj)
+            {
+                swap_tile(a, ld, n, static_cast<int>(ti), static_cast<int>(tj));
+            }
+        }
+    });
+}
@@ -0,0 +1,124 @@
+#include "batched_op.h"
+#include "gemm_kernels.h"
+#include "registry.h"
+
+#include <algorithm>
+
+BatchedGemmOp::BatchedGemmOp()
+    : kernel_(best_gemm_kernel()), num_threads_(ThreadPool::default_threads())
+{
+    per_thread_.resize(static_cast<std::size_t>(num_threads_));
+}
+
+void BatchedGemmOp::set_num_threads(int num_threads)
+{
+    num_threads = std::max(1, num_threads);
+    if (num_threads == num_threads_)
+    {
+        return;
+    }
+    num_threads_ = num_threads;
+    pool_.reset();
+    per_thread_.resize(static_cast<std::size_t>(num_threads_));
+}
+
+ThreadPool &BatchedGemmOp::pool()
+{
+    if (!pool_)
+    {
+        pool_ = std::make_unique<ThreadPool>(num_threads_);
+    }
+    return *pool_;
+}
+
+std::vector<int> BatchedGemmOp::worker_thread_ids() const
+{
+    return pool_ ? pool_->worker_thread_ids() : std::vector<int>{};
+}
+
+void BatchedGemmOp::run_on_threads(const std::function<void(int, int)> &job)
+{
+    pool().run(job);
+}
+
+void BatchedGemmOp::prepare(const GemmShape &shape, MatrixLayout /*layout*/)
+{
+    apply_tuning(shape);
+    pool();
+    const int mn = std::max(shape.M, shape.N);
+    const BlockingParams bp = normalize_blocking(kernel_, params_, mn, mn, shape.K);
+    for (auto &ws : per_thread_)
+    {
+        ws.reserve(kernel_, bp);
+    }
+}
+
+std::vector<TunableParam> BatchedGemmOp::tunables(const GemmShape &shape) const
+{
+    return blocking_tunables(kernel_, params_, shape);
+}
+
+bool BatchedGemmOp::set_tunable(const std::string &name, int value)
+{
+    return set_blocking_tunable(params_, name, value);
+}
+
+std::size_t BatchedGemmOp::workspace_size(const GemmShape &shape) const
+{
+    const int mn = std::max(shape.M, shape.N);
+    const BlockingParams bp = normalize_blocking(kernel_, params_, mn, mn, shape.K);
+    return (packed_a_size(kernel_, bp.mc, bp.kc) + packed_b_size(kernel_, bp.kc, bp.nc)) *
+           per_thread_.size() * sizeof(float);
+}
+
+std::size_t BatchedGemmOp::batch_grain(int M, int N, int K, int batch) const
+{
+    const double flops = 2.0 * std::max(M, 1) * std::max(N, 1) * std::max(K, 1);
+    const std::size_t by_flops = static_cast<std::size_t>(std::max(1.0, 1e6 / flops));
+    const std::size_t chunks = 4 * static_cast<std::size_t>(num_threads_);
+    const std::size_t by_balance = (static_cast<std::size_t>(std::max(batch, 1)) + chunks - 1) / chunks;
+    return std::min(by_flops, by_balance);
+}
+
+void BatchedGemmOp::run(const float *A, const float *B, float *C,
+                        int M, int N, int K)
+{
+    blocked_gemm(kernel_, params_, per_thread_[0], A, B, C, M, N, K);
+}
+
+void BatchedGemmOp::run_strided(const GemmArgs &args)
+{
+    blocked_gemm(kernel_, params_, per_thread_[0], args.A, args.B, args.C,
+                 args.M, args.N, args.K, args.alpha, args.beta);
+}
+
+void BatchedGemmOp::run_batched(const float *const *A, const float *const *B, float *const *C,
+                                int M, int N, int K, int batch)
+{
+    pool().parallel_for(static_cast<std::size_t>(std::max(batch, 0)), batch_grain(M, N, K, batch),
+                        [&](std::size_t begin, std::size_t end, int tid) {
+                            GemmWorkspace &ws = per_thread_[static_cast<std::size_t>(tid)];
+                            for (std::size_t i = begin; i < end; ++i)
+                            {
+                                blocked_gemm(kernel_, params_, ws, A[i], B[i], C[i], M, N, K);
+                            }
+                        });
+}
+
+void BatchedGemmOp::run_strided_batched(const float *A, std::size_t stride_a,
+                                        const float *B, std::size_t stride_b,
+                                        float *C, std::size_t stride_c,
+                                        int M, int N, int K, int batch)
+{
+    pool().parallel_for(static_cast<std::size_t>(std::max(batch, 0)), batch_grain(M, N, K, batch),
+                        [&](std::size_t begin, std::size_t end, int tid) {
+                            GemmWorkspace &ws = per_thread_[static_cast<std::size_t>(tid)];
+                            for (std::size_t i = begin; i < end; ++i)
+                            {
+                                blocked_gemm(kernel_, params_, ws, A + i * stride_a, B + i * stride_b,
+                                             C + i * stride_c, M, N, K);
+                            }
+                        });
+}
+
+REGISTER_GEMM_OP(BatchedGemmOp)
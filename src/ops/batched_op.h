@@ -0,0 +1,49 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "gemm_op.h"
+#include "blocked_gemm.h"
+#include "../common/thread_pool.h"
+
+// Reference batched GEMM for many small problems (e.g. one 64x64x64 GEMM per
+// attention head). Whole entries are handed to the threads of a persistent
+// pool, and each entry runs the serial blocked driver with the calling
+// thread's workspace, so there is no per-GEMM synchronization. A single
+// GEMM (run) is not split and runs on the calling thread.
+class BatchedGemmOp : public GemmOp
+{
+public:
+    BatchedGemmOp();
+    std::string name() const override { return "batched"; }
+    void run(const float *A, const float *B, float *C,
+             int M, int N, int K) override;
+    void run_strided(const GemmArgs &args) override;
+    void run_batched(const float *const *A, const float *const *B, float *const *C,
+                     int M, int N, int K, int batch) override;
+    void run_strided_batched(const float *A, std::size_t stride_a,
+                             const float *B, std::size_t stride_b,
+                             float *C, std::size_t stride_c,
+                             int M, int N, int K, int batch) override;
+    void set_num_threads(int num_threads) override;
+    int num_threads() const override { return num_threads_; }
+    std::vector<int> worker_thread_ids() const override;
+    void run_on_threads(const std::function<void(int, int)> &job) override;
+    void prepare(const GemmShape &shape, MatrixLayout layout) override;
+    std::size_t workspace_size(const GemmShape &shape) const override;
+    std::vector<TunableParam> tunables(const GemmShape &shape) const override;
+    bool set_tunable(const std::string &name, int value) override;
+
+private:
+    // Entries per scheduling chunk: about 1 MFLOP so tiny GEMMs are not
+    // dispatched one at a time, but at least four chunks per thread.
+    std::size_t batch_grain(int M, int N, int K, int batch) const;
+    // Starts the pool on first use (prepare or a batched run).
+    ThreadPool &pool();
+
+    const GemmKernel &kernel_;
+    BlockingParams params_;
+    int num_threads_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::vector<GemmWorkspace> per_thread_;
+};
@@ -0,0 +1,486 @@
+#include "blocked_gemm.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "../common/thread_pool.h"
+#include "../common/trace.h"
+
+namespace
+{
+constexpr int kGenericMR = 6;
+constexpr int kGenericNR = 8;
+
+int round_up(int value, int multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+int round_down_at_least(int value, int multiple)
+{
+    return std::max(multiple, value / multiple * multiple);
+}
+
+void generic_micro_kernel(int kc, const float *a_panel, const float *b_panel,
+                          float *C, int ldc, int m, int n, bool accumulate)
+{
+    float acc[kGenericMR][kGenericNR] = {};
+    for (int p = 0; p < kc; ++p)
+    {
+        const float *a = a_panel + static_cast<std::size_t>(p) * kGenericMR;
+        // Copying the B row into a local array lets the compiler keep acc in
+        // vector registers instead of reloading it through possible aliases.
+        float b[kGenericNR];
+        std::memcpy(b, b_panel + static_cast<std::size_t>(p) * kGenericNR, sizeof(b));
+        for (int i = 0; i < kGenericMR; ++i)
+        {
+            for (int j = 0; j < kGenericNR; ++j)
+            {
+                acc[i][j] += a[i] * b[j];
+            }
+        }
+    }
+
+    for (int i = 0; i < m; ++i)
+    {
+        float *c_row = C + static_cast<std::size_t>(i) * ldc;
+        for (int j = 0; j < n; ++j)
+        {
+            c_row[j] = accumulate ? c_row[j] + acc[i][j] : acc[i][j];
+        }
+    }
+}
+} // namespace
+
+const GemmKernel &generic_gemm_kernel()
+{
+    static const GemmKernel kernel{"generic", kGenericMR, kGenericNR, generic_micro_kernel};
+    return kernel;
+}
+
+void store_partial_tile(const float *tile, int ld_tile, float *C, int ldc,
+                        int m, int n, bool accumulate)
+{
+    for (int i = 0; i < m; ++i)
+    {
+        const float *t_row = tile + static_cast<std::size_t>(i) * ld_tile;
+        float *c_row = C + static_cast<std::size_t>(i) * ldc;
+        for (int j = 0; j < n; ++j)
+        {
+            c_row[j] = accumulate ? c_row[j] + t_row[j] : t_row[j];
+        }
+    }
+}
+
+BlockingParams normalize_blocking(const GemmKernel &kernel, const BlockingParams &params,
+                                  int M, int N, int K)
+{
+    BlockingParams out;
+    out.mc = std::min(round_down_at_least(params.mc, kernel.mr), round_up(std::max(M, 1), kernel.mr));
+    out.nc = std::min(round_down_at_least(params.nc, kernel.nr), round_up(std::max(N, 1), kernel.nr));
+    out.kc = std::min(std::max(params.kc, 1), std::max(K, 1));
+    return out;
+}
+
+std::vector<int> blocking_candidates(const std::vector<int> &sizes, int multiple, int extent)
+{
+    const int limit = round_up(std::max(extent, 1), multiple);
+    std::vector<int> out;
+    for (int size : sizes)
+    {
+        out.push_back(std::min(round_down_at_least(size, multiple), limit));
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+std::vector<TunableParam> blocking_tunables(const GemmKernel &kernel, const BlockingParams &params,
+                                            const GemmShape &shape)
+{
+    // Spans roughly half to twice the defaults: A blocks from L1- to
+    // L2-sized, B blocks up to a large share of the LLC.
+    return {
+        TunableParam{"mc", params.mc, blocking_candidates({48, 72, 96, 144, 192, 288}, kernel.mr, shape.M)},
+        TunableParam{"kc", params.kc, blocking_candidates({64, 128, 192, 256, 384, 512}, 1, shape.K)},
+        TunableParam{"nc", params.nc, blocking_candidates({512, 1024, 2048, 4096, 8192}, kernel.nr, shape.N)},
+    };
+}
+
+bool set_blocking_tunable(BlockingParams &params, const std::string &name, int value)
+{
+    if (value <= 0)
+    {
+        return false;
+    }
+    if (name == "mc")
+    {
+        params.mc = value;
+    }
+    else if (name == "kc")
+    {
+        params.kc = value;
+    }
+    else if (name == "nc")
+    {
+        params.nc = value;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+std::size_t packed_a_size(const GemmKernel &kernel, int mc, int kc)
+{
+    return static_cast<std::size_t>(round_up(mc, kernel.mr)) * static_cast<std::size_t>(kc);
+}
+
+std::size_t packed_b_size(const GemmKernel &kernel, int kc, int nc)
+{
+    return static_cast<std::size_t>(round_up(nc, kernel.nr)) * static_cast<std::size_t>(kc);
+}
+
+void pack_a(const float *A, int lda, int mc, int kc, int mr, float *dst)
+{
+    GEMMBENCH_TRACE_SCOPE("pack_a");
+    for (int ir = 0; ir < mc; ir += mr)
+    {
+        const int rows = std::min(mr, mc - ir);
+        for (int p = 0; p < kc; ++p)
+        {
+            int i = 0;
+            for (; i < rows; ++i)
+            {
+                dst[i] = A[static_cast<std::size_t>(ir + i) * lda + p];
+            }
+            for (; i < mr; ++i)
+            {
+                dst[i] = 0.0f;
+            }
+            dst += mr;
+        }
+    }
+}
+
+void pack_b(const float *B, int ldb, int kc, int nc, int nr, float *dst)
+{
+    GEMMBENCH_TRACE_SCOPE("pack_b");
+    for (int jr = 0; jr < nc; jr += nr)
+    {
+        const int cols = std::min(nr, nc - jr);
+        for (int p = 0; p < kc; ++p)
+        {
+            const float *src = B + static_cast<std::size_t>(p) * ldb + jr;
+            std::memcpy(dst, src, static_cast<std::size_t>(cols) * sizeof(float));
+            for (int j = cols; j < nr; ++j)
+            {
+                dst[j] = 0.0f;
+            }
+            dst += nr;
+        }
+    }
+}
+
+void macro_kernel(const GemmKernel &kernel, int mc, int nc, int kc,
+                  const float *a_packed, const float *b_packed,
+                  float *C, int ldc, bool accumulate)
+{
+    GEMMBENCH_TRACE_SCOPE("compute");
+    const std::size_t a_panel_stride = static_cast<std::size_t>(kernel.mr) * kc;
+    const std::size_t b_panel_stride = static_cast<std::size_t>(kernel.nr) * kc;
+
+    for (int jr = 0; jr < nc; jr += kernel.nr)
+    {
+        const int n = std::min(kernel.nr, nc - jr);
+        const float *b_panel = b_packed + static_cast<std::size_t>(jr / kernel.nr) * b_panel_stride;
+        for (int ir = 0; ir < mc; ir += kernel.mr)
+        {
+            const int m = std::min(kernel.mr, mc - ir);
+            const float *a_panel = a_packed + static_cast<std::size_t>(ir / kernel.mr) * a_panel_stride;
+            kernel.fn(kc, a_panel, b_panel,
+                      C + static_cast<std::size_t>(ir) * ldc + jr, ldc,
+                      m, n, accumulate);
+        }
+    }
+}
+
+void pack_a_strided(const float *A, std::size_t rs, std::size_t cs, int mc, int kc, int mr,
+                    float alpha, float *dst)
+{
+    GEMMBENCH_TRACE_SCOPE("pack_a");
+    for (int ir = 0; ir < mc; ir += mr)
+    {
+        const int rows = std::min(mr, mc - ir);
+        for (int p = 0; p < kc; ++p)
+        {
+            const float *src = A + static_cast<std::size_t>(ir) * rs + static_cast<std::size_t>(p) * cs;
+            int i = 0;
+            for (; i < rows; ++i)
+            {
+                dst[i] = alpha * src[static_cast<std::size_t>(i) * rs];
+            }
+            for (; i < mr; ++i)
+            {
+                dst[i] = 0.0f;
+            }
+            dst += mr;
+        }
+    }
+}
+
+void pack_b_strided(const float *B, std::size_t rs, std::size_t cs, int kc, int nc, int nr, float *dst)
+{
+    GEMMBENCH_TRACE_SCOPE("pack_b");
+    for (int jr = 0; jr < nc; jr += nr)
+    {
+        const int cols = std::min(nr, nc - jr);
+        for (int p = 0; p < kc; ++p)
+        {
+            const float *src = B + static_cast<std::size_t>(p) * rs + static_cast<std::size_t>(jr) * cs;
+            int j = 0;
+            for (; j < cols; ++j)
+            {
+                dst[j] = src[static_cast<std::size_t>(j) * cs];
+            }
+            for (; j < nr; ++j)
+            {
+                dst[j] = 0.0f;
+            }
+            dst += nr;
+        }
+    }
+}
+
+void GemmWorkspace::reserve(const GemmKernel &kernel, const BlockingParams &params)
+{
+    const std::size_t a_needed = packed_a_size(kernel, params.mc, params.kc);
+    const std::size_t b_needed = packed_b_size(kernel, params.kc, params.nc);
+    if (a_packed.size() < a_needed)
+    {
+        a_packed = MatrixBuffer::allocate_uninitialized(a_needed, 64);
+    }
+    if (b_packed.size() < b_needed)
+    {
+        b_packed = MatrixBuffer::allocate_uninitialized(b_needed, 64);
+    }
+}
+
+const float *PackedB::block(int jc, int pc) const noexcept
+{
+    const std::size_t width = static_cast<std::size_t>(round_up(std::min(nc, N - jc), nr));
+    return panels.data() + static_cast<std::size_t>(jc) * K + width * static_cast<std::size_t>(pc);
+}
+
+void prepack_b(const GemmKernel &kernel, const BlockingParams &params,
+               const MatrixView &B, PackedB &out)
+{
+    const int K = B.logical_rows();
+    const int N = B.logical_cols();
+    const BlockingParams bp = normalize_blocking(kernel, params, 1, N, K);
+    out.clear();
+    if (K <= 0 || N <= 0)
+    {
+        return;
+    }
+    out.panels = MatrixBuffer::allocate_uninitialized(
+        static_cast<std::size_t>(round_up(N, kernel.nr)) * static_cast<std::size_t>(K), 64);
+    out.source = B.data;
+    out.rs = B.row_stride();
+    out.cs = B.col_stride();
+    out.K = K;
+    out.N = N;
+    out.nr = kernel.nr;
+    out.kc = bp.kc;
+    out.nc = bp.nc;
+
+    const std::size_t k_blocks = static_cast<std::size_t>((K + bp.kc - 1) / bp.kc);
+    const std::size_t n_blocks = static_cast<std::size_t>((N + bp.nc - 1) / bp.nc);
+    ThreadPool::shared().parallel_for(n_blocks * k_blocks, 1, [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            const int jc = static_cast<int>(t / k_blocks) * bp.nc;
+            const int pc = static_cast<int>(t % k_blocks) * bp.kc;
+            const int nc = std::min(bp.nc, N - jc);
+            const int kc = std::min(bp.kc, K - pc);
+            const float *src = out.source + static_cast<std::size_t>(pc) * out.rs + static_cast<std::size_t>(jc) * out.cs;
+            float *dst = const_cast<float *>(out.block(jc, pc));
+            if (out.cs == 1)
+            {
+                pack_b(src, static_cast<int>(out.rs), kc, nc, kernel.nr, dst);
+            }
+            else
+            {
+                pack_b_strided(src, out.rs, out.cs, kc, nc, kernel.nr, dst);
+            }
+        }
+    });
+}
+
+void blocked_gemm(const GemmKernel &kernel, const BlockingParams &params,
+                  GemmWorkspace &ws,
+                  const float *A, int lda, const float *B, int ldb,
+                  float *C, int ldc,
+                  int M, int N, int K, bool accumulate,
+                  const PackedB *prepacked)
+{
+    if (M <= 0 || N <= 0)
+    {
+        return;
+    }
+    if (K <= 0)
+    {
+        if (!accumulate)
+        {
+            for (int i = 0; i < M; ++i)
+            {
+                std::memset(C + static_cast<std::size_t>(i) * ldc, 0, static_cast<std::size_t>(N) * sizeof(float));
+            }
+        }
+        return;
+    }
+
+    const BlockingParams bp = normalize_blocking(kernel, params, M, N, K);
+    ws.reserve(kernel, bp);
+    float *a_buf = ws.a_packed.data();
+    if (prepacked != nullptr && !prepacked->matches(B, static_cast<std::size_t>(ldb), 1, K, N, bp))
+    {
+        prepacked = nullptr;
+    }
+
+    for (int jc = 0; jc < N; jc += bp.nc)
+    {
+        const int nc = std::min(bp.nc, N - jc);
+        for (int pc = 0; pc < K; pc += bp.kc)
+        {
+            const int kc = std::min(bp.kc, K - pc);
+            const float *b_buf = ws.b_packed.data();
+            if (prepacked != nullptr)
+            {
+                b_buf = prepacked->block(jc, pc);
+            }
+            else
+            {
+                pack_b(B + static_cast<std::size_t>(pc) * ldb + jc, ldb, kc, nc, kernel.nr, ws.b_packed.data());
+            }
+            for (int ic = 0; ic < M; ic += bp.mc)
+            {
+                const int mc = std::min(bp.mc, M - ic);
+                pack_a(A + static_cast<std::size_t>(ic) * lda + pc, lda, mc, kc, kernel.mr, a_buf);
+                macro_kernel(kernel, mc, nc, kc, a_buf, b_buf,
+                             C + static_cast<std::size_t>(ic) * ldc + jc, ldc, accumulate || pc != 0);
+            }
+        }
+    }
+}
+
+void blocked_gemm(const GemmKernel &kernel, const BlockingParams &params,
+                  GemmWorkspace &ws,
+                  const float *A, const float *B, float *C,
+                  int M, int N, int K)
+{
+    blocked_gemm(kernel, params, ws, A, K, B, N, C, N, M, N, K);
+}
+
+void blocked_gemm(const GemmKernel &kernel, const BlockingParams &params,
+                  GemmWorkspace &ws,
+                  const MatrixView &A, const MatrixView &B, const MutableMatrixView &C,
+                  int M, int N, int K, float alpha, float beta,
+                  const PackedB *prepacked)
+{
+    if (M <= 0 || N <= 0)
+    {
+        return;
+    }
+
+    // Element (i, j) of each operand is at ptr[i * rs + j * cs].
+    const float *a = A.data;
+    std::size_t a_rs = A.row_stride();
+    std::size_t a_cs = A.col_stride();
+    const float *b = B.data;
+    std::size_t b_rs = B.row_stride();
+    std::size_t b_cs = B.col_stride();
+    std::size_t c_rs = C.row_stride();
+    if (C.col_stride() != 1)
+    {
+        // The kernels store rows of C; for column-major C compute
+        // C^T = op(B)^T * op(A)^T instead.
+        std::swap(M, N);
+        std::swap(a, b);
+        a_rs = B.col_stride();
+        a_cs = B.row_stride();
+        b_rs = A.col_stride();
+        b_cs = A.row_stride();
+        c_rs = C.col_stride();
+        prepacked = nullptr;
+    }
+    float *c = C.data;
+
+    // Apply beta up front; the kernels only overwrite or accumulate.
+    const bool scale_c = beta != 0.0f && beta != 1.0f;
+    if (scale_c || K <= 0 || alpha == 0.0f)
+    {
+        for (int i = 0; i < M; ++i)
+        {
+            float *row = c + static_cast<std::size_t>(i) * c_rs;
+            for (int j = 0; j < N; ++j)
+            {
+                row[j] = beta == 0.0f ? 0.0f : beta * row[j];
+            }
+        }
+        if (K <= 0 || alpha == 0.0f)
+        {
+            return;
+        }
+    }
+    const bool accumulate = beta != 0.0f;
+
+    const BlockingParams bp = normalize_blocking(kernel, params, M, N, K);
+    ws.reserve(kernel, bp);
+    float *a_buf = ws.a_packed.data();
+    const int ldc = static_cast<int>(c_rs);
+    if (prepacked != nullptr && !prepacked->matches(b, b_rs, b_cs, K, N, bp))
+    {
+        prepacked = nullptr;
+    }
+
+    for (int jc = 0; jc < N; jc += bp.nc)
+    {
+        const int nc = std::min(bp.nc, N - jc);
+        for (int pc = 0; pc < K; pc += bp.kc)
+        {
+            const int kc = std::min(bp.kc, K - pc);
+            const float *b_block = b + static_cast<std::size_t>(pc) * b_rs + static_cast<std::size_t>(jc) * b_cs;
+            const float *b_buf = ws.b_packed.data();
+            if (prepacked != nullptr)
+            {
+                b_buf = prepacked->block(jc, pc);
+            }
+            else if (b_cs == 1)
+            {
+                pack_b(b_block, static_cast<int>(b_rs), kc, nc, kernel.nr, ws.b_packed.data());
+            }
+            else
+            {
+                pack_b_strided(b_block, b_rs, b_cs, kc, nc, kernel.nr, ws.b_packed.data());
+            }
+            for (int ic = 0; ic < M; ic += bp.mc)
+            {
+                const int mc = std::min(bp.mc, M - ic);
+                const float *a_block = a + static_cast<std::size_t>(ic) * a_rs + static_cast<std::size_t>(pc) * a_cs;
+                if (a_cs == 1 && alpha == 1.0f)
+                {
+                    pack_a(a_block, static_cast<int>(a_rs), mc, kc, kernel.mr, a_buf);
+                }
+                else
+                {
+                    pack_a_strided(a_block, a_rs, a_cs, mc, kc, kernel.mr, alpha, a_buf);
+                }
+                macro_kernel(kernel, mc, nc, kc, a_buf, b_buf,
+                             c + static_cast<std::size_t>(ic) * c_rs + jc, ldc, accumulate || pc != 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../common/matrix_buffer.h"
+#include "../common/matrix_view.h"
+#include "tuning_cache.h"
+
+// Building blocks for Goto/BLIS style GEMM: MC/KC/NC cache blocking,
+// packed A/B panels and an MR x NR register micro-kernel.
+//
+// Packed A: ceil(mc / MR) micro-panels, each laid out as [kc][MR].
+// Packed B: ceil(nc / NR) micro-panels, each laid out as [kc][NR].
+// Edge panels are zero padded, so micro-kernels always compute a full tile.
+
+// Computes the MR x NR tile a_panel * b_panel and writes its top-left m x n
+// corner into C (row stride ldc). If accumulate is false C is overwritten,
+// otherwise the tile is added to C.
+using MicroKernelFn = void (*)(int kc, const float *a_panel, const float *b_panel,
+                               float *C, int ldc, int m, int n, bool accumulate);
+
+struct GemmKernel
+{
+    const char *isa;
+    int mr;
+    int nr;
+    MicroKernelFn fn;
+};
+
+struct BlockingParams
+{
+    int mc = 96;
+    int kc = 256;
+    int nc = 4096;
+};
+
+// Portable kernel written for compiler auto-vectorization.
+const GemmKernel &generic_gemm_kernel();
+
+// Writes the top-left m x n corner of a full tile (row stride ld_tile) into C.
+// Used by SIMD kernels for edge tiles that cannot be stored with vector ops.
+void store_partial_tile(const float *tile, int ld_tile, float *C, int ldc,
+                        int m, int n, bool accumulate);
+
+// Rounds the blocking sizes to multiples of the kernel tile and clamps them to
+// the problem size, so packed buffers are never larger than necessary.
+BlockingParams normalize_blocking(const GemmKernel &kernel, const BlockingParams &params,
+                                  int M, int N, int K);
+
+// Autotuning candidates: sizes rounded to multiples of multiple and clamped
+// to extent (rounded up), deduplicated and ascending, so sizes that behave
+// identically for the shape are only searched once.
+std::vector<int> blocking_candidates(const std::vector<int> &sizes, int multiple, int extent);
+
+// The "mc", "kc" and "nc" knobs of params for shape, and the setter ops
+// forward to from set_tunable(). The setter rejects other names and
+// non-positive values.
+std::vector<TunableParam> blocking_tunables(const GemmKernel &kernel, const BlockingParams &params,
+                                            const GemmShape &shape);
+bool set_blocking_tunable(BlockingParams &params, const std::string &name, int value);
+
+std::size_t packed_a_size(const GemmKernel &kernel, int mc, int kc);
+std::size_t packed_b_size(const GemmKernel &kernel, int kc, int nc);
+
+void pack_a(const float *A, int lda, int mc, int kc, int mr, float *dst);
+void pack_b(const float *B, int ldb, int kc, int nc, int nr, float *dst);
+
+// General-stride packing: element (i, p) of A is A[i * rs + p * cs]. pack_a
+// also folds alpha into the packed panel, so the kernels never see it.
+void pack_a_strided(const float *A, std::size_t rs, std::size_t cs, int mc, int kc, int mr,
+                    float alpha, float *dst);
+void pack_b_strided(const float *B, std::size_t rs, std::size_t cs, int kc, int nc, int nr, float *dst);
+
+// Runs the two innermost loops (jr over NR, ir over MR) on one packed block.
+void macro_kernel(const GemmKernel &kernel, int mc, int nc, int kc,
+                  const float *a_packed, const float *b_packed,
+                  float *C, int ldc, bool accumulate);
+
+// Reusable packing buffers, grown on demand so repeated calls do not allocate.
+struct GemmWorkspace
+{
+    MatrixBuffer a_packed;
+    MatrixBuffer b_packed;
+
+    void reserve(const GemmKernel &kernel, const BlockingParams &params);
+};
+
+// All of B packed ahead of time (pre-packed weights): the (jc, pc) blocks the
+// driver would pack, stored in loop order, so runs with the same B skip
+// pack_b. Full NC blocks are multiples of NR wide, which puts block (jc, pc)
+// at jc * K + round_up(nc, NR) * pc.
+struct PackedB
+{
+    MatrixBuffer panels;
+    const float *source = nullptr; // B the panels were packed from
+    std::size_t rs = 0;            // element (p, j) of B is source[p * rs + j * cs]
+    std::size_t cs = 0;
+    int K = 0;
+    int N = 0;
+    int nr = 0;
+    int kc = 0; // normalized blocking the layout was built for
+    int nc = 0;
+
+    bool empty() const noexcept { return source == nullptr; }
+    void clear() noexcept { *this = PackedB{}; }
+    // True if these panels hold B (same memory, strides and shape) packed for
+    // blocking bp; otherwise the caller packs as usual.
+    bool matches(const float *B, std::size_t b_rs, std::size_t b_cs, int b_k, int b_n,
+                 const BlockingParams &bp) const noexcept
+    {
+        return source != nullptr && source == B && rs == b_rs && cs == b_cs && K == b_k && N == b_n &&
+               kc == bp.kc && nc == bp.nc;
+    }
+    const float *block(int jc, int pc) const noexcept;
+};
+
+// Packs op(B) (K x N) for kernel and the blocking a K x N problem normalizes
+// to. Blocks are packed in parallel on ThreadPool::shared().
+void prepack_b(const GemmKernel &kernel, const BlockingParams &params,
+               const MatrixView &B, PackedB &out);
+
+// Single-threaded five-loop GEMM on row-major operands with leading
+// dimensions lda/ldb/ldc: C = A * B, or C += A * B when accumulate is set.
+// B's panels are taken from prepacked when it matches B.
+void blocked_gemm(const GemmKernel &kernel, const BlockingParams &params,
+                  GemmWorkspace &ws,
+                  const float *A, int lda, const float *B, int ldb,
+                  float *C, int ldc,
+                  int M, int N, int K, bool accumulate = false,
+                  const PackedB *prepacked = nullptr);
+
+// Dense row-major convenience overload (lda = K, ldb = ldc = N).
+void blocked_gemm(const GemmKernel &kernel, const BlockingParams &params,
+                  GemmWorkspace &ws,
+                  const float *A, const float *B, float *C,
+                  int M, int N, int K);
+
+// C = alpha * op(A) * op(B) + beta * C on strided views (any layout and
+// transpose flags). Column-major C is handled as C^T = op(B)^T * op(A)^T, and
+// prepacked is then ignored.
+void blocked_gemm(const GemmKernel &kernel, const BlockingParams &params,
+                  GemmWorkspace &ws,
+                  const MatrixView &A, const MatrixView &B, const MutableMatrixView &C,
+                  int M, int N, int K, float alpha, float beta,
+                  const PackedB *prepacked = nullptr);
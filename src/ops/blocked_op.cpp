@@ -0,0 +1,90 @@
+#include "blocked_op.h"
+#include "registry.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+BlockedGemmOp::BlockedGemmOp()
+    : BlockedGemmOp("blocked", &generic_gemm_kernel(), "")
+{
+}
+
+BlockedGemmOp::BlockedGemmOp(std::string name, const GemmKernel *kernel, std::string required_isa)
+    : name_(std::move(name)), kernel_(kernel), required_isa_(std::move(required_isa))
+{
+}
+
+void BlockedGemmOp::run(const float *A, const float *B, float *C,
+                        int M, int N, int K)
+{
+    require_kernel();
+    blocked_gemm(*kernel_, params_, workspace_, A, K, B, N, C, N, M, N, K, false,
+                 packed_b_.empty() ? nullptr : &packed_b_);
+}
+
+void BlockedGemmOp::run_strided(const GemmArgs &args)
+{
+    require_kernel();
+    blocked_gemm(*kernel_, params_, workspace_, args.A, args.B, args.C,
+                 args.M, args.N, args.K, args.alpha, args.beta,
+                 packed_b_.empty() ? nullptr : &packed_b_);
+}
+
+void BlockedGemmOp::prepare(const GemmShape &shape, MatrixLayout /*layout*/)
+{
+    require_kernel();
+    apply_tuning(shape);
+    // Column-major C swaps the roles of M and N; reserving the larger of the
+    // two covers both.
+    const int mn = std::max(shape.M, shape.N);
+    workspace_.reserve(*kernel_, normalize_blocking(*kernel_, params_, mn, mn, shape.K));
+    if (packed_b_.K != shape.K || packed_b_.N != shape.N)
+    {
+        packed_b_.clear();
+    }
+}
+
+std::size_t BlockedGemmOp::workspace_size(const GemmShape &shape) const
+{
+    if (kernel_ == nullptr)
+    {
+        return 0;
+    }
+    const int mn = std::max(shape.M, shape.N);
+    const BlockingParams bp = normalize_blocking(*kernel_, params_, mn, mn, shape.K);
+    return (packed_a_size(*kernel_, bp.mc, bp.kc) + packed_b_size(*kernel_, bp.kc, bp.nc) +
+            packed_b_.panels.size()) * sizeof(float);
+}
+
+bool BlockedGemmOp::pack_b(const MatrixView &B)
+{
+    require_kernel();
+    prepack_b(*kernel_, params_, B, packed_b_);
+    return !packed_b_.empty();
+}
+
+std::vector<TunableParam> BlockedGemmOp::tunables(const GemmShape &shape) const
+{
+    if (kernel_ == nullptr)
+    {
+        return {};
+    }
+    return blocking_tunables(*kernel_, params_, shape);
+}
+
+bool BlockedGemmOp::set_tunable(const std::string &name, int value)
+{
+    return set_blocking_tunable(params_, name, value);
+}
+
+void BlockedGemmOp::require_kernel() const
+{
+    if (kernel_ == nullptr)
+    {
+        throw std::runtime_error("Operator " + name_ + " requires " + required_isa_ +
+                                 ", which this CPU does not support");
+    }
+}
+
+REGISTER_GEMM_OP(BlockedGemmOp)
@@ -0,0 +1,35 @@
+#pragma once
+#include "gemm_op.h"
+#include "blocked_gemm.h"
+
+// Cache-blocked GEMM with packed A/B panels. The default instance uses the
+// portable micro-kernel; subclasses plug in ISA-specific kernels.
+class BlockedGemmOp : public GemmOp
+{
+public:
+    BlockedGemmOp();
+    std::string name() const override { return name_; }
+    void run(const float *A, const float *B, float *C,
+             int M, int N, int K) override;
+    // Strides, transposes and alpha/beta are handled by the packing routines,
+    // so no dense copies are made.
+    void run_strided(const GemmArgs &args) override;
+    void prepare(const GemmShape &shape, MatrixLayout layout) override;
+    std::size_t workspace_size(const GemmShape &shape) const override;
+    bool pack_b(const MatrixView &B) override;
+    std::vector<TunableParam> tunables(const GemmShape &shape) const override;
+    bool set_tunable(const std::string &name, int value) override;
+
+protected:
+    // kernel may be nullptr when the host lacks the required ISA; run() then
+    // reports required_isa in the error.
+    BlockedGemmOp(std::string name, const GemmKernel *kernel, std::string required_isa);
+    void require_kernel() const;
+
+    std::string name_;
+    const GemmKernel *kernel_;
+    std::string required_isa_;
+    BlockingParams params_;
+    GemmWorkspace workspace_;
+    PackedB packed_b_;
+};
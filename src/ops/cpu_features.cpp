@@ -0,0 +1,58 @@
+#include "cpu_features.h"
+
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define GEMMBENCH_X86_CPUID 1
+#endif
+
+namespace
+{
+#if defined(GEMMBENCH_X86_CPUID)
+std::uint64_t read_xcr0()
+{
+    std::uint32_t eax = 0;
+    std::uint32_t edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<std::uint64_t>(edx) << 32) | eax;
+}
+
+CpuFeatures detect_cpu_features()
+{
+    CpuFeatures features;
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return features;
+    }
+
+    features.sse42 = (ecx & bit_SSE4_2) != 0;
+    const bool has_avx = (ecx & bit_AVX) != 0;
+    const bool has_fma = (ecx & bit_FMA) != 0;
+    const std::uint64_t xcr0 = (ecx & bit_OSXSAVE) != 0 ? read_xcr0() : 0;
+    // XMM|YMM state, plus opmask|ZMM_Hi256|Hi16_ZMM state for AVX-512.
+    const bool os_ymm = (xcr0 & 0x6) == 0x6;
+    const bool os_zmm = (xcr0 & 0xe6) == 0xe6;
+
+    features.fma = has_avx && has_fma && os_ymm;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        features.avx2 = has_avx && os_ymm && (ebx & bit_AVX2) != 0;
+        features.avx512f = os_zmm && (ebx & bit_AVX512F) != 0;
+    }
+    return features;
+}
+#else
+CpuFeatures detect_cpu_features()
+{
+    return CpuFeatures{};
+}
+#endif
+} // namespace
+
+const CpuFeatures &cpu_features()
+{
+    static const CpuFeatures features = detect_cpu_features();
+    return features;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Instruction set extensions usable by the running process. A feature is only
+// reported when both the CPU and the OS (XSAVE-enabled register state) allow it.
+struct CpuFeatures
+{
+    bool sse42 = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool avx512f = false;
+};
+
+// Detected once via cpuid on first use and cached afterwards.
+const CpuFeatures &cpu_features();
@@ -0,0 +1,15 @@
+#include "gemm_kernels.h"
+
+const GemmKernel &best_gemm_kernel()
+{
+    static const GemmKernel *kernel = []() {
+        if (const GemmKernel *k = avx512_gemm_kernel())
+            return k;
+        if (const GemmKernel *k = avx2_gemm_kernel())
+            return k;
+        if (const GemmKernel *k = sse42_gemm_kernel())
+            return k;
+        return &generic_gemm_kernel();
+    }();
+    return *kernel;
+}
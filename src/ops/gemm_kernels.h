@@ -0,0 +1,22 @@
+#pragma once
+
+#include "blocked_gemm.h"
+
+// Hand-vectorized x86 micro-kernels. Each getter returns nullptr when the
+// kernel was not compiled for this architecture or the running CPU lacks the
+// instruction set, so callers can probe availability at runtime.
+const GemmKernel *sse42_gemm_kernel(); // 6 x 8,  SSE4.2
+const GemmKernel *avx2_gemm_kernel();  // 6 x 16, AVX2 + FMA
+const GemmKernel *avx512_gemm_kernel(); // 14 x 32, AVX-512F
+
+// Widest kernel supported by the running CPU, selected once on first use.
+// Falls back to generic_gemm_kernel() on hosts without any SIMD kernel.
+const GemmKernel &best_gemm_kernel();
+
+// Kernel-specific code is compiled with per-function target attributes
+// instead of per-file -m flags, so no AVX code leaks into inline functions
+// shared with the rest of the binary.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMMBENCH_X86_KERNELS 1
+#define GEMMBENCH_TARGET(isa) __attribute__((target(isa)))
+#endif
@@ -0,0 +1,190 @@
+#include "gemm_op.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../common/transpose.h"
+
+namespace
+{
+void check_args(const GemmArgs &args)
+{
+    if (args.A.logical_rows() != args.M || args.A.logical_cols() != args.K ||
+        args.B.logical_rows() != args.K || args.B.logical_cols() != args.N ||
+        args.C.logical_rows() != args.M || args.C.logical_cols() != args.N)
+    {
+        throw std::invalid_argument("GEMM operand views do not match M/N/K");
+    }
+}
+
+float *reserve(MatrixBuffer &buf, std::size_t count)
+{
+    if (buf.size() < count)
+    {
+        buf = MatrixBuffer::allocate_uninitialized(count, 64);
+    }
+    return buf.data();
+}
+
+// Copies op(X) into a dense row-major (or column-major) buffer. Every view is
+// unit-stride along one axis, so this is either a row copy or a transpose.
+void densify(const MatrixView &v, float *dst, bool col_major)
+{
+    const int rows = v.logical_rows();
+    const int cols = v.logical_cols();
+    if (rows <= 0 || cols <= 0)
+    {
+        return;
+    }
+    const bool rows_contiguous = v.col_stride() == 1;
+    if (rows_contiguous != col_major)
+    {
+        // Source and destination share the contiguous axis.
+        const int outer = col_major ? cols : rows;
+        const int inner = col_major ? rows : cols;
+        const std::size_t ld = col_major ? v.col_stride() : v.row_stride();
+        for (int o = 0; o < outer; ++o)
+        {
+            std::copy(v.data + static_cast<std::size_t>(o) * ld, v.data + static_cast<std::size_t>(o) * ld + inner,
+                      dst + static_cast<std::size_t>(o) * inner);
+        }
+        return;
+    }
+    if (rows_contiguous)
+    {
+        // Row-major source into column-major destination.
+        transpose(v.data, v.row_stride(), dst, static_cast<std::size_t>(rows), rows, cols);
+    }
+    else
+    {
+        // Column-major source into row-major destination.
+        transpose(v.data, v.col_stride(), dst, static_cast<std::size_t>(cols), cols, rows);
+    }
+}
+} // namespace
+
+void GemmOp::run_strided(const GemmArgs &args)
+{
+    check_args(args);
+    const bool col_major = columnMajor();
+    if (args.alpha == 1.0f && args.beta == 0.0f &&
+        args.A.is_dense(col_major) && args.B.is_dense(col_major) && args.C.is_dense(col_major))
+    {
+        run(args.A.data, args.B.data, args.C.data, args.M, args.N, args.K);
+        return;
+    }
+
+    const std::size_t m = static_cast<std::size_t>(std::max(args.M, 0));
+    const std::size_t n = static_cast<std::size_t>(std::max(args.N, 0));
+    const std::size_t k = static_cast<std::size_t>(std::max(args.K, 0));
+    const float *a = args.A.data;
+    const float *b = args.B.data;
+    if (!args.A.is_dense(col_major))
+    {
+        float *dst = reserve(adapter_a_, m * k);
+        densify(args.A, dst, col_major);
+        a = dst;
+    }
+    if (!args.B.is_dense(col_major))
+    {
+        float *dst = reserve(adapter_b_, k * n);
+        densify(args.B, dst, col_major);
+        b = dst;
+    }
+    // run() overwrites C completely, so the scratch result needs no clearing.
+    float *c = reserve(adapter_c_, m * n);
+    run(a, b, c, args.M, args.N, args.K);
+
+    for (int i = 0; i < args.M; ++i)
+    {
+        for (int j = 0; j < args.N; ++j)
+        {
+            const float t = col_major ? c[static_cast<std::size_t>(j) * m + i] : c[static_cast<std::size_t>(i) * n + j];
+            float &out = args.C.at(i, j);
+            out = args.beta == 0.0f ? args.alpha * t : args.alpha * t + args.beta * out;
+        }
+    }
+}
+
+void GemmOp::run_batched(const float *const *A, const float *const *B, float *const *C,
+                         int M, int N, int K, int batch)
+{
+    GemmArgs args;
+    args.M = M;
+    args.N = N;
+    args.K = K;
+    for (int i = 0; i < batch; ++i)
+    {
+        args.A = dense_view(A[i], M, K);
+        args.B = dense_view(B[i], K, N);
+        args.C = dense_view(C[i], M, N);
+        run_strided(args);
+    }
+}
+
+void GemmOp::run_strided_batched(const float *A, std::size_t stride_a,
+                                 const float *B, std::size_t stride_b,
+                                 float *C, std::size_t stride_c,
+                                 int M, int N, int K, int batch)
+{
+    GemmArgs args;
+    args.M = M;
+    args.N = N;
+    args.K = K;
+    for (int i = 0; i < batch; ++i)
+    {
+        const std::size_t idx = static_cast<std::size_t>(i);
+        args.A = dense_view(A + idx * stride_a, M, K);
+        args.B = dense_view(B + idx * stride_b, K, N);
+        args.C = dense_view(C + idx * stride_c, M, N);
+        run_strided(args);
+    }
+}
+
+void GemmOp::run_grouped(const GemmShape *shapes, const float *const *A, const float *const *B,
+                         float *const *C, int count)
+{
+    for (int g = 0; g < count; ++g)
+    {
+        GemmArgs args;
+        args.M = shapes[g].M;
+        args.N = shapes[g].N;
+        args.K = shapes[g].K;
+        args.A = dense_view(A[g], args.M, args.K);
+        args.B = dense_view(B[g], args.K, args.N);
+        args.C = dense_view(C[g], args.M, args.N);
+        run_strided(args);
+    }
+}
+
+void GemmOp::apply_tuning(const GemmShape &shape)
+{
+    if (!use_tuning_cache_)
+    {
+        return;
+    }
+    if (!defaults_saved_)
+    {
+        for (const TunableParam &p : tunables(shape))
+        {
+            tuning_defaults_.emplace_back(p.name, p.value);
+        }
+        defaults_saved_ = true;
+    }
+    for (const auto &kv : tuning_defaults_)
+    {
+        set_tunable(kv.first, kv.second);
+    }
+    applied_tuning_.clear();
+    TuningEntry entry;
+    if (!tuning_defaults_.empty() && TuningCache::shared().find(name(), num_threads(), shape, entry))
+    {
+        for (const auto &kv : entry.values)
+        {
+            if (set_tunable(kv.first, kv.second))
+            {
+                applied_tuning_.push_back(kv);
+            }
+        }
+    }
+}
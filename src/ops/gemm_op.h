@@ -1,13 +1,106 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <string>
+#include <vector>
+#include "../common/gemm_shape.h"
 #include "../common/matrix_buffer.h"
+#include "../common/matrix_view.h"
+#include "tuning_cache.h"
+
+// C = alpha * op(A) * op(B) + beta * C with op(A) M x K, op(B) K x N and C
+// M x N. Views carry leading dimensions and transpose flags; as in BLAS, C is
+// not read when beta == 0.
+struct GemmArgs
+{
+    int M = 0;
+    int N = 0;
+    int K = 0;
+    MatrixView A;
+    MatrixView B;
+    MutableMatrixView C;
+    float alpha = 1.0f;
+    float beta = 0.0f;
+};
+
 class GemmOp
 {
 public:
     virtual std::string name() const = 0;
     virtual void run(const float *A, const float *B, float *C,
                      int M, int N, int K) = 0;
+    // Extended entry point. The default adapter calls run() directly when the
+    // operands are dense in the op's layout with alpha = 1, beta = 0, and
+    // otherwise packs them into dense scratch buffers around run(). Ops that
+    // handle strides natively override it.
+    virtual void run_strided(const GemmArgs &args);
+    // Batched entry points: batch independent GEMMs of one shape, each with
+    // dense row-major operands. The pointer-array form takes one pointer per
+    // entry; the strided form finds entry i at A + i * stride_a (likewise B
+    // and C). The defaults run the entries one by one through run_strided,
+    // so every op supports them; ops that can overlap entries override them.
+    virtual void run_batched(const float *const *A, const float *const *B, float *const *C,
+                             int M, int N, int K, int batch);
+    virtual void run_strided_batched(const float *A, std::size_t stride_a,
+                                     const float *B, std::size_t stride_b,
+                                     float *C, std::size_t stride_c,
+                                     int M, int N, int K, int batch);
+    // Grouped entry point: count independent GEMMs of different shapes, as
+    // in a mixture-of-experts layer where every expert gets its own token
+    // count. Group g multiplies the dense row-major A[g] (M x K) and B[g]
+    // (K x N) of shapes[g] into C[g]. The default runs the groups in order.
+    virtual void run_grouped(const GemmShape *shapes, const float *const *A, const float *const *B,
+                             float *const *C, int count);
+    // Planning hooks, called by the harness before the timed region (and
+    // timed separately). prepare() allocates workspaces for shape with C in
+    // the given layout so later runs do not allocate; workspace_size()
+    // reports how many bytes of scratch that is.
+    virtual void prepare(const GemmShape & /*shape*/, MatrixLayout /*layout*/) {}
+    virtual std::size_t workspace_size(const GemmShape & /*shape*/) const { return 0; }
+    // Packs B ahead of time, as libraries do for constant weights. Runs whose
+    // B is this same view then read the packed panels instead of packing B
+    // again, so B must not change afterwards. Returns false when the op has
+    // no pre-packed path.
+    virtual bool pack_b(const MatrixView & /*B*/) { return false; }
     virtual ~GemmOp() {}
     virtual bool columnMajor() const { return false; }
-};
\ No newline at end of file
+    // Multithreaded ops size their worker pool here; called outside the timed region.
+    virtual void set_num_threads(int /*num_threads*/) {}
+    virtual int num_threads() const { return 1; }
+    // OS thread ids of the pool workers run() uses besides the calling
+    // thread, so the harness can attach per-thread hardware counters.
+    virtual std::vector<int> worker_thread_ids() const { return {}; }
+    // Runs job(thread_id, num_threads) once on every thread run() uses, the
+    // caller as thread 0, e.g. to flush each core's private caches between
+    // timed runs. Single-threaded ops run it on the calling thread.
+    virtual void run_on_threads(const std::function<void(int, int)> &job) { job(0, 1); }
+    // Autotuning hooks. tunables() lists the op's knobs (blocking sizes, tile
+    // widths) with their current values and the candidates worth searching
+    // for shape; set_tunable() changes one and returns false for unknown
+    // names. Ops with knobs call apply_tuning() at the start of prepare(), so
+    // winners stored in TuningCache::shared() are picked up automatically.
+    virtual std::vector<TunableParam> tunables(const GemmShape & /*shape*/) const { return {}; }
+    virtual bool set_tunable(const std::string & /*name*/, int /*value*/) { return false; }
+    // The autotuner turns the cache lookup off while it sets knobs by hand.
+    void set_use_tuning_cache(bool use) { use_tuning_cache_ = use; }
+    // Values the last prepare() took from the tuning cache; empty when it ran
+    // with the defaults.
+    const TuningValues &applied_tuning() const { return applied_tuning_; }
+
+protected:
+    // Restores the knobs to their defaults, then applies the cached values
+    // for (name(), num_threads(), shape) if there are any.
+    void apply_tuning(const GemmShape &shape);
+
+    // Dense copies used by the run_strided adapter, grown on demand.
+    MatrixBuffer adapter_a_;
+    MatrixBuffer adapter_b_;
+    MatrixBuffer adapter_c_;
+
+private:
+    bool use_tuning_cache_ = true;
+    bool defaults_saved_ = false;
+    TuningValues tuning_defaults_;
+    TuningValues applied_tuning_;
+};
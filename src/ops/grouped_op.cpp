@@ -0,0 +1,108 @@
+#include "grouped_op.h"
+#include "gemm_kernels.h"
+#include "registry.h"
+#include "../common/trace.h"
+
+#include <algorithm>
+
+GroupedGemmOp::GroupedGemmOp()
+    : kernel_(best_gemm_kernel()), num_threads_(ThreadPool::default_threads())
+{
+    per_thread_.resize(static_cast<std::size_t>(num_threads_));
+}
+
+void GroupedGemmOp::set_num_threads(int num_threads)
+{
+    num_threads = std::max(1, num_threads);
+    if (num_threads == num_threads_)
+    {
+        return;
+    }
+    num_threads_ = num_threads;
+    pool_.reset();
+    per_thread_.resize(static_cast<std::size_t>(num_threads_));
+}
+
+ThreadPool &GroupedGemmOp::pool()
+{
+    if (!pool_)
+    {
+        pool_ = std::make_unique<ThreadPool>(num_threads_);
+    }
+    return *pool_;
+}
+
+std::vector<int> GroupedGemmOp::worker_thread_ids() const
+{
+    return pool_ ? pool_->worker_thread_ids() : std::vector<int>{};
+}
+
+void GroupedGemmOp::run_on_threads(const std::function<void(int, int)> &job)
+{
+    pool().run(job);
+}
+
+BlockingParams GroupedGemmOp::workspace_blocking(const GemmShape &shape) const
+{
+    // Pieces never exceed their group, so the largest group bounds every
+    // thread's packing buffers.
+    const int mn = std::max(shape.M, shape.N);
+    return normalize_blocking(kernel_, params_, mn, mn, shape.K);
+}
+
+void GroupedGemmOp::prepare(const GemmShape &shape, MatrixLayout /*layout*/)
+{
+    apply_tuning(shape);
+    pool();
+    const BlockingParams bp = workspace_blocking(shape);
+    for (auto &ws : per_thread_)
+    {
+        ws.reserve(kernel_, bp);
+    }
+}
+
+std::vector<TunableParam> GroupedGemmOp::tunables(const GemmShape &shape) const
+{
+    return blocking_tunables(kernel_, params_, shape);
+}
+
+bool GroupedGemmOp::set_tunable(const std::string &name, int value)
+{
+    return set_blocking_tunable(params_, name, value);
+}
+
+std::size_t GroupedGemmOp::workspace_size(const GemmShape &shape) const
+{
+    const BlockingParams bp = workspace_blocking(shape);
+    return (packed_a_size(kernel_, bp.mc, bp.kc) + packed_b_size(kernel_, bp.kc, bp.nc)) *
+           per_thread_.size() * sizeof(float);
+}
+
+void GroupedGemmOp::run(const float *A, const float *B, float *C,
+                        int M, int N, int K)
+{
+    const GemmShape shape{M, N, K};
+    run_grouped(&shape, &A, &B, &C, 1);
+}
+
+void GroupedGemmOp::run_grouped(const GemmShape *shapes, const float *const *A, const float *const *B,
+                                float *const *C, int count)
+{
+    plan_grouped_gemm(shapes, count, num_threads_, kernel_.mr, kernel_.nr, plan_);
+    pool().run([&](int tid, int /*nt*/) {
+        GemmWorkspace &ws = per_thread_[static_cast<std::size_t>(tid)];
+        for (const GroupedTask &t : plan_.tasks[static_cast<std::size_t>(tid)])
+        {
+            GEMMBENCH_TRACE_SCOPE("task");
+            const int N = shapes[t.group].N;
+            const int K = shapes[t.group].K;
+            blocked_gemm(kernel_, params_, ws,
+                         A[t.group] + static_cast<std::size_t>(t.m0) * K, K,
+                         B[t.group] + t.n0, N,
+                         C[t.group] + static_cast<std::size_t>(t.m0) * N + t.n0, N,
+                         t.m1 - t.m0, t.n1 - t.n0, K);
+        }
+    });
+}
+
+REGISTER_GEMM_OP(GroupedGemmOp)
@@ -0,0 +1,44 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "gemm_op.h"
+#include "blocked_gemm.h"
+#include "grouped_schedule.h"
+#include "../common/thread_pool.h"
+
+// Grouped GEMM for problems of uneven size, such as the per-expert GEMMs of
+// a mixture-of-experts layer. Every call is planned with plan_grouped_gemm:
+// large groups are cut into pieces and all pieces are spread over the pool by
+// estimated FLOPs, then each thread runs the serial blocked driver on its
+// list without further synchronization. run() is planned as a single group.
+class GroupedGemmOp : public GemmOp
+{
+public:
+    GroupedGemmOp();
+    std::string name() const override { return "grouped"; }
+    void run(const float *A, const float *B, float *C,
+             int M, int N, int K) override;
+    void run_grouped(const GemmShape *shapes, const float *const *A, const float *const *B,
+                     float *const *C, int count) override;
+    void set_num_threads(int num_threads) override;
+    int num_threads() const override { return num_threads_; }
+    std::vector<int> worker_thread_ids() const override;
+    void run_on_threads(const std::function<void(int, int)> &job) override;
+    void prepare(const GemmShape &shape, MatrixLayout layout) override;
+    std::size_t workspace_size(const GemmShape &shape) const override;
+    std::vector<TunableParam> tunables(const GemmShape &shape) const override;
+    bool set_tunable(const std::string &name, int value) override;
+
+private:
+    BlockingParams workspace_blocking(const GemmShape &shape) const;
+    // Starts the pool on first use (prepare or run).
+    ThreadPool &pool();
+
+    const GemmKernel &kernel_;
+    BlockingParams params_;
+    int num_threads_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::vector<GemmWorkspace> per_thread_;
+    GroupedPlan plan_; // reused between calls to avoid reallocating the task lists
+};
@@ -0,0 +1,125 @@
+#include "grouped_schedule.h"
+
+#include <algorithm>
+
+namespace
+{
+// No piece may exceed this fraction of a thread's fair share, which leaves
+// LPT enough small pieces to even out the tail.
+constexpr double kMaxShare = 0.25;
+
+// 2mnK FLOPs plus one unit per packed element of A and B.
+double piece_cost(int m, int n, int K)
+{
+    return 2.0 * m * n * static_cast<double>(K) + static_cast<double>(K) * (m + n);
+}
+
+int split_count(int extent, int align, int wanted)
+{
+    return std::max(1, std::min(wanted, (extent + align - 1) / align));
+}
+
+// Start of part p when extent is cut into parts pieces on align multiples.
+int boundary(int extent, int align, int parts, int p)
+{
+    const int units = (extent + align - 1) / align;
+    return std::min(extent, units * p / parts * align);
+}
+} // namespace
+
+double GroupedPlan::imbalance() const
+{
+    double total = 0.0;
+    double busiest = 0.0;
+    for (double l : load)
+    {
+        total += l;
+        busiest = std::max(busiest, l);
+    }
+    return total > 0.0 ? busiest * static_cast<double>(load.size()) / total : 1.0;
+}
+
+void plan_grouped_gemm(const GemmShape *shapes, int count, int num_threads,
+                       int row_align, int col_align, GroupedPlan &plan)
+{
+    num_threads = std::max(num_threads, 1);
+    row_align = std::max(row_align, 1);
+    col_align = std::max(col_align, 1);
+    plan.tasks.resize(static_cast<std::size_t>(num_threads));
+    for (auto &list : plan.tasks)
+    {
+        list.clear();
+    }
+    plan.load.assign(static_cast<std::size_t>(num_threads), 0.0);
+
+    double total = 0.0;
+    for (int g = 0; g < count; ++g)
+    {
+        if (shapes[g].M > 0 && shapes[g].N > 0)
+        {
+            total += piece_cost(shapes[g].M, shapes[g].N, shapes[g].K);
+        }
+    }
+    // A single thread runs everything anyway, so nothing is split.
+    const double limit = num_threads > 1 ? total / num_threads * kMaxShare : 0.0;
+
+    std::vector<GroupedTask> pieces;
+    for (int g = 0; g < count; ++g)
+    {
+        const int M = shapes[g].M;
+        const int N = shapes[g].N;
+        const int K = shapes[g].K;
+        if (M <= 0 || N <= 0)
+        {
+            continue;
+        }
+        const double cost = piece_cost(M, N, K);
+        const int parts = limit > 0.0 ? static_cast<int>(std::min(cost / limit + 0.999, 1e6)) : 1;
+        // Cutting N repacks A in every piece and cutting M repacks B, so cut
+        // the dimension that belongs to the smaller operand first.
+        int pm;
+        int pn;
+        if (M < N)
+        {
+            pn = split_count(N, col_align, parts);
+            pm = split_count(M, row_align, (parts + pn - 1) / pn);
+        }
+        else
+        {
+            pm = split_count(M, row_align, parts);
+            pn = split_count(N, col_align, (parts + pm - 1) / pm);
+        }
+        for (int i = 0; i < pm; ++i)
+        {
+            const int m0 = boundary(M, row_align, pm, i);
+            const int m1 = boundary(M, row_align, pm, i + 1);
+            for (int j = 0; j < pn; ++j)
+            {
+                const int n0 = boundary(N, col_align, pn, j);
+                const int n1 = boundary(N, col_align, pn, j + 1);
+                if (m0 < m1 && n0 < n1)
+                {
+                    pieces.push_back(GroupedTask{g, m0, m1, n0, n1, piece_cost(m1 - m0, n1 - n0, K)});
+                }
+            }
+        }
+    }
+
+    // Longest processing time first: the biggest remaining piece goes to the
+    // least loaded thread.
+    std::stable_sort(pieces.begin(), pieces.end(),
+                     [](const GroupedTask &a, const GroupedTask &b) { return a.cost > b.cost; });
+    for (const GroupedTask &piece : pieces)
+    {
+        const auto idle = static_cast<std::size_t>(
+            std::min_element(plan.load.begin(), plan.load.end()) - plan.load.begin());
+        plan.tasks[idle].push_back(piece);
+        plan.load[idle] += piece.cost;
+    }
+    for (auto &list : plan.tasks)
+    {
+        std::sort(list.begin(), list.end(), [](const GroupedTask &a, const GroupedTask &b) {
+            return a.group != b.group ? a.group < b.group : (a.m0 != b.m0 ? a.m0 < b.m0 : a.n0 < b.n0);
+        });
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "../common/gemm_shape.h"
+
+// One piece of a grouped GEMM: rows [m0, m1) x columns [n0, n1) of C for
+// group `group`, over the group's full K.
+struct GroupedTask
+{
+    int group;
+    int m0, m1;
+    int n0, n1;
+    double cost; // estimated FLOPs, including the cost of packing the piece's operands
+};
+
+// Static assignment of grouped-GEMM pieces to threads. tasks[t] is the work
+// list of thread t; load[t] its summed estimated cost.
+struct GroupedPlan
+{
+    std::vector<std::vector<GroupedTask>> tasks;
+    std::vector<double> load;
+
+    // Busiest thread's load over the mean (1.0 is a perfect split).
+    double imbalance() const;
+};
+
+// Balances problems of very different sizes (e.g. experts with skewed token
+// counts) across num_threads by estimated FLOPs. Groups larger than a
+// fraction of one thread's fair share are first cut into pieces along N or
+// M (whichever duplicates the smaller operand's packing), with boundaries on
+// col_align / row_align multiples so micro-tiles stay whole. The pieces are
+// then placed largest first on the least loaded thread (LPT), and each
+// thread's list is ordered by group so consecutive pieces share operands.
+void plan_grouped_gemm(const GemmShape *shapes, int count, int num_threads,
+                       int row_align, int col_align, GroupedPlan &plan);
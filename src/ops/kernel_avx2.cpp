@@ -0,0 +1,74 @@
+#include "gemm_kernels.h"
+#include "cpu_features.h"
+
+#if defined(GEMMBENCH_X86_KERNELS)
+#include <immintrin.h>
+
+namespace
+{
+constexpr int kMR = 6;
+constexpr int kNR = 16;
+
+GEMMBENCH_TARGET("avx2,fma")
+void avx2_micro_kernel(int kc, const float *a, const float *b,
+                       float *C, int ldc, int m, int n, bool accumulate)
+{
+    __m256 c[kMR][2];
+    for (int i = 0; i < kMR; ++i)
+    {
+        c[i][0] = _mm256_setzero_ps();
+        c[i][1] = _mm256_setzero_ps();
+    }
+
+    for (int p = 0; p < kc; ++p)
+    {
+        const __m256 b0 = _mm256_loadu_ps(b);
+        const __m256 b1 = _mm256_loadu_ps(b + 8);
+        for (int i = 0; i < kMR; ++i)
+        {
+            const __m256 ai = _mm256_broadcast_ss(a + i);
+            c[i][0] = _mm256_fmadd_ps(ai, b0, c[i][0]);
+            c[i][1] = _mm256_fmadd_ps(ai, b1, c[i][1]);
+        }
+        a += kMR;
+        b += kNR;
+    }
+
+    if (m == kMR && n == kNR)
+    {
+        for (int i = 0; i < kMR; ++i)
+        {
+            float *c_row = C + static_cast<std::size_t>(i) * ldc;
+            if (accumulate)
+            {
+                c[i][0] = _mm256_add_ps(c[i][0], _mm256_loadu_ps(c_row));
+                c[i][1] = _mm256_add_ps(c[i][1], _mm256_loadu_ps(c_row + 8));
+            }
+            _mm256_storeu_ps(c_row, c[i][0]);
+            _mm256_storeu_ps(c_row + 8, c[i][1]);
+        }
+        return;
+    }
+
+    alignas(32) float tile[kMR * kNR];
+    for (int i = 0; i < kMR; ++i)
+    {
+        _mm256_store_ps(tile + i * kNR, c[i][0]);
+        _mm256_store_ps(tile + i * kNR + 8, c[i][1]);
+    }
+    store_partial_tile(tile, kNR, C, ldc, m, n, accumulate);
+}
+} // namespace
+
+const GemmKernel *avx2_gemm_kernel()
+{
+    static const GemmKernel kernel{"avx2", kMR, kNR, avx2_micro_kernel};
+    const CpuFeatures &cpu = cpu_features();
+    return (cpu.avx2 && cpu.fma) ? &kernel : nullptr;
+}
+#else
+const GemmKernel *avx2_gemm_kernel()
+{
+    return nullptr;
+}
+#endif
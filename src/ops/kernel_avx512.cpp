@@ -0,0 +1,74 @@
+#include "gemm_kernels.h"
+#include "cpu_features.h"
+
+#if defined(GEMMBENCH_X86_KERNELS)
+#include <immintrin.h>
+
+namespace
+{
+constexpr int kMR = 14;
+constexpr int kNR = 32;
+
+GEMMBENCH_TARGET("avx512f")
+void avx512_micro_kernel(int kc, const float *a, const float *b,
+                         float *C, int ldc, int m, int n, bool accumulate)
+{
+    __m512 c[kMR][2];
+    for (int i = 0; i < kMR; ++i)
+    {
+        c[i][0] = _mm512_setzero_ps();
+        c[i][1] = _mm512_setzero_ps();
+    }
+
+    for (int p = 0; p < kc; ++p)
+    {
+        const __m512 b0 = _mm512_loadu_ps(b);
+        const __m512 b1 = _mm512_loadu_ps(b + 16);
+        for (int i = 0; i < kMR; ++i)
+        {
+            const __m512 ai = _mm512_set1_ps(a[i]);
+            c[i][0] = _mm512_fmadd_ps(ai, b0, c[i][0]);
+            c[i][1] = _mm512_fmadd_ps(ai, b1, c[i][1]);
+        }
+        a += kMR;
+        b += kNR;
+    }
+
+    if (m == kMR && n == kNR)
+    {
+        for (int i = 0; i < kMR; ++i)
+        {
+            float *c_row = C + static_cast<std::size_t>(i) * ldc;
+            if (accumulate)
+            {
+                c[i][0] = _mm512_add_ps(c[i][0], _mm512_loadu_ps(c_row));
+                c[i][1] = _mm512_add_ps(c[i][1], _mm512_loadu_ps(c_row + 16));
+            }
+            _mm512_storeu_ps(c_row, c[i][0]);
+            _mm512_storeu_ps(c_row + 16, c[i][1]);
+        }
+        return;
+    }
+
+    alignas(64) float tile[kMR * kNR];
+    for (int i = 0; i < kMR; ++i)
+    {
+        _mm512_store_ps(tile + i * kNR, c[i][0]);
+        _mm512_store_ps(tile + i * kNR + 16, c[i][1]);
+    }
+    store_partial_tile(tile, kNR, C, ldc, m, n, accumulate);
+}
+} // namespace
+
+const GemmKernel *avx512_gemm_kernel()
+{
+    static const GemmKernel kernel{"avx512f", kMR, kNR, avx512_micro_kernel};
+    const CpuFeatures &cpu = cpu_features();
+    return cpu.avx512f ? &kernel : nullptr;
+}
+#else
+const GemmKernel *avx512_gemm_kernel()
+{
+    return nullptr;
+}
+#endif
@@ -0,0 +1,74 @@
+#include "gemm_kernels.h"
+#include "cpu_features.h"
+
+#if defined(GEMMBENCH_X86_KERNELS)
+#include <immintrin.h>
+
+namespace
+{
+constexpr int kMR = 6;
+constexpr int kNR = 8;
+
+GEMMBENCH_TARGET("sse4.2")
+void sse42_micro_kernel(int kc, const float *a, const float *b,
+                        float *C, int ldc, int m, int n, bool accumulate)
+{
+    __m128 c[kMR][2];
+    for (int i = 0; i < kMR; ++i)
+    {
+        c[i][0] = _mm_setzero_ps();
+        c[i][1] = _mm_setzero_ps();
+    }
+
+    for (int p = 0; p < kc; ++p)
+    {
+        const __m128 b0 = _mm_loadu_ps(b);
+        const __m128 b1 = _mm_loadu_ps(b + 4);
+        for (int i = 0; i < kMR; ++i)
+        {
+            const __m128 ai = _mm_set1_ps(a[i]);
+            c[i][0] = _mm_add_ps(c[i][0], _mm_mul_ps(ai, b0));
+            c[i][1] = _mm_add_ps(c[i][1], _mm_mul_ps(ai, b1));
+        }
+        a += kMR;
+        b += kNR;
+    }
+
+    if (m == kMR && n == kNR)
+    {
+        for (int i = 0; i < kMR; ++i)
+        {
+            float *c_row = C + static_cast<std::size_t>(i) * ldc;
+            if (accumulate)
+            {
+                c[i][0] = _mm_add_ps(c[i][0], _mm_loadu_ps(c_row));
+                c[i][1] = _mm_add_ps(c[i][1], _mm_loadu_ps(c_row + 4));
+            }
+            _mm_storeu_ps(c_row, c[i][0]);
+            _mm_storeu_ps(c_row + 4, c[i][1]);
+        }
+        return;
+    }
+
+    alignas(16) float tile[kMR * kNR];
+    for (int i = 0; i < kMR; ++i)
+    {
+        _mm_store_ps(tile + i * kNR, c[i][0]);
+        _mm_store_ps(tile + i * kNR + 4, c[i][1]);
+    }
+    store_partial_tile(tile, kNR, C, ldc, m, n, accumulate);
+}
+} // namespace
+
+const GemmKernel *sse42_gemm_kernel()
+{
+    static const GemmKernel kernel{"sse4.2", kMR, kNR, sse42_micro_kernel};
+    const CpuFeatures &cpu = cpu_features();
+    return cpu.sse42 ? &kernel : nullptr;
+}
+#else
+const GemmKernel *sse42_gemm_kernel()
+{
+    return nullptr;
+}
+#endif
@@ -0,0 +1,292 @@
+#include "parallel_op.h"
+#include "gemm_kernels.h"
+#include "registry.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+// C = beta * C on an m x n row-major block; beta == 0 overwrites C without
+// reading it, as BLAS does.
+void scale_block(float *C, std::size_t ldc, int m, int n, float beta)
+{
+    for (int i = 0; i < m; ++i)
+    {
+        float *row = C + static_cast<std::size_t>(i) * ldc;
+        for (int j = 0; j < n; ++j)
+        {
+            row[j] = beta == 0.0f ? 0.0f : beta * row[j];
+        }
+    }
+}
+} // namespace
+
+ParallelGemmOp::ParallelGemmOp()
+    : kernel_(best_gemm_kernel()), num_threads_(ThreadPool::default_threads())
+{
+    per_thread_.resize(static_cast<std::size_t>(num_threads_));
+}
+
+void ParallelGemmOp::set_num_threads(int num_threads)
+{
+    num_threads = std::max(1, num_threads);
+    if (num_threads == num_threads_)
+    {
+        return;
+    }
+    num_threads_ = num_threads;
+    pool_.reset();
+    per_thread_.resize(static_cast<std::size_t>(num_threads_));
+}
+
+ThreadPool &ParallelGemmOp::pool()
+{
+    if (!pool_)
+    {
+        pool_ = std::make_unique<ThreadPool>(num_threads_);
+    }
+    return *pool_;
+}
+
+std::vector<int> ParallelGemmOp::worker_thread_ids() const
+{
+    return pool_ ? pool_->worker_thread_ids() : std::vector<int>{};
+}
+
+void ParallelGemmOp::run_on_threads(const std::function<void(int, int)> &job)
+{
+    pool().run(job);
+}
+
+void ParallelGemmOp::reserve_workspaces(const BlockingParams &bp)
+{
+    // Packed B holds one (kc x nc) block; packed A one (mc x kc) block per thread.
+    BlockingParams a_only = bp;
+    a_only.nc = kernel_.nr;
+    BlockingParams b_only = bp;
+    b_only.mc = kernel_.mr;
+    shared_.reserve(kernel_, b_only);
+    for (auto &ws : per_thread_)
+    {
+        ws.reserve(kernel_, a_only);
+    }
+}
+
+void ParallelGemmOp::prepare(const GemmShape &shape, MatrixLayout /*layout*/)
+{
+    apply_tuning(shape);
+    pool();
+    reserve_workspaces(normalize_blocking(kernel_, params_, shape.M, shape.N, shape.K));
+    if (packed_b_.K != shape.K || packed_b_.N != shape.N)
+    {
+        packed_b_.clear();
+    }
+}
+
+std::size_t ParallelGemmOp::workspace_size(const GemmShape &shape) const
+{
+    const BlockingParams bp = normalize_blocking(kernel_, params_, shape.M, shape.N, shape.K);
+    const std::size_t per_thread = packed_a_size(kernel_, bp.mc, bp.kc);
+    return (packed_b_size(kernel_, bp.kc, bp.nc) + per_thread * per_thread_.size() + packed_b_.panels.size()) *
+           sizeof(float);
+}
+
+std::vector<TunableParam> ParallelGemmOp::tunables(const GemmShape &shape) const
+{
+    std::vector<TunableParam> out = blocking_tunables(kernel_, params_, shape);
+    // How the threads share the M x N tiles: 1 splits only along M (ic
+    // blocks), larger values also split each nc block along N.
+    std::vector<int> groups{0};
+    for (int g = 1; g <= num_threads_; g *= 2)
+    {
+        groups.push_back(g);
+    }
+    if (groups.back() != num_threads_)
+    {
+        groups.push_back(num_threads_);
+    }
+    out.push_back(TunableParam{"n_groups", n_groups_, groups});
+    return out;
+}
+
+bool ParallelGemmOp::set_tunable(const std::string &name, int value)
+{
+    if (name == "n_groups")
+    {
+        if (value < 0)
+        {
+            return false;
+        }
+        n_groups_ = value;
+        return true;
+    }
+    return set_blocking_tunable(params_, name, value);
+}
+
+bool ParallelGemmOp::pack_b(const MatrixView &B)
+{
+    prepack_b(kernel_, params_, B, packed_b_);
+    return !packed_b_.empty();
+}
+
+void ParallelGemmOp::run(const float *A, const float *B, float *C,
+                         int M, int N, int K)
+{
+    GemmArgs args;
+    args.M = M;
+    args.N = N;
+    args.K = K;
+    args.A = dense_view(A, M, K);
+    args.B = dense_view(B, K, N);
+    args.C = dense_view(C, M, N);
+    run_strided(args);
+}
+
+void ParallelGemmOp::run_strided(const GemmArgs &args)
+{
+    int M = args.M;
+    int N = args.N;
+    const int K = args.K;
+    if (M <= 0 || N <= 0)
+    {
+        return;
+    }
+
+    // Element (i, j) of each operand is at ptr[i * rs + j * cs].
+    const float *A = args.A.data;
+    std::size_t a_rs = args.A.row_stride();
+    std::size_t a_cs = args.A.col_stride();
+    const float *B = args.B.data;
+    std::size_t b_rs = args.B.row_stride();
+    std::size_t b_cs = args.B.col_stride();
+    std::size_t c_rs = args.C.row_stride();
+    bool use_prepacked = true;
+    if (args.C.col_stride() != 1)
+    {
+        // The kernels store rows of C; for column-major C compute
+        // C^T = op(B)^T * op(A)^T instead.
+        std::swap(M, N);
+        std::swap(A, B);
+        a_rs = args.B.col_stride();
+        a_cs = args.B.row_stride();
+        b_rs = args.A.col_stride();
+        b_cs = args.A.row_stride();
+        c_rs = args.C.col_stride();
+        use_prepacked = false;
+    }
+    float *C = args.C.data;
+    const float alpha = args.alpha;
+    const float beta = args.beta;
+    const int ldc = static_cast<int>(c_rs);
+    if (K <= 0 || alpha == 0.0f)
+    {
+        scale_block(C, c_rs, M, N, beta);
+        return;
+    }
+
+    const GemmKernel &kernel = kernel_;
+    const BlockingParams bp = normalize_blocking(kernel, params_, M, N, K);
+    ThreadPool &threads = pool();
+    const int nthreads = threads.size();
+
+    reserve_workspaces(bp);
+    const PackedB *prepacked =
+        use_prepacked && packed_b_.matches(B, b_rs, b_cs, K, N, bp) ? &packed_b_ : nullptr;
+
+    SpinBarrier barrier(nthreads, &threads);
+    float *b_shared = shared_.b_packed.data();
+
+    threads.run([&](int tid, int nt) {
+        float *a_buf = per_thread_[static_cast<std::size_t>(tid)].a_packed.data();
+        for (int jc = 0; jc < N; jc += bp.nc)
+        {
+            const int nc = std::min(bp.nc, N - jc);
+            const int n_panels = (nc + kernel.nr - 1) / kernel.nr;
+            const int m_blocks = (M + bp.mc - 1) / bp.mc;
+            // Split N into enough panel groups that every thread gets a tile,
+            // which keeps skinny-M shapes from serializing on one ic block.
+            const int auto_groups = std::max(1, (nt + m_blocks - 1) / m_blocks);
+            const int n_groups = std::min(n_panels, n_groups_ > 0 ? n_groups_ : auto_groups);
+            const int tiles = m_blocks * n_groups;
+
+            for (int pc = 0; pc < K; pc += bp.kc)
+            {
+                const int kc = std::min(bp.kc, K - pc);
+                const float *b_buf = prepacked ? prepacked->block(jc, pc) : b_shared;
+
+                if (!prepacked)
+                {
+                    // Cooperative packing of B, one contiguous range of NR panels per thread.
+                    const int p_begin = n_panels * tid / nt;
+                    const int p_end = n_panels * (tid + 1) / nt;
+                    if (p_begin < p_end)
+                    {
+                        const int col = p_begin * kernel.nr;
+                        const int cols = std::min(nc, p_end * kernel.nr) - col;
+                        const float *src = B + static_cast<std::size_t>(pc) * b_rs +
+                                           static_cast<std::size_t>(jc + col) * b_cs;
+                        float *dst = b_shared + static_cast<std::size_t>(p_begin) * kernel.nr * kc;
+                        if (b_cs == 1)
+                        {
+                            ::pack_b(src, static_cast<int>(b_rs), kc, cols, kernel.nr, dst);
+                        }
+                        else
+                        {
+                            pack_b_strided(src, b_rs, b_cs, kc, cols, kernel.nr, dst);
+                        }
+                    }
+                    barrier.wait();
+                }
+
+                // Tiles are numbered ic-major, so a thread's contiguous range
+                // mostly reuses the same packed A block.
+                int packed_ic = -1;
+                const int t_begin = tiles * tid / nt;
+                const int t_end = tiles * (tid + 1) / nt;
+                for (int t = t_begin; t < t_end; ++t)
+                {
+                    const int ic = (t / n_groups) * bp.mc;
+                    const int group = t % n_groups;
+                    const int mc = std::min(bp.mc, M - ic);
+                    if (ic != packed_ic)
+                    {
+                        const float *src = A + static_cast<std::size_t>(ic) * a_rs +
+                                           static_cast<std::size_t>(pc) * a_cs;
+                        if (a_cs == 1 && alpha == 1.0f)
+                        {
+                            pack_a(src, static_cast<int>(a_rs), mc, kc, kernel.mr, a_buf);
+                        }
+                        else
+                        {
+                            pack_a_strided(src, a_rs, a_cs, mc, kc, kernel.mr, alpha, a_buf);
+                        }
+                        packed_ic = ic;
+                    }
+                    const int g_begin = n_panels * group / n_groups;
+                    const int g_end = n_panels * (group + 1) / n_groups;
+                    const int col = g_begin * kernel.nr;
+                    const int cols = std::min(nc, g_end * kernel.nr) - col;
+                    float *c_tile = C + static_cast<std::size_t>(ic) * c_rs + jc + col;
+                    // Every thread owns the same tiles in each K step, so the
+                    // tile is scaled by its owner before the first update.
+                    const bool scale_c = pc == 0 && beta != 0.0f && beta != 1.0f;
+                    if (scale_c)
+                    {
+                        scale_block(c_tile, c_rs, mc, cols, beta);
+                    }
+                    macro_kernel(kernel, mc, cols, kc, a_buf,
+                                 b_buf + static_cast<std::size_t>(g_begin) * kernel.nr * kc,
+                                 c_tile, ldc, pc != 0 || beta != 0.0f);
+                }
+                // B is repacked in the next step; wait until everyone is done with it.
+                if (!prepacked)
+                {
+                    barrier.wait();
+                }
+            }
+        }
+    });
+}
+
+REGISTER_GEMM_OP(ParallelGemmOp)
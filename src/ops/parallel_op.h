@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "gemm_op.h"
+#include "blocked_gemm.h"
+#include "../common/thread_pool.h"
+
+// Multithreaded blocked GEMM. Each (jc, pc) step packs B cooperatively, then
+// the M/N macro-tiles of that block are split statically across a persistent
+// thread pool owned by the op instance and started on first use.
+class ParallelGemmOp : public GemmOp
+{
+public:
+    ParallelGemmOp();
+    std::string name() const override { return "parallel"; }
+    void run(const float *A, const float *B, float *C,
+             int M, int N, int K) override;
+    // Same driver on strided views: strided operands are read while packing,
+    // alpha is folded into packed A and beta applied to each tile at pc = 0.
+    void run_strided(const GemmArgs &args) override;
+    void set_num_threads(int num_threads) override;
+    int num_threads() const override { return num_threads_; }
+    std::vector<int> worker_thread_ids() const override;
+    void run_on_threads(const std::function<void(int, int)> &job) override;
+    void prepare(const GemmShape &shape, MatrixLayout layout) override;
+    std::size_t workspace_size(const GemmShape &shape) const override;
+    // With B pre-packed no cooperative packing is needed, and since every
+    // thread owns the same C tiles in each K step the barriers go away too.
+    bool pack_b(const MatrixView &B) override;
+    std::vector<TunableParam> tunables(const GemmShape &shape) const override;
+    bool set_tunable(const std::string &name, int value) override;
+
+private:
+    void reserve_workspaces(const BlockingParams &bp);
+    // The pool is started on first use (prepare or run), so ops that are
+    // only constructed, e.g. by list-ops, spawn no threads.
+    ThreadPool &pool();
+
+    const GemmKernel &kernel_;
+    BlockingParams params_;
+    // Panel groups each nc block of N is split into; 0 picks just enough
+    // for every thread to get a tile.
+    int n_groups_ = 0;
+    int num_threads_;
+    std::unique_ptr<ThreadPool> pool_;
+    GemmWorkspace shared_;                 // packed B, shared by all threads
+    std::vector<GemmWorkspace> per_thread_; // packed A, one per thread
+    PackedB packed_b_;
+};
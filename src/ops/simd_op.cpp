@@ -0,0 +1,7 @@
+#include "simd_op.h"
+#include "registry.h"
+
+REGISTER_GEMM_OP(Sse42GemmOp)
+REGISTER_GEMM_OP(Avx2GemmOp)
+REGISTER_GEMM_OP(Avx512GemmOp)
+REGISTER_GEMM_OP(SimdGemmOp)
@@ -0,0 +1,33 @@
+#pragma once
+#include "blocked_op.h"
+#include "gemm_kernels.h"
+
+// Blocked GEMM pinned to one hand-vectorized micro-kernel.
+class Sse42GemmOp : public BlockedGemmOp
+{
+public:
+    Sse42GemmOp() : BlockedGemmOp("sse42", sse42_gemm_kernel(), "SSE4.2") {}
+};
+
+class Avx2GemmOp : public BlockedGemmOp
+{
+public:
+    Avx2GemmOp() : BlockedGemmOp("avx2", avx2_gemm_kernel(), "AVX2+FMA") {}
+};
+
+class Avx512GemmOp : public BlockedGemmOp
+{
+public:
+    Avx512GemmOp() : BlockedGemmOp("avx512", avx512_gemm_kernel(), "AVX-512F") {}
+};
+
+// Blocked GEMM using the widest micro-kernel the running CPU supports, so one
+// portable binary runs at full speed across hosts.
+class SimdGemmOp : public BlockedGemmOp
+{
+public:
+    SimdGemmOp()
+        : BlockedGemmOp(std::string("simd_") + best_gemm_kernel().isa, &best_gemm_kernel(), "")
+    {
+    }
+};
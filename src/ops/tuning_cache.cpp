@@ -0,0 +1,281 @@
+#include "tuning_cache.h"
+#include "gemm_kernels.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+std::string strip_whitespace(const std::string &text)
+{
+    std::string out;
+    bool pending_gap = false;
+    for (char c : text)
+    {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        {
+            pending_gap = !out.empty();
+            continue;
+        }
+        if (pending_gap)
+        {
+            out += '_';
+            pending_gap = false;
+        }
+        out += c;
+    }
+    return out;
+}
+
+std::string cpu_model_name()
+{
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, 10, "model name") == 0)
+        {
+            const auto colon = line.find(':');
+            if (colon != std::string::npos)
+            {
+                return strip_whitespace(line.substr(colon + 1));
+            }
+        }
+    }
+    return "unknown-cpu";
+}
+
+// Rounds in the log domain, so 3 -> 4 and 5 -> 4; done in 64 bits because
+// values above 2^30.5 round to 2^31, which does not fit an int.
+std::uint64_t nearest_power_of_two(int x)
+{
+    if (x <= 0)
+    {
+        return 0;
+    }
+    return std::uint64_t{1} << std::lround(std::log2(static_cast<double>(x)));
+}
+
+std::vector<std::string> split(const std::string &text, char sep)
+{
+    std::vector<std::string> out;
+    std::string item;
+    std::istringstream in(text);
+    while (std::getline(in, item, sep))
+    {
+        out.push_back(item);
+    }
+    return out;
+}
+} // namespace
+
+std::string format_tuning_values(const TuningValues &values)
+{
+    std::string out;
+    for (const auto &kv : values)
+    {
+        if (!out.empty())
+        {
+            out += ',';
+        }
+        out += kv.first + "=" + std::to_string(kv.second);
+    }
+    return out;
+}
+
+TuningValues parse_tuning_values(const std::string &text)
+{
+    TuningValues out;
+    for (const std::string &item : split(text, ','))
+    {
+        const auto eq = item.find('=');
+        if (eq == std::string::npos || eq == 0)
+        {
+            throw std::invalid_argument("Malformed tuning value '" + item + "'");
+        }
+        std::size_t used = 0;
+        int value = 0;
+        try
+        {
+            value = std::stoi(item.substr(eq + 1), &used);
+        }
+        catch (const std::exception &)
+        {
+            used = 0;
+        }
+        if (used == 0 || eq + 1 + used != item.size())
+        {
+            throw std::invalid_argument("Malformed tuning value '" + item + "'");
+        }
+        out.emplace_back(item.substr(0, eq), value);
+    }
+    return out;
+}
+
+std::string user_cache_path(const std::string &file_name)
+{
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && *xdg != '\0')
+    {
+        return std::string(xdg) + "/gemmbench/" + file_name;
+    }
+    if (const char *home = std::getenv("HOME"); home != nullptr && *home != '\0')
+    {
+        return std::string(home) + "/.cache/gemmbench/" + file_name;
+    }
+    return "gemmbench_" + file_name;
+}
+
+const std::string &host_signature()
+{
+    static const std::string signature = cpu_model_name() + "/" + best_gemm_kernel().isa;
+    return signature;
+}
+
+std::string shape_bucket(const GemmShape &shape)
+{
+    return std::to_string(nearest_power_of_two(shape.M)) + "x" + std::to_string(nearest_power_of_two(shape.N)) +
+           "x" + std::to_string(nearest_power_of_two(shape.K));
+}
+
+TuningCache &TuningCache::shared()
+{
+    static TuningCache *cache = []() {
+        auto *c = new TuningCache();
+        const char *env = std::getenv("GEMMBENCH_TUNING_CACHE");
+        c->load_lenient(env != nullptr && *env != '\0' ? std::string(env) : default_path());
+        return c;
+    }();
+    return *cache;
+}
+
+std::string TuningCache::default_path()
+{
+    return user_cache_path("tuning.tsv");
+}
+
+std::string TuningCache::make_key(const std::string &host, const std::string &op, int threads,
+                                  const std::string &bucket)
+{
+    return host + "\t" + op + "\t" + std::to_string(threads) + "\t" + bucket;
+}
+
+void TuningCache::load(const std::string &path)
+{
+    std::map<std::string, TuningEntry> entries;
+    std::ifstream in(path);
+    std::string line;
+    int line_no = 0;
+    while (in && std::getline(in, line))
+    {
+        ++line_no;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        const std::vector<std::string> fields = split(line, '\t');
+        TuningEntry entry;
+        try
+        {
+            if (fields.size() != 6)
+            {
+                throw std::invalid_argument("expected 6 tab-separated fields");
+            }
+            std::stoi(fields[2]);
+            entry.values = parse_tuning_values(fields[4]);
+            entry.gflops = std::stod(fields[5]);
+        }
+        catch (const std::exception &e)
+        {
+            throw std::runtime_error("Malformed tuning cache " + path + " line " + std::to_string(line_no) +
+                                     ": " + e.what());
+        }
+        entries[make_key(fields[0], fields[1], std::stoi(fields[2]), fields[3])] = std::move(entry);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    load_error_.clear();
+    entries_ = std::move(entries);
+}
+
+void TuningCache::load_lenient(const std::string &path)
+{
+    try
+    {
+        load(path);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "Ignoring tuning cache: %s\n", e.what());
+        std::lock_guard<std::mutex> lock(mutex_);
+        path_ = path;
+        load_error_ = e.what();
+        entries_.clear();
+    }
+}
+
+std::string TuningCache::load_error() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return load_error_;
+}
+
+void TuningCache::save() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto parent = std::filesystem::path(path_).parent_path();
+    if (!parent.empty())
+    {
+        std::filesystem::create_directories(parent);
+    }
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out)
+        {
+            throw std::runtime_error("Cannot write tuning cache " + tmp);
+        }
+        out << "# gemmbench tuning cache: host\top\tthreads\tbucket\tvalues\tgflops\n";
+        for (const auto &kv : entries_)
+        {
+            char gflops[32];
+            std::snprintf(gflops, sizeof(gflops), "%.2f", kv.second.gflops);
+            out << kv.first << '\t' << format_tuning_values(kv.second.values) << '\t' << gflops << '\n';
+        }
+        if (!out)
+        {
+            throw std::runtime_error("Cannot write tuning cache " + tmp);
+        }
+    }
+    std::filesystem::rename(tmp, path_);
+}
+
+bool TuningCache::find(const std::string &op, int threads, const GemmShape &shape, TuningEntry &out) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = entries_.find(make_key(host_signature(), op, threads, shape_bucket(shape)));
+    if (it == entries_.end())
+    {
+        return false;
+    }
+    out = it->second;
+    return true;
+}
+
+void TuningCache::store(const std::string &op, int threads, const GemmShape &shape, const TuningEntry &entry)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[make_key(host_signature(), op, threads, shape_bucket(shape))] = entry;
+}
+
+std::size_t TuningCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../common/gemm_shape.h"
+
+// A knob an op exposes to the autotuner: its current value and the values
+// worth trying for a given shape.
+struct TunableParam
+{
+    std::string name;
+    int value = 0;
+    std::vector<int> candidates;
+};
+
+// Concrete knob settings, in the order the op lists its tunables.
+using TuningValues = std::vector<std::pair<std::string, int>>;
+
+// "mc=96,kc=256" and back. parse_tuning_values throws std::invalid_argument
+// on malformed text.
+std::string format_tuning_values(const TuningValues &values);
+TuningValues parse_tuning_values(const std::string &text);
+
+// $XDG_CACHE_HOME/gemmbench/<file_name>, falling back to ~/.cache/gemmbench
+// and then the working directory. Per-host caches (tuning, machine peaks)
+// live there.
+std::string user_cache_path(const std::string &file_name);
+
+// Identifies the machine a tuning result was measured on: the CPU model
+// name and the micro-kernel ISA, without whitespace.
+const std::string &host_signature();
+
+// Shapes within a factor of sqrt(2) per dimension share tuned parameters:
+// each of M/N/K is rounded to the nearest power of two, e.g. "512x1024x256".
+std::string shape_bucket(const GemmShape &shape);
+
+struct TuningEntry
+{
+    TuningValues values;
+    double gflops = 0.0; // measured with the winning values, for reference
+};
+
+// Autotuning winners persisted on disk, keyed by host, op name, thread count
+// and shape bucket. The file is plain text, one entry per line:
+//
+//   host <TAB> op <TAB> threads <TAB> bucket <TAB> mc=96,kc=256,nc=4096 <TAB> gflops
+//
+// Lines starting with '#' are comments. Entries of other hosts are kept on
+// save, so one file can be shared between machines.
+class TuningCache
+{
+public:
+    // Process-wide cache consulted by ops at prepare() time. It is loaded on
+    // first use from $GEMMBENCH_TUNING_CACHE, or default_path() when unset,
+    // with load_lenient().
+    static TuningCache &shared();
+    static std::string default_path();
+
+    // Replaces the contents with the entries in path. A missing file is an
+    // empty cache; a malformed one throws std::runtime_error.
+    void load(const std::string &path);
+    // Like load(), but a malformed file is reported on stderr and leaves the
+    // cache empty, so benchmarks still run untuned. load_error() keeps the
+    // message for callers that must not save over the file (autotune).
+    void load_lenient(const std::string &path);
+    std::string load_error() const;
+    // Writes every entry back to path() (via a temporary file and rename).
+    void save() const;
+    const std::string &path() const { return path_; }
+
+    // Returns false when there is no entry for this host.
+    bool find(const std::string &op, int threads, const GemmShape &shape, TuningEntry &out) const;
+    void store(const std::string &op, int threads, const GemmShape &shape, const TuningEntry &entry);
+    std::size_t size() const;
+
+private:
+    static std::string make_key(const std::string &host, const std::string &op, int threads,
+                                const std::string &bucket);
+
+    mutable std::mutex mutex_;
+    std::string path_;
+    std::string load_error_;
+    std::map<std::string, TuningEntry> entries_;
+};
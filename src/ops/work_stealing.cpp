@@ -0,0 +1,125 @@
+#include "work_stealing.h"
+
+#include <algorithm>
+
+GemmTaskPlan plan_gemm_tasks(int M, int N, int K, int tile_m, int tile_n, int k_block,
+                             int num_threads, bool allow_k_split)
+{
+    GemmTaskPlan plan;
+    if (M <= 0 || N <= 0)
+    {
+        return plan;
+    }
+    tile_m = std::max(tile_m, 1);
+    tile_n = std::max(tile_n, 1);
+    k_block = std::max(k_block, 1);
+
+    const int m_tiles = (M + tile_m - 1) / tile_m;
+    const int n_tiles = (N + tile_n - 1) / tile_n;
+    const int mn_tiles = m_tiles * n_tiles;
+    const int k_blocks = std::max(1, (K + k_block - 1) / k_block);
+
+    int k_slices = 1;
+    if (allow_k_split && mn_tiles < 2 * num_threads)
+    {
+        k_slices = std::min(k_blocks, (2 * num_threads + mn_tiles - 1) / mn_tiles);
+    }
+    plan.k_slices = k_slices;
+
+    plan.tasks.reserve(static_cast<std::size_t>(mn_tiles) * static_cast<std::size_t>(k_slices));
+    for (int s = 0; s < k_slices; ++s)
+    {
+        // Slice boundaries fall on k_block multiples so packing stays aligned.
+        const int k0 = std::min(K, k_blocks * s / k_slices * k_block);
+        const int k1 = std::min(K, k_blocks * (s + 1) / k_slices * k_block);
+        for (int mt = 0; mt < m_tiles; ++mt)
+        {
+            for (int nt = 0; nt < n_tiles; ++nt)
+            {
+                GemmTask task;
+                task.m0 = mt * tile_m;
+                task.m1 = std::min(M, task.m0 + tile_m);
+                task.n0 = nt * tile_n;
+                task.n1 = std::min(N, task.n0 + tile_n);
+                task.k0 = k0;
+                task.k1 = k1;
+                task.k_slice = s;
+                plan.tasks.push_back(task);
+            }
+        }
+    }
+    return plan;
+}
+
+WorkStealingScheduler::WorkStealingScheduler(ThreadPool &pool)
+    : pool_(pool)
+{
+    deques_.reserve(static_cast<std::size_t>(pool_.size()));
+    for (int i = 0; i < pool_.size(); ++i)
+    {
+        deques_.push_back(std::make_unique<TaskDeque>());
+    }
+}
+
+bool WorkStealingScheduler::pop_own(int tid, std::size_t &task)
+{
+    TaskDeque &dq = *deques_[static_cast<std::size_t>(tid)];
+    std::lock_guard<std::mutex> lock(dq.mutex);
+    if (dq.items.empty())
+    {
+        return false;
+    }
+    task = dq.items.front();
+    dq.items.pop_front();
+    return true;
+}
+
+bool WorkStealingScheduler::steal(int thief, std::size_t &task)
+{
+    const int n = static_cast<int>(deques_.size());
+    for (int offset = 1; offset < n; ++offset)
+    {
+        TaskDeque &dq = *deques_[static_cast<std::size_t>((thief + offset) % n)];
+        std::lock_guard<std::mutex> lock(dq.mutex);
+        if (!dq.items.empty())
+        {
+            task = dq.items.back();
+            dq.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingScheduler::run(const std::vector<GemmTask> &tasks,
+                                const std::function<void(const GemmTask &, int)> &fn)
+{
+    steals_.store(0, std::memory_order_relaxed);
+    const std::size_t n_threads = deques_.size();
+    for (std::size_t t = 0; t < n_threads; ++t)
+    {
+        auto &items = deques_[t]->items;
+        items.clear();
+        const std::size_t begin = tasks.size() * t / n_threads;
+        const std::size_t end = tasks.size() * (t + 1) / n_threads;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            items.push_back(i);
+        }
+    }
+
+    // No task spawns new work, so a thread may retire as soon as every
+    // deque it can see is empty.
+    pool_.run([&](int tid, int) {
+        std::size_t task = 0;
+        while (pop_own(tid, task))
+        {
+            fn(tasks[task], tid);
+        }
+        while (steal(tid, task))
+        {
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            fn(tasks[task], tid);
+        }
+    });
+}
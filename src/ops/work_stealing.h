@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../common/thread_pool.h"
+
+// One unit of GEMM work: C[m0:m1, n0:n1] (+)= A[m0:m1, k0:k1] * B[k0:k1, n0:n1].
+// k_slice identifies which partial result the task contributes to when K is
+// split; slice 0 targets C itself.
+struct GemmTask
+{
+    int m0, m1;
+    int n0, n1;
+    int k0, k1;
+    int k_slice;
+};
+
+struct GemmTaskPlan
+{
+    std::vector<GemmTask> tasks;
+    int k_slices = 1;
+};
+
+// Tiles the (M, N) output into tile_m x tile_n blocks. When that yields fewer
+// than ~2 tasks per thread and allow_k_split is set, K is additionally split
+// into slices aligned to k_block so skinny shapes still expose parallelism.
+GemmTaskPlan plan_gemm_tasks(int M, int N, int K, int tile_m, int tile_n, int k_block,
+                             int num_threads, bool allow_k_split);
+
+// Per-thread deques of tasks on top of a ThreadPool. Tasks are dealt out in
+// contiguous chunks; owners pop from the front of their own deque and idle
+// threads steal from the back of others', so load imbalance from uneven tiles
+// or noisy cores is absorbed at runtime.
+class WorkStealingScheduler
+{
+public:
+    explicit WorkStealingScheduler(ThreadPool &pool);
+
+    // Runs fn(task, thread_id) for every task and returns when all are done.
+    void run(const std::vector<GemmTask> &tasks,
+             const std::function<void(const GemmTask &, int)> &fn);
+
+    // Number of tasks executed by a thread other than their initial owner
+    // during the last run().
+    std::size_t last_steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) TaskDeque
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> items;
+    };
+
+    bool pop_own(int tid, std::size_t &task);
+    bool steal(int thief, std::size_t &task);
+
+    ThreadPool &pool_;
+    std::vector<std::unique_ptr<TaskDeque>> deques_;
+    std::atomic<std::size_t> steals_{0};
+};
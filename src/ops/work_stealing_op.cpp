@@ -0,0 +1,196 @@
+#include "work_stealing_op.h"
+#include "gemm_kernels.h"
+#include "registry.h"
+#include "../common/trace.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr int kTileN = 512;
+}
+
+WorkStealingGemmOp::WorkStealingGemmOp()
+    : kernel_(best_gemm_kernel()), tile_n_(kTileN), num_threads_(ThreadPool::default_threads())
+{
+    per_thread_.resize(static_cast<std::size_t>(num_threads_));
+}
+
+void WorkStealingGemmOp::set_num_threads(int num_threads)
+{
+    num_threads = std::max(1, num_threads);
+    if (num_threads == num_threads_)
+    {
+        return;
+    }
+    num_threads_ = num_threads;
+    scheduler_.reset();
+    pool_.reset();
+    per_thread_.resize(static_cast<std::size_t>(num_threads_));
+}
+
+WorkStealingScheduler &WorkStealingGemmOp::scheduler()
+{
+    if (!scheduler_)
+    {
+        pool_ = std::make_unique<ThreadPool>(num_threads_);
+        scheduler_ = std::make_unique<WorkStealingScheduler>(*pool_);
+    }
+    return *scheduler_;
+}
+
+std::vector<int> WorkStealingGemmOp::worker_thread_ids() const
+{
+    return pool_ ? pool_->worker_thread_ids() : std::vector<int>{};
+}
+
+void WorkStealingGemmOp::run_on_threads(const std::function<void(int, int)> &job)
+{
+    scheduler();
+    pool_->run(job);
+}
+
+int WorkStealingGemmOp::tile_n() const
+{
+    return std::max(kernel_.nr, tile_n_ / kernel_.nr * kernel_.nr);
+}
+
+GemmTaskPlan WorkStealingGemmOp::plan_tasks(int M, int N, int K) const
+{
+    const BlockingParams bp = normalize_blocking(kernel_, params_, M, N, K);
+    return plan_gemm_tasks(M, N, K, bp.mc, tile_n(), bp.kc, num_threads_, true);
+}
+
+void WorkStealingGemmOp::prepare(const GemmShape &shape, MatrixLayout /*layout*/)
+{
+    apply_tuning(shape);
+    scheduler();
+    if (shape.M <= 0 || shape.N <= 0)
+    {
+        return;
+    }
+    const BlockingParams task_bp = normalize_blocking(kernel_, params_, shape.M, std::min(shape.N, tile_n()), shape.K);
+    for (auto &ws : per_thread_)
+    {
+        ws.reserve(kernel_, task_bp);
+    }
+    const std::size_t partial_count = static_cast<std::size_t>(shape.M) * static_cast<std::size_t>(shape.N) *
+                                      static_cast<std::size_t>(plan_tasks(shape.M, shape.N, shape.K).k_slices - 1);
+    if (partials_.size() < partial_count)
+    {
+        partials_ = MatrixBuffer::allocate_uninitialized(partial_count, 64);
+    }
+}
+
+std::vector<TunableParam> WorkStealingGemmOp::tunables(const GemmShape &shape) const
+{
+    std::vector<TunableParam> out = blocking_tunables(kernel_, params_, shape);
+    out.pop_back(); // nc
+    out.push_back(TunableParam{"tile_n", tile_n_,
+                               blocking_candidates({128, 256, 512, 1024, 2048}, kernel_.nr, shape.N)});
+    return out;
+}
+
+bool WorkStealingGemmOp::set_tunable(const std::string &name, int value)
+{
+    if (name == "tile_n")
+    {
+        if (value <= 0)
+        {
+            return false;
+        }
+        tile_n_ = value;
+        return true;
+    }
+    return name != "nc" && set_blocking_tunable(params_, name, value);
+}
+
+std::size_t WorkStealingGemmOp::workspace_size(const GemmShape &shape) const
+{
+    if (shape.M <= 0 || shape.N <= 0)
+    {
+        return 0;
+    }
+    const BlockingParams task_bp = normalize_blocking(kernel_, params_, shape.M, std::min(shape.N, tile_n()), shape.K);
+    const std::size_t per_thread = packed_a_size(kernel_, task_bp.mc, task_bp.kc) +
+                                   packed_b_size(kernel_, task_bp.kc, task_bp.nc);
+    const std::size_t partials = static_cast<std::size_t>(shape.M) * static_cast<std::size_t>(shape.N) *
+                                 static_cast<std::size_t>(plan_tasks(shape.M, shape.N, shape.K).k_slices - 1);
+    return (per_thread * per_thread_.size() + partials) * sizeof(float);
+}
+
+void WorkStealingGemmOp::run(const float *A, const float *B, float *C,
+                             int M, int N, int K)
+{
+    GemmArgs args;
+    args.M = M;
+    args.N = N;
+    args.K = K;
+    args.A = dense_view(A, M, K);
+    args.B = dense_view(B, K, N);
+    args.C = dense_view(C, M, N);
+    run_strided(args);
+}
+
+void WorkStealingGemmOp::run_strided(const GemmArgs &args)
+{
+    const int M = args.M;
+    const int N = args.N;
+    if (M <= 0 || N <= 0)
+    {
+        return;
+    }
+
+    const GemmTaskPlan plan = plan_tasks(M, N, args.K);
+
+    const std::size_t mn = static_cast<std::size_t>(M) * static_cast<std::size_t>(N);
+    const std::size_t partial_count = mn * static_cast<std::size_t>(plan.k_slices - 1);
+    if (partials_.size() < partial_count)
+    {
+        partials_ = MatrixBuffer::allocate_uninitialized(partial_count, 64);
+    }
+    float *partials = partials_.data();
+
+    // Slice 0 writes alpha * A * B + beta * C; the other slices write their
+    // alpha-scaled partial sums to dense M x N buffers that are added below.
+    scheduler().run(plan.tasks, [&](const GemmTask &t, int tid) {
+        GEMMBENCH_TRACE_SCOPE("task");
+        const int m = t.m1 - t.m0;
+        const int n = t.n1 - t.n0;
+        const int k = t.k1 - t.k0;
+        const MatrixView a = sub_view(args.A, t.m0, t.k0, m, k);
+        const MatrixView b = sub_view(args.B, t.k0, t.n0, k, n);
+        const bool first = t.k_slice == 0;
+        const MutableMatrixView c =
+            first ? sub_view(args.C, t.m0, t.n0, m, n)
+                  : sub_view(dense_view(partials + mn * static_cast<std::size_t>(t.k_slice - 1), M, N),
+                             t.m0, t.n0, m, n);
+        blocked_gemm(kernel_, params_, per_thread_[static_cast<std::size_t>(tid)], a, b, c, m, n, k,
+                     args.alpha, first ? args.beta : 0.0f);
+    });
+
+    if (plan.k_slices > 1)
+    {
+        const int slices = plan.k_slices;
+        const MutableMatrixView &C = args.C;
+        const std::size_t cs = C.col_stride();
+        pool_->parallel_for(static_cast<std::size_t>(M), 8, [&](std::size_t r0, std::size_t r1, int) {
+            GEMMBENCH_TRACE_SCOPE("reduce");
+            for (int s = 1; s < slices; ++s)
+            {
+                const float *src = partials + mn * static_cast<std::size_t>(s - 1);
+                for (std::size_t i = r0; i < r1; ++i)
+                {
+                    const float *row = src + i * static_cast<std::size_t>(N);
+                    float *dst = &C.at(static_cast<int>(i), 0);
+                    for (int j = 0; j < N; ++j)
+                    {
+                        dst[static_cast<std::size_t>(j) * cs] += row[j];
+                    }
+                }
+            }
+        });
+    }
+}
+
+REGISTER_GEMM_OP(WorkStealingGemmOp)
@@ -0,0 +1,48 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "gemm_op.h"
+#include "blocked_gemm.h"
+#include "work_stealing.h"
+
+// Blocked GEMM whose (m-block, n-block[, k-slice]) tiles are balanced across
+// threads by a WorkStealingScheduler. Skinny shapes such as M=64, N=16384 get
+// split along N and, when still short of work, along K with a final reduction.
+class WorkStealingGemmOp : public GemmOp
+{
+public:
+    WorkStealingGemmOp();
+    std::string name() const override { return "work_stealing"; }
+    void run(const float *A, const float *B, float *C,
+             int M, int N, int K) override;
+    // Every task runs the strided blocked_gemm on its block of the views;
+    // beta is applied by the k-slice 0 tasks, alpha folded into packed A.
+    void run_strided(const GemmArgs &args) override;
+    void set_num_threads(int num_threads) override;
+    int num_threads() const override { return num_threads_; }
+    std::vector<int> worker_thread_ids() const override;
+    void run_on_threads(const std::function<void(int, int)> &job) override;
+    void prepare(const GemmShape &shape, MatrixLayout layout) override;
+    std::size_t workspace_size(const GemmShape &shape) const override;
+    // "mc", "kc" and the scheduler's N tile width "tile_n". NC is not a knob:
+    // tasks are never wider than one tile.
+    std::vector<TunableParam> tunables(const GemmShape &shape) const override;
+    bool set_tunable(const std::string &name, int value) override;
+
+private:
+    // Width of the N tiles handed to the scheduler, a multiple of NR.
+    int tile_n() const;
+    GemmTaskPlan plan_tasks(int M, int N, int K) const;
+    // Starts the pool and its scheduler on first use (prepare or run).
+    WorkStealingScheduler &scheduler();
+
+    const GemmKernel &kernel_;
+    BlockingParams params_;
+    int tile_n_;
+    int num_threads_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::unique_ptr<WorkStealingScheduler> scheduler_;
+    std::vector<GemmWorkspace> per_thread_;
+    MatrixBuffer partials_; // K-split partial results for slices 1..k_slices-1
+};
@@ -0,0 +1,254 @@
+#include "compare.h"
+#include "json_reader.h"
+#include "benchmark/stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+std::string format_number(double v)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%g", v);
+    return buf;
+}
+
+std::string int_field(const JsonValue &obj, const char *key)
+{
+    return std::to_string(static_cast<long long>(obj.number_or(key, 0.0)));
+}
+
+// Everything besides M, N and K that changes the measured problem.
+std::string problem_variant(const JsonValue &run, const JsonValue &timing)
+{
+    std::string variant;
+    auto append = [&](const std::string &part) {
+        variant += (variant.empty() ? "" : " ") + part;
+    };
+    const double batch = timing.number_or("batch", 1.0);
+    if (batch > 1.0)
+    {
+        append("batch=" + format_number(batch));
+    }
+    if (const JsonValue *groups = run.find("group_shapes"); groups != nullptr && groups->is_array())
+    {
+        std::string list;
+        for (const JsonValue &g : groups->array)
+        {
+            std::string shape;
+            for (const JsonValue &d : g.array)
+            {
+                shape += (shape.empty() ? "" : "x") + format_number(d.number);
+            }
+            list += (list.empty() ? "" : ",") + shape;
+        }
+        append("groups=" + list);
+    }
+    if (const JsonValue *operands = run.find("operands"); operands != nullptr && operands->is_object())
+    {
+        for (const auto &member : operands->object)
+        {
+            const JsonValue &v = member.second;
+            append(member.first + "=" +
+                   (v.type == JsonValue::Type::Bool ? (v.boolean ? "true" : "false") : format_number(v.number)));
+        }
+    }
+    return variant;
+}
+
+StoredResult stored_result(const JsonValue &run, const JsonValue &timing, const std::string &source)
+{
+    StoredResult r;
+    r.op = run.string_or("op", "");
+    if (r.op.empty())
+    {
+        throw std::runtime_error(source + ": result without an \"op\" field");
+    }
+    r.shape = int_field(run, "M") + "x" + int_field(run, "N") + "x" + int_field(run, "K");
+    r.variant = problem_variant(run, timing);
+    r.threads = static_cast<int>(run.number_or("threads", 1.0));
+    r.cache_mode = timing.string_or("cache_mode", "hot");
+    if (const JsonValue *samples = timing.find("samples_ms"); samples != nullptr && samples->is_array())
+    {
+        for (const JsonValue &s : samples->array)
+        {
+            r.samples_ms.push_back(s.number);
+        }
+    }
+    r.median_ms = timing.number_or("median_ms", timing.number_or("time_ms", 0.0));
+    r.sources.push_back(source);
+    return r;
+}
+
+// A run report holds the headline result at the top level and, when several
+// cache modes were measured, every mode under "cache_modes".
+void collect_run(const JsonValue &run, const std::string &source, std::vector<StoredResult> &out)
+{
+    if (!run.is_object())
+    {
+        throw std::runtime_error(source + ": expected a run report object");
+    }
+    if (const JsonValue *modes = run.find("cache_modes"); modes != nullptr && modes->is_object())
+    {
+        for (const auto &mode : modes->object)
+        {
+            out.push_back(stored_result(run, mode.second, source));
+        }
+        return;
+    }
+    out.push_back(stored_result(run, run, source));
+}
+
+void collect_file(const std::string &path, std::vector<StoredResult> &out)
+{
+    const JsonValue doc = load_json_file(path);
+    if (doc.is_object() && doc.find("results") != nullptr && doc.find("results")->is_array())
+    {
+        for (const JsonValue &run : doc.find("results")->array)
+        {
+            collect_run(run, path, out);
+        }
+    }
+    else if (doc.is_object() && doc.find("op") != nullptr)
+    {
+        collect_run(doc, path, out);
+    }
+    else
+    {
+        throw std::runtime_error(path + ": not a gemmbench run or sweep report");
+    }
+}
+} // namespace
+
+std::string StoredResult::key() const
+{
+    return op + "|" + shape + "|" + variant + "|" + std::to_string(threads) + "|" + cache_mode;
+}
+
+std::vector<StoredResult> load_result_set(const std::string &path)
+{
+    std::vector<std::string> files;
+    if (std::filesystem::is_directory(path))
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(path))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".json")
+            {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        if (files.empty())
+        {
+            throw std::runtime_error("no .json reports in " + path);
+        }
+    }
+    else
+    {
+        files.push_back(path);
+    }
+
+    std::vector<StoredResult> raw;
+    for (const std::string &file : files)
+    {
+        collect_file(file, raw);
+    }
+
+    std::vector<StoredResult> results;
+    std::map<std::string, std::size_t> index;
+    for (StoredResult &r : raw)
+    {
+        const auto it = index.find(r.key());
+        if (it == index.end())
+        {
+            index.emplace(r.key(), results.size());
+            results.push_back(std::move(r));
+            continue;
+        }
+        StoredResult &pooled = results[it->second];
+        pooled.samples_ms.insert(pooled.samples_ms.end(), r.samples_ms.begin(), r.samples_ms.end());
+        pooled.sources.push_back(r.sources.front());
+        pooled.median_ms = compute_stats(pooled.samples_ms).median;
+    }
+    return results;
+}
+
+const char *compare_verdict_name(CompareVerdict verdict)
+{
+    switch (verdict)
+    {
+    case CompareVerdict::Regression:
+        return "regression";
+    case CompareVerdict::Improvement:
+        return "improvement";
+    case CompareVerdict::Inconclusive:
+        return "inconclusive";
+    default:
+        return "unchanged";
+    }
+}
+
+CompareReport compare_result_sets(const std::vector<StoredResult> &baseline,
+                                  const std::vector<StoredResult> &candidate,
+                                  const CompareConfig &cfg)
+{
+    CompareReport report;
+    report.config = cfg;
+    std::map<std::string, const StoredResult *> by_key;
+    for (const StoredResult &c : candidate)
+    {
+        by_key.emplace(c.key(), &c);
+    }
+
+    for (const StoredResult &b : baseline)
+    {
+        const auto it = by_key.find(b.key());
+        if (it == by_key.end())
+        {
+            report.only_baseline.push_back(&b);
+            continue;
+        }
+        const StoredResult &c = *it->second;
+        by_key.erase(it);
+
+        CompareEntry e;
+        e.baseline = &b;
+        e.candidate = &c;
+        e.ratio = b.median_ms > 0.0 ? c.median_ms / b.median_ms : 1.0;
+        const std::size_t min_samples = static_cast<std::size_t>(std::max(cfg.min_samples, 1));
+        if (b.samples_ms.size() < min_samples || c.samples_ms.size() < min_samples)
+        {
+            e.verdict = CompareVerdict::Inconclusive;
+            ++report.inconclusive;
+        }
+        else
+        {
+            e.p_slower = mann_whitney_greater(b.samples_ms, c.samples_ms).p_value;
+            e.p_faster = mann_whitney_greater(c.samples_ms, b.samples_ms).p_value;
+            if (e.p_slower < cfg.alpha && e.ratio > 1.0 + cfg.threshold)
+            {
+                e.verdict = CompareVerdict::Regression;
+                ++report.regressions;
+            }
+            else if (e.p_faster < cfg.alpha && e.ratio < 1.0 - cfg.threshold)
+            {
+                e.verdict = CompareVerdict::Improvement;
+                ++report.improvements;
+            }
+        }
+        report.entries.push_back(e);
+    }
+    for (const StoredResult &c : candidate)
+    {
+        if (by_key.count(c.key()) != 0)
+        {
+            report.only_candidate.push_back(&c);
+        }
+    }
+    return report;
+}
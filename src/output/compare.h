@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One measured (op, problem, threads, cache mode) result read back from a
+// run or sweep report.
+struct StoredResult
+{
+    std::string op;
+    std::string shape;   // "MxNxK" for display
+    std::string variant; // batch, group shapes and operand layout; part of the match key
+    int threads = 0;
+    std::string cache_mode = "hot";
+    std::vector<double> samples_ms;
+    double median_ms = 0.0;
+    std::vector<std::string> sources; // reports the samples came from
+
+    // Results with equal keys measured the same problem the same way.
+    std::string key() const;
+};
+
+// Reads a run report (run --output), a sweep report (sweep --output), or a
+// directory holding any number of them (*.json). Results that appear more
+// than once, e.g. from repeated runs, are pooled into one sample set.
+std::vector<StoredResult> load_result_set(const std::string &path);
+
+struct CompareConfig
+{
+    double alpha = 0.01;     // significance level of the one-sided tests
+    double threshold = 0.02; // relative median change below which nothing is flagged
+    int min_samples = 8;     // per side; fewer is reported as inconclusive
+};
+
+enum class CompareVerdict
+{
+    Unchanged,
+    Regression,
+    Improvement,
+    Inconclusive
+};
+
+const char *compare_verdict_name(CompareVerdict verdict);
+
+struct CompareEntry
+{
+    const StoredResult *baseline = nullptr;
+    const StoredResult *candidate = nullptr;
+    double ratio = 1.0;        // candidate median / baseline median
+    double p_slower = 1.0;     // Mann-Whitney p-value of "candidate is slower"
+    double p_faster = 1.0;     // and of "candidate is faster"
+    CompareVerdict verdict = CompareVerdict::Unchanged;
+};
+
+struct CompareReport
+{
+    CompareConfig config;
+    std::vector<CompareEntry> entries;           // in baseline order
+    std::vector<const StoredResult *> only_baseline;
+    std::vector<const StoredResult *> only_candidate;
+    std::size_t regressions = 0;
+    std::size_t improvements = 0;
+    std::size_t inconclusive = 0;
+};
+
+// Matches results by key. A pair is a regression when the median slowed by
+// more than the threshold and the rank test rejects "not slower" at alpha,
+// so noise and tiny but consistent shifts are both ignored. The report
+// points into both sets, which must outlive it.
+CompareReport compare_result_sets(const std::vector<StoredResult> &baseline,
+                                  const std::vector<StoredResult> &candidate,
+                                  const CompareConfig &cfg);
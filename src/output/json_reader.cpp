@@ -0,0 +1,298 @@
+#include "json_reader.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+constexpr int kMaxDepth = 256;
+
+class JsonParser
+{
+public:
+    explicit JsonParser(const std::string &text) : text_(text) {}
+
+    JsonValue parse_document()
+    {
+        JsonValue value = parse_value(0);
+        skip_whitespace();
+        if (pos_ != text_.size())
+        {
+            fail("trailing characters after the document");
+        }
+        return value;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string &what) const
+    {
+        throw std::runtime_error("invalid JSON at offset " + std::to_string(pos_) + ": " + what);
+    }
+
+    void skip_whitespace()
+    {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r'))
+        {
+            ++pos_;
+        }
+    }
+
+    bool consume(const char *literal)
+    {
+        const std::string::size_type len = std::char_traits<char>::length(literal);
+        if (text_.compare(pos_, len, literal) == 0)
+        {
+            pos_ += len;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c)
+    {
+        skip_whitespace();
+        if (pos_ >= text_.size() || text_[pos_] != c)
+        {
+            fail(std::string("expected '") + c + "'");
+        }
+        ++pos_;
+    }
+
+    JsonValue parse_value(int depth)
+    {
+        if (depth > kMaxDepth)
+        {
+            fail("nesting too deep");
+        }
+        skip_whitespace();
+        if (pos_ >= text_.size())
+        {
+            fail("unexpected end of input");
+        }
+        JsonValue value;
+        const char c = text_[pos_];
+        if (c == '{')
+        {
+            ++pos_;
+            value.type = JsonValue::Type::Object;
+            skip_whitespace();
+            if (pos_ < text_.size() && text_[pos_] == '}')
+            {
+                ++pos_;
+                return value;
+            }
+            for (;;)
+            {
+                skip_whitespace();
+                if (pos_ >= text_.size() || text_[pos_] != '"')
+                {
+                    fail("expected a member name");
+                }
+                std::string key = parse_string();
+                expect(':');
+                value.object.emplace_back(std::move(key), parse_value(depth + 1));
+                skip_whitespace();
+                if (pos_ < text_.size() && text_[pos_] == ',')
+                {
+                    ++pos_;
+                    continue;
+                }
+                expect('}');
+                return value;
+            }
+        }
+        if (c == '[')
+        {
+            ++pos_;
+            value.type = JsonValue::Type::Array;
+            skip_whitespace();
+            if (pos_ < text_.size() && text_[pos_] == ']')
+            {
+                ++pos_;
+                return value;
+            }
+            for (;;)
+            {
+                value.array.push_back(parse_value(depth + 1));
+                skip_whitespace();
+                if (pos_ < text_.size() && text_[pos_] == ',')
+                {
+                    ++pos_;
+                    continue;
+                }
+                expect(']');
+                return value;
+            }
+        }
+        if (c == '"')
+        {
+            value.type = JsonValue::Type::String;
+            value.string = parse_string();
+            return value;
+        }
+        if (consume("true"))
+        {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return value;
+        }
+        if (consume("false"))
+        {
+            value.type = JsonValue::Type::Bool;
+            return value;
+        }
+        if (consume("null"))
+        {
+            return value;
+        }
+        value.type = JsonValue::Type::Number;
+        value.number = parse_number();
+        return value;
+    }
+
+    // strtod also takes the nan/inf spellings.
+    double parse_number()
+    {
+        const char *begin = text_.c_str() + pos_;
+        char *end = nullptr;
+        const double number = std::strtod(begin, &end);
+        if (end == begin)
+        {
+            fail("unexpected character");
+        }
+        pos_ += static_cast<std::size_t>(end - begin);
+        return number;
+    }
+
+    // Reports only contain ASCII names; \u escapes are decoded as UTF-8
+    // without pairing surrogates.
+    std::string parse_string()
+    {
+        ++pos_; // opening quote
+        std::string out;
+        while (pos_ < text_.size())
+        {
+            const char c = text_[pos_++];
+            if (c == '"')
+            {
+                return out;
+            }
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (pos_ >= text_.size())
+            {
+                break;
+            }
+            const char esc = text_[pos_++];
+            switch (esc)
+            {
+            case '"':
+            case '\\':
+            case '/':
+                out += esc;
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u':
+            {
+                if (pos_ + 4 > text_.size())
+                {
+                    fail("truncated \\u escape");
+                }
+                const unsigned long code = std::strtoul(text_.substr(pos_, 4).c_str(), nullptr, 16);
+                pos_ += 4;
+                if (code < 0x80)
+                {
+                    out += static_cast<char>(code);
+                }
+                else if (code < 0x800)
+                {
+                    out += static_cast<char>(0xC0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    out += static_cast<char>(0xE0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                fail(std::string("invalid escape '\\") + esc + "'");
+            }
+        }
+        fail("unterminated string");
+    }
+
+    const std::string &text_;
+    std::size_t pos_ = 0;
+};
+} // namespace
+
+const JsonValue *JsonValue::find(const std::string &key) const
+{
+    for (const auto &member : object)
+    {
+        if (member.first == key)
+        {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+double JsonValue::number_or(const std::string &key, double fallback) const
+{
+    const JsonValue *v = find(key);
+    return v != nullptr && v->type == Type::Number ? v->number : fallback;
+}
+
+std::string JsonValue::string_or(const std::string &key, const std::string &fallback) const
+{
+    const JsonValue *v = find(key);
+    return v != nullptr && v->type == Type::String ? v->string : fallback;
+}
+
+JsonValue parse_json(const std::string &text)
+{
+    return JsonParser(text).parse_document();
+}
+
+JsonValue load_json_file(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    try
+    {
+        return parse_json(buffer.str());
+    }
+    catch (const std::exception &ex)
+    {
+        throw std::runtime_error(path + ": " + ex.what());
+    }
+}
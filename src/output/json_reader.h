@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON document model, enough to read back the reports written by
+// json_writer (run --output, sweep --output).
+struct JsonValue
+{
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object; // in document order
+
+    bool is_object() const { return type == Type::Object; }
+    bool is_array() const { return type == Type::Array; }
+
+    // Member of an object, or nullptr when absent or not an object.
+    const JsonValue *find(const std::string &key) const;
+    double number_or(const std::string &key, double fallback) const;
+    std::string string_or(const std::string &key, const std::string &fallback) const;
+};
+
+// Throws std::runtime_error with the byte offset on malformed input. Accepts
+// the nan/inf tokens an ostream prints for non-finite doubles.
+JsonValue parse_json(const std::string &text);
+JsonValue load_json_file(const std::string &path);
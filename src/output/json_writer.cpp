@@ -1,6 +1,111 @@
 #include "json_writer.h"
+#include <cstdio>
 #include <sstream>
 
+namespace
+{
+void write_perf_fields(std::ostream &os, const PerfSummary &perf, const std::string &ind)
+{
+    os << ind << "\"perf\": {\n";
+    os << ind << "  \"available\": " << (perf.available ? "true" : "false");
+    if (!perf.status.empty())
+    {
+        os << ",\n" << ind << "  \"status\": \"" << perf.status << "\"";
+    }
+    if (perf.available)
+    {
+        os << ",\n" << ind << "  \"threads\": " << perf.threads;
+        for (int e = 0; e < kPerfEventCount; ++e)
+        {
+            if (perf.mean.valid[e])
+            {
+                os << ",\n" << ind << "  \"" << perf_event_name(static_cast<PerfEvent>(e)) << "\": " << perf.mean.values[e];
+            }
+        }
+        os << ",\n" << ind << "  \"ipc\": " << perf.ipc;
+        os << ",\n" << ind << "  \"l1d_mpki\": " << perf.l1d_mpki;
+        os << ",\n" << ind << "  \"llc_mpki\": " << perf.llc_mpki;
+        os << ",\n" << ind << "  \"dtlb_mpki\": " << perf.dtlb_mpki;
+        if (!perf.partial)
+        {
+            os << ",\n" << ind << "  \"flops_per_cycle\": " << perf.flops_per_cycle;
+        }
+        if (perf.mean.valid[kPerfFpOps])
+        {
+            os << ",\n" << ind << "  \"fp_ops_per_cycle\": " << perf.fp_ops_per_cycle;
+        }
+    }
+    os << "\n" << ind << "}";
+}
+
+void write_timing_fields(std::ostream &os, const BenchResult &r, double gflops, const std::string &ind)
+{
+    const auto &st = r.stats;
+    os << ind << "\"cache_mode\": \"" << cache_mode_name(r.cache_mode) << "\",\n";
+    os << ind << "\"time_ms\": " << r.ms << ",\n";
+    os << ind << "\"min_ms\": " << st.min << ",\n";
+    os << ind << "\"median_ms\": " << st.median << ",\n";
+    os << ind << "\"mean_ms\": " << st.mean << ",\n";
+    os << ind << "\"p90_ms\": " << st.p90 << ",\n";
+    os << ind << "\"p99_ms\": " << st.p99 << ",\n";
+    os << ind << "\"stddev_ms\": " << st.stddev << ",\n";
+    os << ind << "\"cv\": " << st.cv << ",\n";
+    os << ind << "\"warmup\": " << r.warmup << ",\n";
+    os << ind << "\"iterations\": " << r.samples_ms.size() << ",\n";
+    os << ind << "\"samples_ms\": [";
+    for (std::size_t i = 0; i < r.samples_ms.size(); ++i)
+    {
+        os << (i ? ", " : "") << r.samples_ms[i];
+    }
+    os << "],\n";
+    os << ind << "\"gflops\": " << gflops << ",\n";
+    if (r.batch > 1)
+    {
+        os << ind << "\"batch\": " << r.batch << ",\n";
+        os << ind << "\"per_gemm_us\": " << r.ms * 1e3 / r.batch << ",\n";
+    }
+    if (r.groups > 0)
+    {
+        os << ind << "\"groups\": " << r.groups << ",\n";
+    }
+    os << ind << "\"prepare_ms\": " << r.prepare_ms << ",\n";
+    if (r.b_prepacked)
+    {
+        os << ind << "\"pack_b_ms\": " << r.pack_b_ms << ",\n";
+    }
+    os << ind << "\"first_run_ms\": " << r.first_run_ms << ",\n";
+    os << ind << "\"workspace_bytes\": " << r.workspace_bytes;
+    if (r.perf.enabled)
+    {
+        os << ",\n";
+        write_perf_fields(os, r.perf, ind);
+    }
+}
+
+// Error messages are free text; keep the JSON well formed.
+std::string escape_json(const std::string &text)
+{
+    std::string out;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            out += ' ';
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+} // namespace
+
 std::string make_json(const BenchResult &r,
                       const std::string &op,
                       int M, int N, int K)
@@ -11,7 +116,218 @@ std::string make_json(const BenchResult &r,
     oss << "\"M\":" << M << ",";
     oss << "\"N\":" << N << ",";
     oss << "\"K\":" << K << ",";
-    oss << "\"time_ms\":" << r.ms;
+    oss << "\"time_ms\":" << r.ms << ",";
+    oss << "\"min_ms\":" << r.stats.min << ",";
+    oss << "\"median_ms\":" << r.stats.median << ",";
+    oss << "\"mean_ms\":" << r.stats.mean << ",";
+    oss << "\"p90_ms\":" << r.stats.p90 << ",";
+    oss << "\"p99_ms\":" << r.stats.p99 << ",";
+    oss << "\"stddev_ms\":" << r.stats.stddev << ",";
+    oss << "\"iterations\":" << r.samples_ms.size();
     oss << "}";
     return oss.str();
-}
\ No newline at end of file
+}
+
+double report_gflops(const RunReport &report, const BenchResult &r)
+{
+    // Batched and grouped results time the whole call, so this is the
+    // aggregate rate.
+    const double flops = r.flops > 0.0 ? r.flops : 2.0 * report.M * report.N * report.K * r.batch;
+    return r.ms > 0.0 ? flops / (r.ms * 1e-3 * 1e9) : 0.0;
+}
+
+void write_run_report(std::ostream &os, const RunReport &report, const std::string &indent)
+{
+    const std::string ind = indent + "  ";
+    os << indent << "{\n";
+    os << ind << "\"op\": \"" << report.op << "\",\n";
+    os << ind << "\"M\": " << report.M << ",\n";
+    os << ind << "\"N\": " << report.N << ",\n";
+    os << ind << "\"K\": " << report.K << ",\n";
+    os << ind << "\"threads\": " << report.threads << ",\n";
+    os << ind << "\"alloc\": \"" << report.alloc_policy << "\",\n";
+    if (report.strided)
+    {
+        os << ind << "\"operands\": {\"trans_a\": " << (report.trans_a ? "true" : "false")
+           << ", \"trans_b\": " << (report.trans_b ? "true" : "false")
+           << ", \"lda\": " << report.lda << ", \"ldb\": " << report.ldb << ", \"ldc\": " << report.ldc
+           << ", \"alpha\": " << report.alpha << ", \"beta\": " << report.beta << "},\n";
+    }
+    if (!report.group_shapes.empty())
+    {
+        os << ind << "\"group_shapes\": [";
+        for (std::size_t g = 0; g < report.group_shapes.size(); ++g)
+        {
+            const GemmShape &shape = report.group_shapes[g];
+            os << (g ? ", " : "") << "[" << shape.M << ", " << shape.N << ", " << shape.K << "]";
+        }
+        os << "],\n";
+    }
+    if (!report.tuning.empty())
+    {
+        os << ind << "\"tuning\": {";
+        for (std::size_t i = 0; i < report.tuning.size(); ++i)
+        {
+            os << (i ? ", " : "") << "\"" << report.tuning[i].first << "\": " << report.tuning[i].second;
+        }
+        os << "},\n";
+    }
+    if (!report.results.empty())
+    {
+        write_timing_fields(os, report.results.front(), report_gflops(report, report.results.front()), ind);
+        os << ",\n";
+    }
+    if (report.results.size() > 1)
+    {
+        // Side-by-side view of every measured cache mode.
+        os << ind << "\"cache_modes\": {\n";
+        for (std::size_t i = 0; i < report.results.size(); ++i)
+        {
+            const auto &r = report.results[i];
+            os << ind << "  \"" << cache_mode_name(r.cache_mode) << "\": {\n";
+            write_timing_fields(os, r, report_gflops(report, r), ind + "    ");
+            os << "\n" << ind << "  }" << (i + 1 < report.results.size() ? "," : "") << "\n";
+        }
+        os << ind << "},\n";
+        const BenchResult *hot = nullptr;
+        const BenchResult *cold = nullptr;
+        for (const auto &r : report.results)
+        {
+            (r.cache_mode == CacheMode::Cold ? cold : hot) = &r;
+        }
+        if (hot && cold && hot->ms > 0.0)
+        {
+            os << ind << "\"cold_penalty\": " << cold->ms / hot->ms << ",\n";
+        }
+    }
+    if (report.roofline.available)
+    {
+        const Roofline &rl = report.roofline;
+        os << ind << "\"roofline\": {\"threads\": " << rl.threads << ", \"intensity\": " << rl.intensity
+           << ", \"bytes\": " << rl.bytes << ", \"peak_gflops\": " << rl.peak_gflops
+           << ", \"bandwidth_gbs\": " << rl.bandwidth_gbs << ", \"attainable_gflops\": " << rl.attainable_gflops
+           << ", \"bound\": \"" << (rl.memory_bound ? "memory" : "compute") << "\", \"pct_of_peak\": "
+           << rl.pct_of_peak << ", \"pct_of_attainable\": " << rl.pct_of_attainable << "},\n";
+    }
+    os << ind << "\"verified\": " << (report.verified ? "true" : "false") << ",\n";
+    os << ind << "\"verify_mode\": \"" << report.verify_mode << "\",\n";
+    if (report.verify_mode == "freivalds")
+    {
+        os << ind << "\"verify_trials\": " << report.verify_trials << ",\n";
+    }
+    os << ind << "\"max_abs_error\": " << report.max_abs_error << ",\n";
+    os << ind << "\"max_rel_error\": " << report.max_rel_error << "\n";
+    os << indent << "}";
+}
+
+void write_sweep_report(std::ostream &os, const SweepReport &report)
+{
+    os << "{\n";
+    os << "  \"sweep\": {\n";
+    os << "    \"ops\": [";
+    for (std::size_t i = 0; i < report.ops.size(); ++i)
+    {
+        os << (i ? ", " : "") << "\"" << report.ops[i] << "\"";
+    }
+    os << "],\n";
+    os << "    \"shapes\": " << report.shapes << ",\n";
+    os << "    \"threads\": " << report.threads << ",\n";
+    os << "    \"cache\": \"" << report.cache_mode << "\",\n";
+    os << "    \"verify\": \"" << report.verify_mode << "\",\n";
+    os << "    \"wall_ms\": " << report.wall_ms << "\n";
+    os << "  },\n";
+    os << "  \"results\": [";
+    for (std::size_t i = 0; i < report.runs.size(); ++i)
+    {
+        os << (i ? ",\n" : "\n");
+        write_run_report(os, report.runs[i], "    ");
+    }
+    os << (report.runs.empty() ? "],\n" : "\n  ],\n");
+    os << "  \"failures\": [";
+    for (std::size_t i = 0; i < report.failures.size(); ++i)
+    {
+        const SweepFailure &f = report.failures[i];
+        os << (i ? ",\n" : "\n") << "    {\"op\": \"" << f.op << "\", \"M\": " << f.M << ", \"N\": " << f.N
+           << ", \"K\": " << f.K << ", \"error\": \"" << escape_json(f.error) << "\"}";
+    }
+    os << (report.failures.empty() ? "]\n" : "\n  ]\n");
+    os << "}\n";
+}
+
+void write_compare_report(std::ostream &os, const CompareReport &report)
+{
+    auto write_id = [&](const StoredResult &r) {
+        os << "\"op\": \"" << escape_json(r.op) << "\", \"shape\": \"" << r.shape << "\", ";
+        if (!r.variant.empty())
+        {
+            os << "\"variant\": \"" << escape_json(r.variant) << "\", ";
+        }
+        os << "\"threads\": " << r.threads << ", \"cache_mode\": \"" << r.cache_mode << "\"";
+    };
+    auto write_missing = [&](const char *name, const std::vector<const StoredResult *> &results, bool last) {
+        os << "  \"" << name << "\": [";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            os << (i ? ",\n" : "\n") << "    {";
+            write_id(*results[i]);
+            os << "}";
+        }
+        os << (results.empty() ? "]" : "\n  ]") << (last ? "\n" : ",\n");
+    };
+
+    os << "{\n";
+    os << "  \"compare\": {\"alpha\": " << report.config.alpha << ", \"threshold\": " << report.config.threshold
+       << ", \"min_samples\": " << report.config.min_samples << ", \"matched\": " << report.entries.size()
+       << ", \"regressions\": " << report.regressions << ", \"improvements\": " << report.improvements
+       << ", \"inconclusive\": " << report.inconclusive << "},\n";
+    os << "  \"results\": [";
+    for (std::size_t i = 0; i < report.entries.size(); ++i)
+    {
+        const CompareEntry &e = report.entries[i];
+        os << (i ? ",\n" : "\n") << "    {";
+        write_id(*e.baseline);
+        os << ", \"baseline_median_ms\": " << e.baseline->median_ms
+           << ", \"candidate_median_ms\": " << e.candidate->median_ms
+           << ", \"baseline_samples\": " << e.baseline->samples_ms.size()
+           << ", \"candidate_samples\": " << e.candidate->samples_ms.size() << ", \"ratio\": " << e.ratio
+           << ", \"p_slower\": " << e.p_slower << ", \"p_faster\": " << e.p_faster << ", \"verdict\": \""
+           << compare_verdict_name(e.verdict) << "\"}";
+    }
+    os << (report.entries.empty() ? "],\n" : "\n  ],\n");
+    write_missing("only_baseline", report.only_baseline, false);
+    write_missing("only_candidate", report.only_candidate, true);
+    os << "}\n";
+}
+
+void write_chrome_trace(std::ostream &os, const std::vector<TraceThread> &threads)
+{
+    std::uint64_t dropped = 0;
+    bool first = true;
+    auto separator = [&]() {
+        os << (first ? "\n" : ",\n");
+        first = false;
+    };
+    os << "{\n";
+    os << "  \"displayTimeUnit\": \"ns\",\n";
+    os << "  \"traceEvents\": [";
+    for (const TraceThread &t : threads)
+    {
+        dropped += t.dropped;
+        separator();
+        os << "    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t.tid
+           << ", \"args\": {\"name\": \"" << escape_json(t.name) << "\"}}";
+        for (const TraceEvent &e : t.events)
+        {
+            // Timestamps are microseconds; keep nanosecond resolution.
+            char times[64];
+            std::snprintf(times, sizeof(times), "\"ts\": %.3f, \"dur\": %.3f", e.begin_ns / 1e3,
+                          (e.end_ns - e.begin_ns) / 1e3);
+            separator();
+            os << "    {\"name\": \"" << escape_json(e.name) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << t.tid
+               << ", " << times << "}";
+        }
+    }
+    os << (first ? "],\n" : "\n  ],\n");
+    os << "  \"otherData\": {\"dropped_events\": " << dropped << "}\n";
+    os << "}\n";
+}
@@ -1,7 +1,93 @@
 #pragma once
+#include <cstddef>
+#include <ostream>
 #include <string>
+#include <vector>
 #include "benchmark/benchmark.h"
+#include "benchmark/roofline.h"
+#include "common/trace.h"
+#include "compare.h"
 
 std::string make_json(const BenchResult &r,
                       const std::string &op,
-                      int M, int N, int K);
\ No newline at end of file
+                      int M, int N, int K);
+
+// Everything the run subcommand reports for one (op, shape) pair.
+struct RunReport
+{
+    std::string op;
+    int M = 0;
+    int N = 0;
+    int K = 0;
+    int threads = 1;
+    std::string alloc_policy = "default";
+    // Operand layout of a strided run (run --trans-a/--lda/--alpha/...);
+    // written to the report only when strided is set.
+    bool strided = false;
+    bool trans_a = false;
+    bool trans_b = false;
+    std::size_t lda = 0;
+    std::size_t ldb = 0;
+    std::size_t ldc = 0;
+    float alpha = 1.0f;
+    float beta = 0.0f;
+    // (M, N, K) of every group of a grouped run; M, N and K above are then
+    // the largest extents.
+    std::vector<GemmShape> group_shapes;
+    // Knob values prepare() took from the tuning cache (GemmOp::applied_tuning);
+    // written as "tuning" when non-empty.
+    TuningValues tuning;
+    // Headline result against the host's measured peaks; written as
+    // "roofline" when available.
+    Roofline roofline;
+    // One entry per measured cache mode; the first one is the headline
+    // result written at the top level of the report.
+    std::vector<BenchResult> results;
+    bool verified = false;
+    // "full" compares against the stored reference; "freivalds" reports the
+    // residual of C x against A (B x) in max_abs_error / max_rel_error.
+    std::string verify_mode = "full";
+    int verify_trials = 0;
+    double max_abs_error = 0.0;
+    double max_rel_error = 0.0;
+};
+
+double report_gflops(const RunReport &report, const BenchResult &r);
+
+// Pretty-printed JSON object; indent is prepended to every line so reports
+// can be nested inside arrays.
+void write_run_report(std::ostream &os, const RunReport &report, const std::string &indent = "");
+
+// One (op, shape) combination of a sweep that could not be measured, e.g.
+// because the op needs an ISA the host lacks.
+struct SweepFailure
+{
+    std::string op;
+    int M = 0;
+    int N = 0;
+    int K = 0;
+    std::string error;
+};
+
+// Consolidated result of the sweep subcommand: every run in one file.
+struct SweepReport
+{
+    std::vector<std::string> ops;
+    std::size_t shapes = 0;
+    int threads = 0; // requested --threads (0 = op default); each run records its own
+    std::string cache_mode = "hot";
+    std::string verify_mode = "freivalds";
+    double wall_ms = 0.0; // whole sweep, generation and verification included
+    std::vector<RunReport> runs;
+    std::vector<SweepFailure> failures;
+};
+
+void write_sweep_report(std::ostream &os, const SweepReport &report);
+
+// Result of the compare subcommand: one entry per matched result plus the
+// keys present on one side only.
+void write_compare_report(std::ostream &os, const CompareReport &report);
+
+// Chrome trace-event JSON ("X" complete events, one track per thread) of a
+// Tracer::snapshot(); opens in Perfetto or chrome://tracing.
+void write_chrome_trace(std::ostream &os, const std::vector<TraceThread> &threads);
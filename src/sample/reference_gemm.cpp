@@ -1,36 +1,167 @@
 #include "reference_gemm.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <stdexcept>
+#include <vector>
+
+#include "../common/thread_pool.h"
+
+namespace
+{
+// Rows of C per parallel task, columns of C kept in the double accumulator,
+// and depth of one K block (the B block KB x NB stays resident in L2 while
+// all rows of the task sweep over it).
+constexpr int kRefRows = 16;
+constexpr int kRefCols = 256;
+constexpr int kRefDepth = 256;
+
+struct RefBlock
+{
+    const float *A;
+    const float *B;
+    float *C;
+    int N;
+    int K;
+    int i0, i1;
+    int j0, j1;
+};
+
+void reference_block(const RefBlock &blk, double *acc)
+{
+    const int cols = blk.j1 - blk.j0;
+    std::fill(acc, acc + static_cast<std::size_t>(blk.i1 - blk.i0) * kRefCols, 0.0);
+    for (int k0 = 0; k0 < blk.K; k0 += kRefDepth)
+    {
+        const int k1 = std::min(blk.K, k0 + kRefDepth);
+        for (int i = blk.i0; i < blk.i1; ++i)
+        {
+            const float *a_row = blk.A + static_cast<std::size_t>(i) * blk.K;
+            double *acc_row = acc + static_cast<std::size_t>(i - blk.i0) * kRefCols;
+            for (int k = k0; k < k1; ++k)
+            {
+                const double a = a_row[k];
+                const float *b_row = blk.B + static_cast<std::size_t>(k) * blk.N + blk.j0;
+                for (int j = 0; j < cols; ++j)
+                {
+                    acc_row[j] += a * static_cast<double>(b_row[j]);
+                }
+            }
+        }
+    }
+    for (int i = blk.i0; i < blk.i1; ++i)
+    {
+        const double *acc_row = acc + static_cast<std::size_t>(i - blk.i0) * kRefCols;
+        float *c_row = blk.C + static_cast<std::size_t>(i) * blk.N + blk.j0;
+        for (int j = 0; j < cols; ++j)
+        {
+            c_row[j] = static_cast<float>(acc_row[j]);
+        }
+    }
+}
+
+// Same traversal as reference_block, with a Kahan compensation term per
+// accumulator. Products are exact in double, so only the additions round.
+void reference_block_compensated(const RefBlock &blk, double *acc, double *comp)
+{
+    const int cols = blk.j1 - blk.j0;
+    const std::size_t tile = static_cast<std::size_t>(blk.i1 - blk.i0) * kRefCols;
+    std::fill(acc, acc + tile, 0.0);
+    std::fill(comp, comp + tile, 0.0);
+    for (int k0 = 0; k0 < blk.K; k0 += kRefDepth)
+    {
+        const int k1 = std::min(blk.K, k0 + kRefDepth);
+        for (int i = blk.i0; i < blk.i1; ++i)
+        {
+            const float *a_row = blk.A + static_cast<std::size_t>(i) * blk.K;
+            double *acc_row = acc + static_cast<std::size_t>(i - blk.i0) * kRefCols;
+            double *comp_row = comp + static_cast<std::size_t>(i - blk.i0) * kRefCols;
+            for (int k = k0; k < k1; ++k)
+            {
+                const double a = a_row[k];
+                const float *b_row = blk.B + static_cast<std::size_t>(k) * blk.N + blk.j0;
+                for (int j = 0; j < cols; ++j)
+                {
+                    const double y = a * static_cast<double>(b_row[j]) - comp_row[j];
+                    const double t = acc_row[j] + y;
+                    comp_row[j] = (t - acc_row[j]) - y;
+                    acc_row[j] = t;
+                }
+            }
+        }
+    }
+    for (int i = blk.i0; i < blk.i1; ++i)
+    {
+        const double *acc_row = acc + static_cast<std::size_t>(i - blk.i0) * kRefCols;
+        float *c_row = blk.C + static_cast<std::size_t>(i) * blk.N + blk.j0;
+        for (int j = 0; j < cols; ++j)
+        {
+            c_row[j] = static_cast<float>(acc_row[j]);
+        }
+    }
+}
+} // namespace
 
 MatrixBuffer compute_reference_c(const SampleConfig &cfg,
                                  const MatrixBuffer &A,
-                                 const MatrixBuffer &B)
+                                 const MatrixBuffer &B,
+                                 bool compensated)
 {
-    const auto expectedA = static_cast<std::size_t>(cfg.M) * static_cast<std::size_t>(cfg.K);
-    const auto expectedB = static_cast<std::size_t>(cfg.K) * static_cast<std::size_t>(cfg.N);
-    if (A.size() != expectedA || B.size() != expectedB)
+    // Every entry of a batch, or every group, is one problem with its own
+    // operand offsets; batches repeat the same shape.
+    std::vector<GemmShape> shapes = cfg.groups;
+    if (shapes.empty())
+    {
+        shapes.assign(static_cast<std::size_t>(std::max(cfg.batch, 1)), GemmShape{cfg.M, cfg.N, cfg.K});
+    }
+    const GroupedOffsets off = grouped_offsets(shapes);
+    if (A.size() != off.a.back() || B.size() != off.b.back())
     {
         throw std::runtime_error("Input matrices have mismatched sizes for reference GEMM");
     }
 
-    MatrixBuffer C = MatrixBuffer::allocate(static_cast<std::size_t>(cfg.M) * static_cast<std::size_t>(cfg.N));
+    // Every tile below is written, so C is not zeroed first.
+    MatrixBuffer C = MatrixBuffer::allocate_uninitialized(off.c.back());
+
+    // first_tile[p] is the global index of problem p's first tile.
+    std::vector<std::size_t> first_tile(1, 0);
+    for (const GemmShape &s : shapes)
+    {
+        const std::size_t row_blocks = (static_cast<std::size_t>(std::max(s.M, 0)) + kRefRows - 1) / kRefRows;
+        const std::size_t col_blocks = (static_cast<std::size_t>(std::max(s.N, 0)) + kRefCols - 1) / kRefCols;
+        first_tile.push_back(first_tile.back() + row_blocks * col_blocks);
+    }
     const float *a_ptr = A.data();
     const float *b_ptr = B.data();
     float *c_ptr = C.data();
 
-    for (int i = 0; i < cfg.M; ++i)
-    {
-        for (int j = 0; j < cfg.N; ++j)
+    // One task per kRefRows x kRefCols tile of C; every tile is written by
+    // exactly one task, so the result does not depend on the thread count.
+    ThreadPool::shared().parallel_for(first_tile.back(), 1, [&](std::size_t begin, std::size_t end, int) {
+        std::vector<double> acc(static_cast<std::size_t>(kRefRows) * kRefCols);
+        std::vector<double> comp(compensated ? acc.size() : 0);
+        for (std::size_t task = begin; task < end; ++task)
         {
-            float sum = 0.0f;
-            for (int k = 0; k < cfg.K; ++k)
+            const std::size_t p = static_cast<std::size_t>(
+                std::upper_bound(first_tile.begin(), first_tile.end(), task) - first_tile.begin() - 1);
+            const GemmShape &s = shapes[p];
+            const std::size_t col_blocks = (static_cast<std::size_t>(s.N) + kRefCols - 1) / kRefCols;
+            const std::size_t tile = task - first_tile[p];
+            const int rb = static_cast<int>(tile / col_blocks);
+            const int cb = static_cast<int>(tile % col_blocks);
+            RefBlock blk{a_ptr + off.a[p], b_ptr + off.b[p], c_ptr + off.c[p], s.N, s.K,
+                         rb * kRefRows, std::min(s.M, (rb + 1) * kRefRows),
+                         cb * kRefCols, std::min(s.N, (cb + 1) * kRefCols)};
+            if (compensated)
             {
-                sum += a_ptr[i * cfg.K + k] * b_ptr[k * cfg.N + j];
+                reference_block_compensated(blk, acc.data(), comp.data());
+            }
+            else
+            {
+                reference_block(blk, acc.data());
             }
-            c_ptr[i * cfg.N + j] = sum;
         }
-    }
+    });
 
     return C;
 }
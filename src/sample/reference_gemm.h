@@ -3,6 +3,14 @@
 #include "../common/matrix_buffer.h"
 #include "sample_generator.h"
 
+// Row-major C = A * B used as the ground truth stored in samples. Products are
+// accumulated in double (float * float is exact in double), cache blocked and
+// spread over ThreadPool::shared(). With compensated set the double sums use
+// Kahan summation as well, which keeps the reference exact to the last float
+// bit even for very large K at roughly twice the cost. Batched and grouped
+// configs compute every entry, with the tiles of all entries in one
+// parallel loop.
 MatrixBuffer compute_reference_c(const SampleConfig &cfg,
                                  const MatrixBuffer &A,
-                                 const MatrixBuffer &B);
+                                 const MatrixBuffer &B,
+                                 bool compensated = false);
@@ -1,46 +1,204 @@
 #include "sample_generator.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
 #include <random>
+#include <stdexcept>
 
-MatrixBuffer generate_matrix(int rows, int cols, std::uint32_t seed, int pattern)
+#include "../common/thread_pool.h"
+
+namespace
 {
-    MatrixBuffer mat = MatrixBuffer::allocate(static_cast<std::size_t>(rows) * static_cast<std::size_t>(cols));
-    float *data = mat.data();
+// Elements per parallel_for chunk; a multiple of the Philox block width so
+// every chunk starts on a block boundary.
+constexpr std::size_t kFillGrain = 64 * 1024;
+constexpr std::size_t kPhiloxLanes = 4;
+constexpr std::size_t kPhiloxBatch = 16;
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// Block b of a matrix is philox(counter = {b, b >> 32, 0, 0}, key = {seed, 0}),
+// so every element depends only on (seed, index) and any thread can produce
+// any range.
+constexpr std::uint32_t kPhiloxM0 = 0xD2511F53u;
+constexpr std::uint32_t kPhiloxM1 = 0xCD9E8D57u;
+constexpr std::uint32_t kPhiloxW0 = 0x9E3779B9u;
+constexpr std::uint32_t kPhiloxW1 = 0xBB67AE85u;
+constexpr int kPhiloxRounds = 10;
+
+// Maps the top 24 bits of x onto [-1, 1); exact in float.
+inline float bits_to_unit(std::uint32_t x)
+{
+    return static_cast<float>(x >> 8) * (1.0f / 8388608.0f) - 1.0f;
+}
+
+// Generates kPhiloxBatch consecutive blocks starting at first_block. Lanes are
+// kept in separate arrays so the rounds vectorize across blocks.
+void philox_batch(std::uint64_t first_block, std::uint32_t seed, float *out)
+{
+    std::uint32_t c0[kPhiloxBatch], c1[kPhiloxBatch], c2[kPhiloxBatch], c3[kPhiloxBatch];
+    for (std::size_t b = 0; b < kPhiloxBatch; ++b)
+    {
+        const std::uint64_t block = first_block + b;
+        c0[b] = static_cast<std::uint32_t>(block);
+        c1[b] = static_cast<std::uint32_t>(block >> 32);
+        c2[b] = 0;
+        c3[b] = 0;
+    }
 
-    std::mt19937 rng(seed);
-    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::uint32_t k0 = seed;
+    std::uint32_t k1 = 0;
+    for (int round = 0; round < kPhiloxRounds; ++round)
+    {
+        for (std::size_t b = 0; b < kPhiloxBatch; ++b)
+        {
+            const std::uint64_t p0 = static_cast<std::uint64_t>(kPhiloxM0) * c0[b];
+            const std::uint64_t p1 = static_cast<std::uint64_t>(kPhiloxM1) * c2[b];
+            const std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1[b] ^ k0;
+            const std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3[b] ^ k1;
+            c1[b] = static_cast<std::uint32_t>(p1);
+            c3[b] = static_cast<std::uint32_t>(p0);
+            c0[b] = n0;
+            c2[b] = n2;
+        }
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+    }
 
-    for (int i = 0; i < rows; ++i)
+    for (std::size_t b = 0; b < kPhiloxBatch; ++b)
     {
-        for (int j = 0; j < cols; ++j)
+        out[b * kPhiloxLanes + 0] = bits_to_unit(c0[b]);
+        out[b * kPhiloxLanes + 1] = bits_to_unit(c1[b]);
+        out[b * kPhiloxLanes + 2] = bits_to_unit(c2[b]);
+        out[b * kPhiloxLanes + 3] = bits_to_unit(c3[b]);
+    }
+}
+
+// Fills data[begin, end) with the random values of those element indices.
+void fill_random(float *data, std::size_t begin, std::size_t end, std::uint32_t seed)
+{
+    constexpr std::size_t span = kPhiloxBatch * kPhiloxLanes;
+    float values[span];
+    for (std::size_t base = begin / span * span; base < end; base += span)
+    {
+        philox_batch(base / kPhiloxLanes, seed, values);
+        const std::size_t lo = std::max(base, begin);
+        const std::size_t hi = std::min(base + span, end);
+        for (std::size_t idx = lo; idx < hi; ++idx)
+        {
+            data[idx] = values[idx - base];
+        }
+    }
+}
+} // namespace
+
+MatrixBuffer generate_matrix(int rows, int cols, std::uint32_t seed, int pattern, AllocPolicy policy)
+{
+    if (pattern < RANDOM || pattern > CUSTOM)
+    {
+        throw std::invalid_argument("Unknown pattern type");
+    }
+
+    const std::size_t row_len = static_cast<std::size_t>(cols);
+    const std::size_t count = static_cast<std::size_t>(rows) * row_len;
+    MatrixBuffer mat =
+        MatrixBuffer::allocate(count, MatrixBuffer::kDefaultAlignment, policy, MatrixInit::Uninitialized);
+    float *data = mat.data();
+
+    // Chunks are independent and every value is a pure function of its index,
+    // so the result does not depend on the number of threads.
+    ThreadPool::shared().parallel_for(count, kFillGrain, [&](std::size_t begin, std::size_t end, int) {
+        switch (pattern)
         {
-            std::size_t idx = static_cast<std::size_t>(i) * static_cast<std::size_t>(cols) + static_cast<std::size_t>(j);
-            switch (pattern)
+        case RANDOM:
+            fill_random(data, begin, end, seed);
+            break;
+        case SEQUENTIAL:
+            for (std::size_t idx = begin; idx < end; ++idx)
             {
-            case RANDOM:
-                data[idx] = dist(rng);
-                break;
-            case SEQUENTIAL:
                 data[idx] = static_cast<float>(idx);
-                break;
-            case ONES:
-                data[idx] = 1.0f;
-                break;
-            case ZEROS:
-                data[idx] = 0.0f;
-                break;
-            case CUSTOM:
-                if(i == 0){
-                    data[idx] = 2.0f;
-                } else{
-                    data[idx] = 1.0f;
-                }
-                break;
-            default:
-                throw std::invalid_argument("Unknown pattern type");
             }
+            break;
+        case ONES:
+            std::fill(data + begin, data + end, 1.0f);
+            break;
+        case ZEROS:
+            std::fill(data + begin, data + end, 0.0f);
+            break;
+        case CUSTOM:
+            // First row 2, remaining rows 1.
+            for (std::size_t idx = begin; idx < end; ++idx)
+            {
+                data[idx] = idx < row_len ? 2.0f : 1.0f;
+            }
+            break;
         }
-    }
+    });
 
     return mat;
-}
\ No newline at end of file
+}
+
+MatrixBuffer generate_grouped_operand(const std::vector<GemmShape> &groups, bool operand_b,
+                                      std::uint32_t seed, int pattern)
+{
+    const GroupedOffsets off = grouped_offsets(groups);
+    const std::vector<std::size_t> &starts = operand_b ? off.b : off.a;
+    MatrixBuffer out = MatrixBuffer::allocate_uninitialized(starts.back());
+    for (std::size_t g = 0; g < groups.size(); ++g)
+    {
+        const int rows = operand_b ? groups[g].K : groups[g].M;
+        const int cols = operand_b ? groups[g].N : groups[g].K;
+        if (starts[g + 1] == starts[g])
+        {
+            continue;
+        }
+        const MatrixBuffer part = generate_matrix(rows, cols, seed + static_cast<std::uint32_t>(g), pattern);
+        std::copy(part.data(), part.data() + part.size(), out.data() + starts[g]);
+    }
+    return out;
+}
+
+std::vector<GemmShape> moe_group_shapes(int experts, int tokens, int N, int K, double skew)
+{
+    if (experts <= 0 || tokens < 0 || skew < 0.0)
+    {
+        throw std::invalid_argument("MoE routing needs experts > 0, tokens >= 0 and skew >= 0");
+    }
+    std::vector<double> weight(static_cast<std::size_t>(experts));
+    for (int e = 0; e < experts; ++e)
+    {
+        weight[static_cast<std::size_t>(e)] = 1.0 / std::pow(e + 1.0, skew);
+    }
+    const double total = std::accumulate(weight.begin(), weight.end(), 0.0);
+
+    // Floor of every share, then the leftover rows one by one from the
+    // busiest expert down, so the counts sum to tokens exactly.
+    std::vector<int> rows(static_cast<std::size_t>(experts));
+    int assigned = 0;
+    for (int e = 0; e < experts; ++e)
+    {
+        rows[static_cast<std::size_t>(e)] = static_cast<int>(std::floor(tokens * weight[static_cast<std::size_t>(e)] / total));
+        assigned += rows[static_cast<std::size_t>(e)];
+    }
+    for (int e = 0; assigned < tokens; e = (e + 1) % experts, ++assigned)
+    {
+        ++rows[static_cast<std::size_t>(e)];
+    }
+
+    // Fixed Fisher-Yates shuffle, so the heavy experts are not always first.
+    std::mt19937 rng(2024);
+    for (std::size_t i = rows.size(); i > 1; --i)
+    {
+        std::swap(rows[i - 1], rows[rng() % i]);
+    }
+
+    std::vector<GemmShape> shapes;
+    shapes.reserve(rows.size());
+    for (int m : rows)
+    {
+        shapes.push_back(GemmShape{m, N, K});
+    }
+    return shapes;
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
+#include "../common/gemm_shape.h"
 #include "../common/matrix_buffer.h"
 #define RANDOM 0
 #define SEQUENTIAL 1
@@ -7,11 +11,30 @@
 #define ZEROS 3
 #define CUSTOM 4
 
-MatrixBuffer generate_matrix(int rows, int cols, std::uint32_t seed, int pattern = RANDOM);
+MatrixBuffer generate_matrix(int rows, int cols, std::uint32_t seed, int pattern = RANDOM,
+                             AllocPolicy policy = AllocPolicy::Default);
 
 struct SampleConfig
 {
     int M;
     int N;
     int K;
-};
\ No newline at end of file
+    // Number of independent M x N x K problems. Batched samples store the
+    // entries back to back (entry i of A starts at i * M * K, etc.).
+    int batch = 1;
+    // Grouped samples hold one problem per entry, each with its own shape,
+    // and store the groups' dense matrices back to back (grouped_offsets).
+    // M, N and K are then the largest extents over the groups; batch is 1.
+    std::vector<GemmShape> groups{};
+};
+
+// One matrix per group (A: M x K, or B: K x N when operand_b is set), each
+// generated like generate_matrix with seed + group, concatenated.
+MatrixBuffer generate_grouped_operand(const std::vector<GemmShape> &groups, bool operand_b,
+                                      std::uint32_t seed, int pattern = RANDOM);
+
+// Mixture-of-experts routing: tokens rows spread over experts GEMMs of
+// N x K weights with Zipf-like skew (expert e gets a share proportional to
+// 1 / (e + 1)^skew, skew = 0 is uniform), in a fixed shuffled order. Experts
+// may receive no tokens at all.
+std::vector<GemmShape> moe_group_shapes(int experts, int tokens, int N, int K, double skew);
\ No newline at end of file
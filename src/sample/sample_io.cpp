@@ -1,15 +1,46 @@
 #include "sample_io.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <stdexcept>
+#include <vector>
+
+#include "../common/transpose.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GEMMBENCH_HAS_MMAP 1
+#endif
 
 namespace
 {
 constexpr std::uint32_t kSampleMagic = 0x47534d4d; // "GSMM"
-constexpr std::uint32_t kSampleVersion = 1;
+constexpr std::uint32_t kDtypeFloat32 = 0;
+constexpr std::uint32_t kSectionColumnMajor = 1u << 0;
+// Grouped operand: the groups' dense row-major matrices back to back; rows
+// holds the group count and cols / ld are 0.
+constexpr std::uint32_t kSectionGrouped = 1u << 1;
+constexpr std::uint32_t kMaxGroups = 1u << 20;
+constexpr std::uint64_t kPageAlignment = 4096;
+constexpr std::uint64_t kHugePageAlignment = 2u * 1024u * 1024u;
 
+enum SectionKind : std::uint32_t
+{
+    kSectionA = 0,
+    kSectionB = 1,
+    kSectionC = 2,
+    kSectionShapes = 3, // grouped samples: uint32 (M, N, K) per group
+};
+
+// v1: header immediately followed by dense row-major A, B and C.
 struct SampleFileHeader
 {
     std::uint32_t magic;
@@ -19,21 +50,359 @@ struct SampleFileHeader
     std::uint32_t K;
 };
 
+// v2: header, then section_count SampleSectionEntry records, then the
+// matrices at the offsets recorded in the table (page or hugepage aligned).
+struct SampleFileHeaderV2
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t M;
+    std::uint32_t N;
+    std::uint32_t K;
+    std::uint32_t dtype;
+    std::uint32_t section_count;
+    std::uint32_t batch; // 0 (files from before batching) or 1: single GEMM
+    std::uint64_t section_table_offset;
+};
+
+struct SampleSectionEntry
+{
+    std::uint32_t kind;
+    std::uint32_t flags; // kSectionColumnMajor, kSectionGrouped
+    std::uint32_t rows;
+    std::uint32_t cols;
+    std::uint64_t ld; // leading dimension in elements
+    std::uint64_t offset;
+    std::uint64_t bytes;
+};
+
+static_assert(sizeof(SampleFileHeader) == 20, "v1 header layout is fixed");
+static_assert(sizeof(SampleFileHeaderV2) == 40, "v2 header layout is fixed");
+static_assert(sizeof(SampleSectionEntry) == 40, "v2 section layout is fixed");
+
+using ByteReader = std::function<void(std::uint64_t offset, std::size_t bytes, void *dst)>;
+
+struct SampleLayout
+{
+    SampleConfig cfg{};
+    std::vector<SampleSectionEntry> sections;
+};
+
 void validate_dimensions(const SampleData &data)
 {
-    const auto expectedA = static_cast<std::size_t>(data.cfg.M) * static_cast<std::size_t>(data.cfg.K);
-    const auto expectedB = static_cast<std::size_t>(data.cfg.K) * static_cast<std::size_t>(data.cfg.N);
-    const auto expectedC = static_cast<std::size_t>(data.cfg.M) * static_cast<std::size_t>(data.cfg.N);
-    if (data.A.size() != expectedA || data.B.size() != expectedB || data.C.size() != expectedC)
+    if (data.cfg.batch < 1)
+    {
+        throw std::runtime_error("SampleData batch count must be at least 1");
+    }
+    if (!data.cfg.groups.empty())
+    {
+        const GemmShape largest = max_shape(data.cfg.groups);
+        if (data.cfg.batch != 1 || largest.M != data.cfg.M || largest.N != data.cfg.N || largest.K != data.cfg.K)
+        {
+            throw std::runtime_error("Grouped SampleData needs batch 1 and M/N/K equal to the largest group extents");
+        }
+    }
+    const auto batch = static_cast<std::size_t>(data.cfg.batch);
+    auto expectedA = batch * static_cast<std::size_t>(data.cfg.M) * static_cast<std::size_t>(data.cfg.K);
+    auto expectedB = batch * static_cast<std::size_t>(data.cfg.K) * static_cast<std::size_t>(data.cfg.N);
+    auto expectedC = batch * static_cast<std::size_t>(data.cfg.M) * static_cast<std::size_t>(data.cfg.N);
+    if (!data.cfg.groups.empty())
+    {
+        const GroupedOffsets off = grouped_offsets(data.cfg.groups);
+        expectedA = off.a.back();
+        expectedB = off.b.back();
+        expectedC = off.c.back();
+    }
+    // C may be left out (e.g. for cases only verified with Freivalds' check).
+    const bool c_ok = data.C.size() == expectedC || (data.C.empty() && expectedC > 0);
+    if (data.A.size() != expectedA || data.B.size() != expectedB || !c_ok)
     {
         throw std::runtime_error("SampleData dimensions do not match matrix sizes");
     }
 }
+
+std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool is_dense_row_major(const SampleSectionEntry &s)
+{
+    return (s.flags & kSectionColumnMajor) == 0 && s.ld == s.cols;
+}
+
+std::size_t section_elements(const SampleSectionEntry &s)
+{
+    if ((s.flags & kSectionGrouped) != 0)
+    {
+        return static_cast<std::size_t>(s.bytes / sizeof(float));
+    }
+    return static_cast<std::size_t>(s.rows) * s.cols;
+}
+
+// Reads and checks the shape list of a grouped sample.
+std::vector<GemmShape> parse_group_shapes(const ByteReader &read, const SampleSectionEntry &s, const std::string &path)
+{
+    if (s.rows == 0 || s.rows > kMaxGroups || s.cols != 3 || s.ld != 3 || s.flags != 0 ||
+        s.bytes != static_cast<std::uint64_t>(s.rows) * 3 * sizeof(std::uint32_t))
+    {
+        throw std::runtime_error("Invalid grouped sample shape list: " + path);
+    }
+    std::vector<std::uint32_t> raw(static_cast<std::size_t>(s.rows) * 3);
+    read(s.offset, raw.size() * sizeof(std::uint32_t), raw.data());
+    std::vector<GemmShape> shapes;
+    shapes.reserve(s.rows);
+    for (std::size_t g = 0; g < s.rows; ++g)
+    {
+        const std::uint32_t *dims = raw.data() + g * 3;
+        if (dims[0] > INT32_MAX || dims[1] > INT32_MAX || dims[2] > INT32_MAX)
+        {
+            throw std::runtime_error("Invalid grouped sample shape list: " + path);
+        }
+        shapes.push_back(GemmShape{static_cast<int>(dims[0]), static_cast<int>(dims[1]), static_cast<int>(dims[2])});
+    }
+    return shapes;
+}
+
+SampleLayout parse_layout(const ByteReader &read, std::uint64_t file_size, const std::string &path)
+{
+    SampleFileHeader header{};
+    if (file_size < sizeof(header))
+    {
+        throw std::runtime_error("Invalid or corrupt sample file header: " + path);
+    }
+    read(0, sizeof(header), &header);
+    if (header.magic != kSampleMagic ||
+        (header.version != kSampleFormatV1 && header.version != kSampleFormatV2))
+    {
+        throw std::runtime_error("Invalid or corrupt sample file header: " + path);
+    }
+
+    SampleLayout layout;
+    layout.cfg.M = static_cast<int>(header.M);
+    layout.cfg.N = static_cast<int>(header.N);
+    layout.cfg.K = static_cast<int>(header.K);
+    SampleFileHeaderV2 v2{};
+    if (header.version == kSampleFormatV2)
+    {
+        if (file_size < sizeof(v2))
+        {
+            throw std::runtime_error("Invalid or corrupt sample file header: " + path);
+        }
+        read(0, sizeof(v2), &v2);
+        const std::uint64_t tallest = std::max(header.M, header.K);
+        if (v2.batch > 1u << 20 || static_cast<std::uint64_t>(v2.batch) * tallest > UINT32_MAX)
+        {
+            throw std::runtime_error("Invalid sample batch count " + std::to_string(v2.batch) + ": " + path);
+        }
+        layout.cfg.batch = static_cast<int>(std::max<std::uint32_t>(v2.batch, 1));
+    }
+    // Batched sections stack the entries along the rows.
+    const auto batch = static_cast<std::uint32_t>(layout.cfg.batch);
+    const std::uint32_t dims[3][2] = {{batch * header.M, header.K}, {batch * header.K, header.N}, {batch * header.M, header.N}};
+
+    if (header.version == kSampleFormatV1)
+    {
+        std::uint64_t offset = sizeof(header);
+        for (std::uint32_t kind = kSectionA; kind <= kSectionC; ++kind)
+        {
+            const std::uint32_t rows = dims[kind][0];
+            const std::uint32_t cols = dims[kind][1];
+            const std::uint64_t bytes = static_cast<std::uint64_t>(rows) * cols * sizeof(float);
+            layout.sections.push_back(SampleSectionEntry{kind, 0, rows, cols, cols, offset, bytes});
+            offset += bytes;
+        }
+    }
+    else
+    {
+        if (v2.dtype != kDtypeFloat32)
+        {
+            throw std::runtime_error("Unsupported sample dtype " + std::to_string(v2.dtype) + ": " + path);
+        }
+        if (v2.section_count > 16 ||
+            v2.section_table_offset + static_cast<std::uint64_t>(v2.section_count) * sizeof(SampleSectionEntry) > file_size)
+        {
+            throw std::runtime_error("Invalid or corrupt sample section table: " + path);
+        }
+        layout.sections.resize(v2.section_count);
+        if (v2.section_count > 0)
+        {
+            read(v2.section_table_offset, v2.section_count * sizeof(SampleSectionEntry), layout.sections.data());
+        }
+    }
+
+    bool seen[4] = {false, false, false, false};
+    for (const auto &s : layout.sections)
+    {
+        if (s.kind > kSectionShapes || seen[s.kind])
+        {
+            throw std::runtime_error("Invalid or duplicate sample section: " + path);
+        }
+        seen[s.kind] = true;
+        if (s.kind == kSectionShapes)
+        {
+            if (s.offset + s.bytes > file_size)
+            {
+                throw std::runtime_error("Sample file is truncated: " + path);
+            }
+            layout.cfg.groups = parse_group_shapes(read, s, path);
+        }
+    }
+    // Grouped sections are flat concatenations sized by the shape list.
+    const bool grouped = !layout.cfg.groups.empty();
+    const GroupedOffsets group_off = grouped_offsets(layout.cfg.groups);
+    if (grouped)
+    {
+        const GemmShape largest = max_shape(layout.cfg.groups);
+        if (batch > 1 || largest.M != layout.cfg.M || largest.N != layout.cfg.N || largest.K != layout.cfg.K)
+        {
+            throw std::runtime_error("Grouped sample header does not match its shape list: " + path);
+        }
+    }
+    for (const auto &s : layout.sections)
+    {
+        if (s.kind == kSectionShapes)
+        {
+            continue;
+        }
+        if (((s.flags & kSectionGrouped) != 0) != grouped)
+        {
+            throw std::runtime_error("Sample section grouping does not match the shape list: " + path);
+        }
+        if (grouped)
+        {
+            const std::vector<std::size_t> &ends = s.kind == kSectionA ? group_off.a
+                                                  : s.kind == kSectionB ? group_off.b : group_off.c;
+            if (s.flags != kSectionGrouped || s.rows != layout.cfg.groups.size() || s.cols != 0 || s.ld != 0 ||
+                s.bytes != ends.back() * sizeof(float))
+            {
+                throw std::runtime_error("Sample section shape does not match header: " + path);
+            }
+            if (s.offset + s.bytes > file_size)
+            {
+                throw std::runtime_error("Sample file is truncated: " + path);
+            }
+            continue;
+        }
+        const bool col_major = (s.flags & kSectionColumnMajor) != 0;
+        if (col_major && batch > 1)
+        {
+            throw std::runtime_error("Batched sample sections must be row-major: " + path);
+        }
+        const std::uint64_t inner = col_major ? s.rows : s.cols;
+        const std::uint64_t outer = col_major ? s.cols : s.rows;
+        if (s.rows != dims[s.kind][0] || s.cols != dims[s.kind][1] || s.ld < inner)
+        {
+            throw std::runtime_error("Sample section shape does not match header: " + path);
+        }
+        const std::uint64_t needed = outer == 0 ? 0 : ((outer - 1) * s.ld + inner) * sizeof(float);
+        if (s.bytes < needed || s.offset + s.bytes > file_size)
+        {
+            throw std::runtime_error("Sample file is truncated: " + path);
+        }
+    }
+    if (!seen[kSectionA] || !seen[kSectionB])
+    {
+        throw std::runtime_error("Sample file is missing A or B: " + path);
+    }
+    return layout;
+}
+
+// Copies a strided or column-major section into a dense row-major buffer.
+MatrixBuffer densify(const float *src, const SampleSectionEntry &s, AllocPolicy policy)
+{
+    MatrixBuffer out = MatrixBuffer::allocate(static_cast<std::size_t>(s.rows) * s.cols,
+                                              MatrixBuffer::kDefaultAlignment, policy, MatrixInit::Uninitialized);
+    if ((s.flags & kSectionColumnMajor) != 0)
+    {
+        // Column-major storage is the row-major cols x rows transpose.
+        transpose(src, s.ld, out.data(), s.cols, static_cast<int>(s.cols), static_cast<int>(s.rows));
+        return out;
+    }
+    for (std::size_t i = 0; i < s.rows; ++i)
+    {
+        std::copy(src + i * s.ld, src + i * s.ld + s.cols, out.data() + i * s.cols);
+    }
+    return out;
+}
+
+MatrixBuffer &section_target(SampleData &data, std::uint32_t kind)
+{
+    return kind == kSectionA ? data.A : (kind == kSectionB ? data.B : data.C);
+}
+
+void write_padding(std::ofstream &ofs, std::uint64_t target)
+{
+    static const char zeros[4096] = {};
+    auto pos = static_cast<std::uint64_t>(ofs.tellp());
+    while (pos < target)
+    {
+        const auto chunk = std::min<std::uint64_t>(sizeof(zeros), target - pos);
+        ofs.write(zeros, static_cast<std::streamsize>(chunk));
+        pos += chunk;
+    }
+}
+
+#if defined(GEMMBENCH_HAS_MMAP)
+// Read-only private mapping of a whole sample file; unmapped when the last
+// MatrixBuffer view referencing it is destroyed.
+struct FileMapping
+{
+    void *addr = MAP_FAILED;
+    std::size_t length = 0;
+
+    ~FileMapping()
+    {
+        if (addr != MAP_FAILED)
+        {
+            munmap(addr, length);
+        }
+    }
+};
+
+// Maps the file at a 2 MiB aligned address when it is large enough, so
+// hugepage-aligned v2 sections are also hugepage aligned in memory.
+void *map_file_aligned(int fd, std::size_t length)
+{
+    if (length < kHugePageAlignment)
+    {
+        return mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    const std::size_t reserve = length + kHugePageAlignment;
+    void *region = mmap(nullptr, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        return MAP_FAILED;
+    }
+    const auto base = reinterpret_cast<std::uintptr_t>(region);
+    const auto aligned = static_cast<std::uintptr_t>(align_up(base, kHugePageAlignment));
+    void *addr = mmap(reinterpret_cast<void *>(aligned), length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        munmap(region, reserve);
+        return MAP_FAILED;
+    }
+    if (aligned > base)
+    {
+        munmap(region, aligned - base);
+    }
+    const std::uintptr_t tail = aligned + align_up(length, kPageAlignment);
+    if (tail < base + reserve)
+    {
+        munmap(reinterpret_cast<void *>(tail), base + reserve - tail);
+    }
+    return addr;
+}
+#endif
 } // namespace
 
-void save_sample_file(const std::string &path, const SampleData &data)
+void save_sample_file(const std::string &path, const SampleData &data, std::uint32_t version)
 {
     validate_dimensions(data);
+    if (version != kSampleFormatV1 && version != kSampleFormatV2)
+    {
+        throw std::invalid_argument("Unsupported sample format version: " + std::to_string(version));
+    }
 
     const auto parent = std::filesystem::path(path).parent_path();
     if (!parent.empty())
@@ -47,12 +416,6 @@ void save_sample_file(const std::string &path, const SampleData &data)
         throw std::runtime_error("Failed to open sample file for writing: " + path);
     }
 
-    SampleFileHeader header{ kSampleMagic, kSampleVersion,
-                             static_cast<std::uint32_t>(data.cfg.M),
-                             static_cast<std::uint32_t>(data.cfg.N),
-                             static_cast<std::uint32_t>(data.cfg.K) };
-    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
-
     const auto write_buffer = [&ofs](const MatrixBuffer &matrix) {
         if (matrix.empty())
             return;
@@ -60,57 +423,218 @@ void save_sample_file(const std::string &path, const SampleData &data)
                   static_cast<std::streamsize>(matrix.size() * sizeof(float)));
     };
 
-    write_buffer(data.A);
-    write_buffer(data.B);
-    write_buffer(data.C);
+    const bool has_reference = !data.C.empty() || data.cfg.M == 0 || data.cfg.N == 0;
+    if (version == kSampleFormatV1 && !has_reference)
+    {
+        throw std::invalid_argument("Sample format v1 requires a reference C");
+    }
+    if (version == kSampleFormatV1 && (data.cfg.batch > 1 || !data.cfg.groups.empty()))
+    {
+        throw std::invalid_argument("Sample format v1 cannot store batched or grouped samples");
+    }
+    if (data.cfg.groups.size() > kMaxGroups)
+    {
+        throw std::invalid_argument("Too many groups for a sample file: " + std::to_string(data.cfg.groups.size()));
+    }
+
+    if (version == kSampleFormatV1)
+    {
+        SampleFileHeader header{ kSampleMagic, kSampleFormatV1,
+                                 static_cast<std::uint32_t>(data.cfg.M),
+                                 static_cast<std::uint32_t>(data.cfg.N),
+                                 static_cast<std::uint32_t>(data.cfg.K) };
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        write_buffer(data.A);
+        write_buffer(data.B);
+        write_buffer(data.C);
+    }
+    else
+    {
+        const auto M = static_cast<std::uint32_t>(data.cfg.M);
+        const auto N = static_cast<std::uint32_t>(data.cfg.N);
+        const auto K = static_cast<std::uint32_t>(data.cfg.K);
+        const auto batch = static_cast<std::uint32_t>(data.cfg.batch);
+        std::vector<SampleSectionEntry> sections = {
+            {kSectionA, 0, batch * M, K, K, 0, data.A.size() * sizeof(float)},
+            {kSectionB, 0, batch * K, N, N, 0, data.B.size() * sizeof(float)},
+            {kSectionC, 0, batch * M, N, N, 0, data.C.size() * sizeof(float)},
+        };
+        if (!has_reference)
+        {
+            sections.pop_back();
+        }
+        std::vector<std::uint32_t> shape_list;
+        if (!data.cfg.groups.empty())
+        {
+            const auto count = static_cast<std::uint32_t>(data.cfg.groups.size());
+            for (auto &s : sections)
+            {
+                s.flags = kSectionGrouped;
+                s.rows = count;
+                s.cols = 0;
+                s.ld = 0;
+            }
+            for (const GemmShape &g : data.cfg.groups)
+            {
+                shape_list.push_back(static_cast<std::uint32_t>(g.M));
+                shape_list.push_back(static_cast<std::uint32_t>(g.N));
+                shape_list.push_back(static_cast<std::uint32_t>(g.K));
+            }
+            sections.push_back({kSectionShapes, 0, count, 3, 3, 0, shape_list.size() * sizeof(std::uint32_t)});
+        }
+
+        // Large sections start on hugepage boundaries, the rest on pages.
+        std::uint64_t offset = sizeof(SampleFileHeaderV2) + sections.size() * sizeof(SampleSectionEntry);
+        for (auto &s : sections)
+        {
+            offset = align_up(offset, s.bytes >= kHugePageAlignment ? kHugePageAlignment : kPageAlignment);
+            s.offset = offset;
+            offset += s.bytes;
+        }
+
+        SampleFileHeaderV2 header{ kSampleMagic, kSampleFormatV2, M, N, K, kDtypeFloat32,
+                                   static_cast<std::uint32_t>(sections.size()), batch,
+                                   sizeof(SampleFileHeaderV2) };
+        ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char *>(sections.data()),
+                  static_cast<std::streamsize>(sections.size() * sizeof(SampleSectionEntry)));
+        for (const auto &s : sections)
+        {
+            write_padding(ofs, s.offset);
+            if (s.kind == kSectionShapes)
+            {
+                ofs.write(reinterpret_cast<const char *>(shape_list.data()), static_cast<std::streamsize>(s.bytes));
+            }
+            else
+            {
+                write_buffer(s.kind == kSectionA ? data.A : (s.kind == kSectionB ? data.B : data.C));
+            }
+        }
+    }
+
+    if (!ofs)
+    {
+        throw std::runtime_error("Failed to write sample file: " + path);
+    }
 }
 
-SampleData load_sample_file(const std::string &path)
+SampleData load_sample_file(const std::string &path, AllocPolicy policy)
 {
-    std::ifstream ifs(path, std::ios::binary);
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
     if (!ifs)
     {
         throw std::runtime_error("Failed to open sample file for reading: " + path);
     }
+    const auto file_size = static_cast<std::uint64_t>(ifs.tellg());
 
-    SampleFileHeader header{};
-    ifs.read(reinterpret_cast<char *>(&header), sizeof(header));
-    if (!ifs || header.magic != kSampleMagic || header.version != kSampleVersion)
-    {
-        throw std::runtime_error("Invalid or corrupt sample file header: " + path);
-    }
+    const ByteReader read = [&ifs, &path](std::uint64_t offset, std::size_t bytes, void *dst) {
+        ifs.seekg(static_cast<std::streamoff>(offset));
+        if (!ifs.read(static_cast<char *>(dst), static_cast<std::streamsize>(bytes)))
+        {
+            throw std::runtime_error("Sample file is truncated: " + path);
+        }
+    };
+    const SampleLayout layout = parse_layout(read, file_size, path);
 
     SampleData data;
-    data.cfg = SampleConfig{static_cast<int>(header.M), static_cast<int>(header.N), static_cast<int>(header.K)};
-
-    const auto read_buffer = [&ifs, &path](std::size_t count) {
-        MatrixBuffer buffer = MatrixBuffer::allocate(count);
-        if (count == 0)
+    data.cfg = layout.cfg;
+    for (const auto &s : layout.sections)
+    {
+        if (s.kind == kSectionShapes)
         {
-            return buffer;
+            continue;
         }
-        const auto bytes = static_cast<std::streamsize>(count * sizeof(float));
-        if (!ifs.read(reinterpret_cast<char *>(buffer.data()), bytes))
+        const std::size_t count = section_elements(s);
+        MatrixBuffer &target = section_target(data, s.kind);
+        if (is_dense_row_major(s))
         {
-            throw std::runtime_error("Sample file is truncated: " + path);
+            target = MatrixBuffer::allocate(count, MatrixBuffer::kDefaultAlignment, policy, MatrixInit::Uninitialized);
+            if (count > 0)
+            {
+                read(s.offset, count * sizeof(float), target.data());
+            }
         }
-        return buffer;
-    };
+        else
+        {
+            MatrixBuffer raw = MatrixBuffer::allocate_uninitialized(s.bytes / sizeof(float));
+            read(s.offset, raw.size() * sizeof(float), raw.data());
+            target = densify(raw.data(), s, policy);
+        }
+    }
+    return data;
+}
 
-    const auto a_size = static_cast<std::size_t>(data.cfg.M) * static_cast<std::size_t>(data.cfg.K);
-    const auto b_size = static_cast<std::size_t>(data.cfg.K) * static_cast<std::size_t>(data.cfg.N);
-    const auto c_size = static_cast<std::size_t>(data.cfg.M) * static_cast<std::size_t>(data.cfg.N);
+SampleData map_sample_file(const std::string &path, AllocPolicy policy)
+{
+#if defined(GEMMBENCH_HAS_MMAP)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open sample file for reading: " + path);
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Failed to stat sample file: " + path);
+    }
+
+    auto mapping = std::make_shared<FileMapping>();
+    mapping->length = static_cast<std::size_t>(st.st_size);
+    if (mapping->length > 0)
+    {
+        mapping->addr = map_file_aligned(fd, mapping->length);
+    }
+    close(fd);
+    if (mapping->addr == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map sample file: " + path);
+    }
+
+    const char *base = static_cast<const char *>(mapping->addr);
+    const ByteReader read = [base](std::uint64_t offset, std::size_t bytes, void *dst) {
+        std::memcpy(dst, base + offset, bytes);
+    };
+    const SampleLayout layout = parse_layout(read, mapping->length, path);
 
-    data.A = read_buffer(a_size);
-    data.B = read_buffer(b_size);
-    data.C = read_buffer(c_size);
+    // The whole file is consumed once by the benchmark; start readahead now.
+    madvise(mapping->addr, mapping->length, MADV_WILLNEED);
 
+    SampleData data;
+    data.cfg = layout.cfg;
+    for (const auto &s : layout.sections)
+    {
+        if (s.kind == kSectionShapes)
+        {
+            continue;
+        }
+        auto *src = reinterpret_cast<float *>(static_cast<char *>(mapping->addr) + s.offset);
+        MatrixBuffer &target = section_target(data, s.kind);
+        if (is_dense_row_major(s))
+        {
+            target = MatrixBuffer::view(src, section_elements(s), mapping);
+        }
+        else
+        {
+            target = densify(src, s, policy);
+        }
+    }
     return data;
+#else
+    return load_sample_file(path, policy);
+#endif
 }
 
-void SampleData::convert_to_column_major()
+void SampleData::convert_to_column_major(AllocPolicy policy)
 {
-    A.convert_to_column_major(cfg.M, cfg.K);
-    B.convert_to_column_major(cfg.K, cfg.N);
-    C.convert_to_column_major(cfg.M, cfg.N);
+    if (cfg.batch > 1 || !cfg.groups.empty())
+    {
+        throw std::runtime_error("Batched and grouped samples are only available in row-major layout");
+    }
+    A.convert_to_column_major(cfg.M, cfg.K, policy);
+    B.convert_to_column_major(cfg.K, cfg.N, policy);
+    if (!C.empty())
+    {
+        C.convert_to_column_major(cfg.M, cfg.N, policy);
+    }
 }
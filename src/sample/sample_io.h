@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include "../common/matrix_buffer.h"
@@ -12,8 +13,27 @@ struct SampleData
     MatrixBuffer B;
     MatrixBuffer C;
 
-    void convert_to_column_major();
+    void convert_to_column_major(AllocPolicy policy = AllocPolicy::Default);
 };
 
-void save_sample_file(const std::string &path, const SampleData &data);
-SampleData load_sample_file(const std::string &path);
+// v1: 20-byte header followed by dense row-major A, B, C.
+// v2: header + section table; every matrix starts on a page (or, when at
+// least 2 MiB, hugepage) boundary and records its layout, leading dimension
+// and dtype. Both versions are readable; v2 is written by default. v2 files
+// may omit C (no stored reference); SampleData::C is then left empty.
+// Batched samples (cfg.batch > 1) are v2 only: the header records the batch
+// count and each section holds the entries stacked as batch * rows rows.
+// Grouped samples (cfg.groups non-empty, v2 only) add a section with the
+// (M, N, K) list; A, B and C then hold the groups' matrices back to back.
+constexpr std::uint32_t kSampleFormatV1 = 1;
+constexpr std::uint32_t kSampleFormatV2 = 2;
+
+void save_sample_file(const std::string &path, const SampleData &data,
+                      std::uint32_t version = kSampleFormatV2);
+// policy is used for the A/B/C buffers that are copied out of the file.
+SampleData load_sample_file(const std::string &path, AllocPolicy policy = AllocPolicy::Default);
+
+// Zero-copy variant: maps the file read-only and exposes A/B/C as views into
+// the mapping, so concurrent runs share page-cache pages. Falls back to
+// load_sample_file on platforms without mmap.
+SampleData map_sample_file(const std::string &path, AllocPolicy policy = AllocPolicy::Default);